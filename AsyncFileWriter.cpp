@@ -0,0 +1,122 @@
+#include "AsyncFileWriter.h"
+
+#include <QFile>
+#include <vector>
+
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#endif
+
+namespace {
+  // files written per wake up of the writer thread
+  const size_t kMaxBatchSize = 32;
+  // smaller files are not worth the extra call
+  const qint64 kPreallocateThreshold = 64 * 1024;
+}
+
+AsyncFileWriter& AsyncFileWriter::instance()
+{
+  static AsyncFileWriter sInstance;
+  return sInstance;
+}
+
+AsyncFileWriter::AsyncFileWriter(qint64 maxQueuedBytes, QObject* parent)
+  : QObject(parent)
+  , mMaxQueuedBytes(maxQueuedBytes)
+{
+  mThread = std::thread(&AsyncFileWriter::run, this);
+}
+
+AsyncFileWriter::~AsyncFileWriter()
+{
+  {
+    QMutexLocker locker(&mMutex);
+    mStopping = true;
+    mQueueChanged.wakeAll();
+  }
+  // the remaining queue is written before the thread ends
+  mThread.join();
+}
+
+quint64 AsyncFileWriter::write(const QString& path, const QByteArray& data)
+{
+  QMutexLocker locker(&mMutex);
+  // back pressure only if the disk can't keep up at all
+  while (!mQueue.empty() && mQueuedBytes + data.size() > mMaxQueuedBytes) {
+    mQueueChanged.wait(&mMutex);
+  }
+  const quint64 ticket = mNextTicket++;
+  mQueue.push_back({ ticket, path, data });
+  mQueuedBytes += data.size();
+  mQueueChanged.wakeAll();
+  return ticket;
+}
+
+void AsyncFileWriter::flush()
+{
+  QMutexLocker locker(&mMutex);
+  while (!mQueue.empty() || mWriting > 0) {
+    mQueueChanged.wait(&mMutex);
+  }
+}
+
+void AsyncFileWriter::run()
+{
+  std::vector<Job> batch;
+  while (true) {
+    {
+      QMutexLocker locker(&mMutex);
+      while (mQueue.empty() && !mStopping) {
+        mQueueChanged.wait(&mMutex);
+      }
+      if (mQueue.empty() && mStopping) return;
+
+      batch.clear();
+      while (!mQueue.empty() && batch.size() < kMaxBatchSize) {
+        batch.push_back(std::move(mQueue.front()));
+        mQueue.pop_front();
+      }
+      mWriting = static_cast<int>(batch.size());
+    }
+
+    qint64 writtenBytes = 0;
+    for (const auto& job : batch) {
+      QString errorMessage;
+      const bool success = writeFile(job, errorMessage);
+      writtenBytes += job.data.size();
+      emit written(job.ticket, job.path, success, errorMessage);
+    }
+
+    QMutexLocker locker(&mMutex);
+    mQueuedBytes -= writtenBytes;
+    mWriting = 0;
+    // wakes blocked writers and flush()
+    mQueueChanged.wakeAll();
+  }
+}
+
+bool AsyncFileWriter::writeFile(const Job& job, QString& errorMessage)
+{
+  QFile file(job.path);
+  if (!file.open(QIODevice::WriteOnly)) {
+    errorMessage = QString("Can't open '%1': %2").arg(job.path).arg(file.errorString());
+    return false;
+  }
+
+  const qint64 size = job.data.size();
+  if (size >= kPreallocateThreshold) {
+    // reserve the final size at once instead of growing the file per write
+#ifdef Q_OS_LINUX
+    posix_fallocate(file.handle(), 0, size);
+#else
+    file.resize(size);
+#endif
+  }
+
+  if (file.write(job.data) != size) {
+    errorMessage = QString("Can't write '%1': %2").arg(job.path).arg(file.errorString());
+    return false;
+  }
+  file.close();
+  return true;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <QObject>
+#include <QByteArray>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QString>
+#include <deque>
+#include <thread>
+
+// Writes files on a dedicated thread so network and render threads never
+// wait for the disk. Queued files are written in batches, preallocated to
+// their final size, and every completion is reported by the written() signal
+// (queued to the receiver's thread).
+// The queue is bounded by bytes: write() only blocks if that much data is
+// already waiting, which protects the memory when the disk can't keep up.
+
+class AsyncFileWriter : public QObject
+{
+  Q_OBJECT
+
+public:
+  // the shared writer of the process
+  static AsyncFileWriter& instance();
+
+  explicit AsyncFileWriter(qint64 maxQueuedBytes = 256 * 1024 * 1024, QObject* parent = nullptr);
+  ~AsyncFileWriter();
+
+  // queue data to be written to path, returns the ticket reported by written()
+  quint64 write(const QString& path, const QByteArray& data);
+  // block until everything queued so far is on disk
+  void flush();
+
+signals:
+  void written(quint64 ticket, const QString& path, bool success, const QString& errorMessage);
+
+private:
+  struct Job {
+    quint64 ticket;
+    QString path;
+    QByteArray data;
+  };
+  void run();
+  bool writeFile(const Job& job, QString& errorMessage);
+
+  const qint64 mMaxQueuedBytes;
+  QMutex mMutex;
+  QWaitCondition mQueueChanged;
+  std::deque<Job> mQueue;
+  qint64 mQueuedBytes = 0;
+  quint64 mNextTicket = 1;
+  int mWriting = 0;
+  bool mStopping = false;
+  std::thread mThread;
+};
@@ -0,0 +1,18 @@
+#include "ConsoleLog.h"
+
+#include <QTime>
+#include <cstdio>
+
+namespace ConsoleLog
+{
+  void line(const QString& message)
+  {
+    std::fprintf(stdout, "%s\n", message.toLocal8Bit().constData());
+    std::fflush(stdout);
+  }
+
+  void timedLine(const QString& message)
+  {
+    line(QString("%1 %2").arg(QTime::currentTime().toString(Qt::ISODate)).arg(message));
+  }
+}
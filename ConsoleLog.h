@@ -0,0 +1,13 @@
+#pragma once
+#include <QString>
+
+// Progress lines of the headless modes (soak, flow benchmark, folder watch,
+// render workers and coordinator) on stdout, flushed at once so they show up
+// in logs of piped runs.
+
+namespace ConsoleLog
+{
+  void line(const QString& message);
+  // prefixed with the time of day, for long running modes
+  void timedLine(const QString& message);
+}
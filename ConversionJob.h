@@ -0,0 +1,46 @@
+#pragma once
+#include <QByteArray>
+#include <QException>
+#include <QFuture>
+#include <QString>
+#include <QStringList>
+
+// Handle of a conversion queued with PowerPointConverter::convert().
+// The futures can be used from any thread: wait for slides.resultAt(0) to
+// use the first slide while the others are still converting, or connect a
+// QFutureWatcher (resultReadyAt) to process the slides as they arrive.
+// On failure done throws ConversionError; slides keeps the ones delivered.
+
+struct SlideResult {
+  int index = -1;
+  QString file;
+};
+
+class ConversionError : public QException
+{
+public:
+  explicit ConversionError(const QString& message = QString())
+    : mMessage(message)
+    , mWhat(message.toUtf8())
+  {
+  }
+
+  void raise() const override { throw *this; }
+  ConversionError* clone() const override { return new ConversionError(*this); }
+  const char* what() const noexcept override { return mWhat.constData(); }
+  QString message() const { return mMessage; }
+
+private:
+  QString mMessage;
+  QByteArray mWhat;
+};
+
+struct ConversionJob {
+  // result i is slide i, reported as soon as its file is saved; the progress range is the slide count
+  QFuture<SlideResult> slides;
+  // all created files once the whole presentation is converted
+  QFuture<QStringList> done;
+
+  // stop the conversion (also if it is still queued)
+  void cancel() { slides.cancel(); }
+};
@@ -0,0 +1,202 @@
+#include "CredentialPool.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QThread>
+#include <QtMath>
+
+namespace {
+  const qint64 kMaxBackoffMsecs = 60 * 1000;
+  // tokens are refreshed this long before they expire, requests may be queued meanwhile
+  const qint64 kTokenRefreshMarginMsecs = 60 * 1000;
+}
+
+std::shared_ptr<CredentialPool> CredentialPool::instance()
+{
+  static QMutex sInstanceMutex;
+  static std::shared_ptr<CredentialPool> sInstance;
+  QMutexLocker locker(&sInstanceMutex);
+  if (!sInstance) {
+    sInstance = std::make_shared<CredentialPool>();
+    QString path = qEnvironmentVariable("PPTX_CONVERTER_CREDENTIALS");
+    if (path.isEmpty()) path = QCoreApplication::applicationDirPath() + "/credentials.json";
+    // no built-in fallback, the jobs fail with a message instead
+    if (!sInstance->load(path)) {
+      qWarning("No cloud credentials loaded from '%s'", qPrintable(path));
+    }
+  }
+  return sInstance;
+}
+
+CredentialPool::CredentialPool()
+{
+  mClock.start();
+}
+
+bool CredentialPool::load(const QString& path)
+{
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly)) return false;
+  auto accounts = QJsonDocument::fromJson(file.readAll()).object()["accounts"].toArray();
+  int loaded = 0;
+  for (const auto& value : accounts) {
+    auto object = value.toObject();
+    Credential credential;
+    credential.clientId = object["clientId"].toString();
+    credential.clientSecret = object["clientSecret"].toString();
+    credential.requestsPerSecond = object["requestsPerSecond"].toDouble(credential.requestsPerSecond);
+    credential.burst = object["burst"].toInt(credential.burst);
+    if (credential.clientId.isEmpty() || credential.clientSecret.isEmpty() || credential.requestsPerSecond <= 0) continue;
+    addAccount(credential);
+    loaded++;
+  }
+  return loaded > 0;
+}
+
+void CredentialPool::addAccount(const Credential& credential)
+{
+  QMutexLocker locker(&mMutex);
+  Account account;
+  account.credential = credential;
+  account.tokens = qMax(1, credential.burst);
+  account.lastRefill = mClock.elapsed();
+  mAccounts.push_back(account);
+}
+
+int CredentialPool::accountCount() const
+{
+  QMutexLocker locker(&mMutex);
+  return mAccounts.size();
+}
+
+CredentialPool::Credential CredentialPool::credential(int account) const
+{
+  QMutexLocker locker(&mMutex);
+  return mAccounts.value(account).credential;
+}
+
+void CredentialPool::refill(Account& account, qint64 now)
+{
+  const double refilled = account.tokens + (now - account.lastRefill) * account.credential.requestsPerSecond / 1000.0;
+  account.tokens = qMin<double>(qMax(1, account.credential.burst), refilled);
+  account.lastRefill = now;
+}
+
+int CredentialPool::acquireAccount()
+{
+  QMutexLocker locker(&mMutex);
+  const qint64 now = mClock.elapsed();
+  int best = -1;
+  for (int i = 0; i < mAccounts.size(); ++i) {
+    auto& account = mAccounts[i];
+    refill(account, now);
+    if (best < 0) {
+      best = i;
+      continue;
+    }
+    // prefer not blocked, then fewest jobs, then most remaining tokens
+    const auto& current = mAccounts[best];
+    const bool blocked = account.blockedUntil > now;
+    const bool currentBlocked = current.blockedUntil > now;
+    if (blocked != currentBlocked) {
+      if (!blocked) best = i;
+      continue;
+    }
+    if (account.activeJobs != current.activeJobs) {
+      if (account.activeJobs < current.activeJobs) best = i;
+      continue;
+    }
+    if (account.tokens > current.tokens) best = i;
+  }
+  if (best >= 0) mAccounts[best].activeJobs++;
+  return best;
+}
+
+int CredentialPool::acquireAccount(const QString& clientId)
+{
+  QMutexLocker locker(&mMutex);
+  for (int i = 0; i < mAccounts.size(); ++i) {
+    if (mAccounts[i].credential.clientId != clientId) continue;
+    mAccounts[i].activeJobs++;
+    return i;
+  }
+  return -1;
+}
+
+void CredentialPool::releaseAccount(int account)
+{
+  QMutexLocker locker(&mMutex);
+  if (account < 0 || account >= mAccounts.size()) return;
+  mAccounts[account].activeJobs = qMax(0, mAccounts[account].activeJobs - 1);
+}
+
+qint64 CredentialPool::tryAcquireRequest(int index)
+{
+  QMutexLocker locker(&mMutex);
+  if (index < 0 || index >= mAccounts.size()) return 0;
+  auto& account = mAccounts[index];
+  const qint64 now = mClock.elapsed();
+  if (account.blockedUntil > now) return account.blockedUntil - now;
+  refill(account, now);
+  if (account.tokens >= 1.0) {
+    account.tokens -= 1.0;
+    return 0;
+  }
+  return qMax<qint64>(1, qCeil((1.0 - account.tokens) * 1000.0 / account.credential.requestsPerSecond));
+}
+
+void CredentialPool::waitForRequest(int account)
+{
+  qint64 wait;
+  while ((wait = tryAcquireRequest(account)) > 0) QThread::msleep(static_cast<unsigned long>(wait));
+}
+
+qint64 CredentialPool::reportRateLimited(int index, qint64 msecs)
+{
+  QMutexLocker locker(&mMutex);
+  if (index < 0 || index >= mAccounts.size()) return 0;
+  auto& account = mAccounts[index];
+  account.consecutiveRateLimits++;
+  if (msecs < 0) {
+    // no Retry-After: 1s, 2s, 4s, ... up to a minute
+    msecs = qMin<qint64>(kMaxBackoffMsecs, 1000LL << qMin(account.consecutiveRateLimits - 1, 6));
+  }
+  account.blockedUntil = qMax(account.blockedUntil, mClock.elapsed() + msecs);
+  // the bucket was obviously too optimistic
+  account.tokens = 0.0;
+  return msecs;
+}
+
+void CredentialPool::reportSuccess(int index)
+{
+  QMutexLocker locker(&mMutex);
+  if (index < 0 || index >= mAccounts.size()) return;
+  mAccounts[index].consecutiveRateLimits = 0;
+}
+
+QString CredentialPool::bearerToken(int account) const
+{
+  QMutexLocker locker(&mMutex);
+  const auto& entry = mAccounts.value(account);
+  if (entry.bearerTokenExpires > 0 && entry.bearerTokenExpires - kTokenRefreshMarginMsecs <= mClock.elapsed()) return QString();
+  return entry.bearerToken;
+}
+
+void CredentialPool::setBearerToken(int account, const QString& token, qint64 expiresInMsecs)
+{
+  QMutexLocker locker(&mMutex);
+  if (account < 0 || account >= mAccounts.size()) return;
+  mAccounts[account].bearerToken = token;
+  mAccounts[account].bearerTokenExpires = expiresInMsecs > 0 ? mClock.elapsed() + expiresInMsecs : 0;
+}
+
+void CredentialPool::invalidateBearerToken(int account, const QString& token)
+{
+  QMutexLocker locker(&mMutex);
+  if (account < 0 || account >= mAccounts.size() || mAccounts[account].bearerToken != token) return;
+  mAccounts[account].bearerToken.clear();
+  mAccounts[account].bearerTokenExpires = 0;
+}
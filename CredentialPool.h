@@ -0,0 +1,91 @@
+#pragma once
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+#include <memory>
+
+// Pool of Aspose cloud API credentials shared by all converters.
+// Every account has a token bucket matching its request quota and may be
+// blocked for a while after the service answered 429 (Too Many Requests).
+// Jobs are distributed over the accounts; a job stays on its account since
+// uploaded files live in the account's storage.
+//
+// Loaded from a JSON file (PPTX_CONVERTER_CREDENTIALS or credentials.json
+// next to the executable, there are no built-in credentials):
+// { "accounts": [ { "clientId": "...", "clientSecret": "...", "requestsPerSecond": 5, "burst": 10 } ] }
+
+class CredentialPool
+{
+public:
+  struct Credential {
+    QString clientId;
+    QString clientSecret;
+    double requestsPerSecond = 5.0;
+    int burst = 10;
+  };
+
+  // an account acquired for a job, released when the lease goes out of scope
+  class Lease
+  {
+  public:
+    Lease(std::shared_ptr<CredentialPool> pool, int account) : mPool(std::move(pool)), mAccount(account) {}
+    ~Lease() { if (mPool) mPool->releaseAccount(mAccount); }
+    Lease(const Lease&) = delete;
+    Lease& operator=(const Lease&) = delete;
+    int account() const { return mAccount; }
+
+  private:
+    std::shared_ptr<CredentialPool> mPool;
+    int mAccount;
+  };
+
+  // the process wide pool, loaded on first use
+  static std::shared_ptr<CredentialPool> instance();
+
+  CredentialPool();
+  bool load(const QString& path);
+  void addAccount(const Credential& credential);
+
+  int accountCount() const;
+  Credential credential(int account) const;
+
+  // pick the least busy, not blocked account for a new job, -1 if there is none
+  int acquireAccount();
+  // take the account with this client id (a resumed job needs its storage), -1 if unknown
+  int acquireAccount(const QString& clientId);
+  void releaseAccount(int account);
+
+  // take a request token: 0 if the request may be sent now, otherwise the ms to wait
+  qint64 tryAcquireRequest(int account);
+  // block the calling thread until a request token is available, for synchronous SDK calls
+  void waitForRequest(int account);
+  // the service answered 429, block the account for msecs (< 0: exponential backoff)
+  qint64 reportRateLimited(int account, qint64 msecs);
+  void reportSuccess(int account);
+
+  // the bearer token is per account and shared by all its jobs, empty once it expires within a minute
+  QString bearerToken(int account) const;
+  // expiresInMsecs <= 0: the service didn't say, the token is used until it is rejected
+  void setBearerToken(int account, const QString& token, qint64 expiresInMsecs = 0);
+  // the service rejected this token (401), unless another job refreshed it meanwhile
+  void invalidateBearerToken(int account, const QString& token);
+
+private:
+  struct Account {
+    Credential credential;
+    double tokens = 0.0;
+    qint64 lastRefill = 0;
+    qint64 blockedUntil = 0;
+    int consecutiveRateLimits = 0;
+    int activeJobs = 0;
+    QString bearerToken;
+    // on mClock, 0: unknown
+    qint64 bearerTokenExpires = 0;
+  };
+  void refill(Account& account, qint64 now);
+
+  mutable QMutex mMutex;
+  QElapsedTimer mClock;
+  QVector<Account> mAccounts;
+};
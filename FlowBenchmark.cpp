@@ -0,0 +1,115 @@
+#include "FlowBenchmark.h"
+#include "ConsoleLog.h"
+#include "FlowCostModel.h"
+#include "PresentationInspector.h"
+
+#include <QFileInfo>
+#include <QTimer>
+#include <algorithm>
+#include <vector>
+
+namespace {
+  qint64 median(QVector<qint64> values)
+  {
+    if (values.isEmpty()) return -1;
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+  }
+}
+
+FlowBenchmark::FlowBenchmark(const QStringList& decks, int runs, QObject* parent)
+  : QObject(parent)
+  , mDecks(decks)
+  , mRuns(std::max(1, runs))
+{
+  connect(&mConverter, &PowerPointConverter::processingDone, this, &FlowBenchmark::onConverterDone);
+  connect(&mConverter, &PowerPointConverter::error, this, &FlowBenchmark::onConverterError);
+  // every run must do the whole work and must not end up in the journal
+  mConverter.setJournalEnabled(false);
+  mConverter.setSlideStoreEnabled(false);
+}
+
+void FlowBenchmark::start()
+{
+  for (const auto& deck : mDecks) {
+    DeckResult result;
+    result.deck = QFileInfo(deck).fileName();
+    result.slides = PresentationInspector::inspect(deck).slideCount;
+    result.bytes = QFileInfo(deck).size();
+    mResults << result;
+  }
+  ConsoleLog::line(QString("Benchmark: %1 decks, %2 runs per flow").arg(mDecks.size()).arg(mRuns));
+  runNext();
+}
+
+void FlowBenchmark::runNext()
+{
+  mStep++;
+  if (mStep >= mDecks.size() * mRuns * 2) {
+    report();
+    return;
+  }
+  mStepDone = false;
+  const auto& deck = mDecks[mStep / (mRuns * 2)];
+  // the split flow must not reuse the deck uploaded by an earlier run
+  mConverter.setStorageManifestPath(mTargetDir.filePath(QString("storage_manifest_%1.json").arg(mStep)));
+  mTimer.start();
+  if (mStep % 2 == 0) mConverter.convertPowerpointFile(deck, mTargetDir.path());
+  else mConverter.convertPowerpointFile2(deck, mTargetDir.path());
+}
+
+void FlowBenchmark::onConverterDone(const QStringList& createdFiles)
+{
+  for (const auto& file : createdFiles) {
+    QFile::remove(file);
+  }
+  if (mStepDone) return;
+  mStepDone = true;
+  auto& result = mResults[mStep / (mRuns * 2)];
+  result.msecs[mStep % 2] << mTimer.elapsed();
+  ConsoleLog::line(QString("Benchmark: %1 %2: %3 ms").arg(result.deck).arg(mStep % 2 == 0 ? "split" : "convert").arg(mTimer.elapsed()));
+  // leave the converter's slot before starting the next job
+  QTimer::singleShot(0, this, &FlowBenchmark::runNext);
+}
+
+void FlowBenchmark::onConverterError(const QString& error)
+{
+  // a failure may report several errors, count the run once
+  if (mStepDone) return;
+  mStepDone = true;
+  mFailures++;
+  ConsoleLog::line(QString("Benchmark: run %1 failed: %2").arg(mStep + 1).arg(error));
+  QTimer::singleShot(0, this, &FlowBenchmark::runNext);
+}
+
+void FlowBenchmark::report()
+{
+  ConsoleLog::line("Benchmark: deck, slides, KB, split ms, convert ms, faster");
+  // slide count and faster flow of the decks converted with both flows
+  std::vector<std::pair<int, FlowCostModel::Flow>> measured;
+  for (const auto& result : mResults) {
+    const qint64 split = median(result.msecs[0]);
+    const qint64 convert = median(result.msecs[1]);
+    const QString faster = split < 0 || convert < 0 ? "-" : (split < convert ? "split" : "convert");
+    ConsoleLog::line(QString("Benchmark: %1, %2, %3, %4, %5, %6").arg(result.deck).arg(result.slides).arg(result.bytes / 1024).arg(split).arg(convert).arg(faster));
+    if (split >= 0 && convert >= 0) measured.emplace_back(result.slides, split < convert ? FlowCostModel::Flow::kSplit : FlowCostModel::Flow::kConvert);
+  }
+
+  if (measured.empty()) {
+    ConsoleLog::line("Benchmark: no deck was converted with both flows, no crossover");
+  }
+  else {
+    // walk down from the largest deck while its flow stays faster
+    std::sort(measured.begin(), measured.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+    const auto flow = measured.back().second;
+    auto first = measured.end();
+    while (first != measured.begin() && std::prev(first)->second == flow) --first;
+    const int crossover = first == measured.begin() ? 0 : first->first;
+    FlowCostModel::instance().recordCrossover(crossover, flow);
+    const QString flowName = flow == FlowCostModel::Flow::kSplit ? "split" : "convert";
+    if (crossover == 0) ConsoleLog::line(QString("Benchmark: the %1 flow is faster for all deck sizes").arg(flowName));
+    else ConsoleLog::line(QString("Benchmark: the %1 flow is faster from %2 slides on").arg(flowName).arg(crossover));
+  }
+  ConsoleLog::line(QString("Benchmark: %1 runs failed").arg(mFailures));
+  emit finished(mFailures == 0);
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <QObject>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QTemporaryDir>
+#include <QVector>
+#include "PowerPointConverter.h"
+
+// Benchmark of the two cloud flows (--benchmark-flows): converts every deck
+// with the split and the convert flow in turn, prints the median durations
+// per deck and stores the crossover of the medians (the slide count from
+// which the faster flow of the largest decks wins) in the FlowCostModel used
+// by the automatic selection. The finished jobs also become samples of the
+// model. Every run uses a fresh storage manifest, so both flows upload the
+// deck and the user's manifest stays untouched.
+
+class FlowBenchmark : public QObject
+{
+  Q_OBJECT
+
+public:
+  FlowBenchmark(const QStringList& decks, int runs, QObject* parent = nullptr);
+
+  // starts the first conversion, finished() is emitted at the end
+  void start();
+
+signals:
+  void finished(bool success);
+
+private slots:
+  void onConverterDone(const QStringList& createdFiles);
+  void onConverterError(const QString& error);
+
+private:
+  struct DeckResult {
+    QString deck;
+    int slides = 0;
+    qint64 bytes = 0;
+    // milliseconds of the successful runs per flow: split, convert
+    QVector<qint64> msecs[2];
+  };
+
+  void runNext();
+  void report();
+
+  QStringList mDecks;
+  int mRuns;
+  // deck = step / (2 * runs), the flows alternate
+  int mStep = -1;
+  bool mStepDone = true;
+  int mFailures = 0;
+  QVector<DeckResult> mResults;
+
+  PowerPointConverter mConverter;
+  QTemporaryDir mTargetDir;
+  QElapsedTimer mTimer;
+};
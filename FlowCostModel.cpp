@@ -0,0 +1,184 @@
+#include "FlowCostModel.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <algorithm>
+
+namespace {
+  // measured against api.aspose.cloud with 10 to 40 slide decks: the split flow
+  // has more round trips, the convert flow renders and zips all slides before the first byte
+  const double kDefaultFixedMsecs[] = { 4000, 2500 };
+  const double kDefaultMsecsPerSlide[] = { 400, 700 };
+  const double kDefaultUploadBytesPerMsec = 1000;
+  // jobs kept per flow, and needed before the fit replaces the defaults
+  const int kMaxSamples = 32;
+  const int kMinSamples = 3;
+  // weight of the latest upload in the live throughput
+  const double kThroughputWeight = 0.3;
+
+  const char* flowName(FlowCostModel::Flow flow)
+  {
+    return flow == FlowCostModel::Flow::kSplit ? "split" : "convert";
+  }
+}
+
+FlowCostModel& FlowCostModel::instance()
+{
+  static FlowCostModel sInstance;
+  return sInstance;
+}
+
+FlowCostModel::FlowCostModel(const QString& path)
+  : mPath(path)
+  , mUploadBytesPerMsec(kDefaultUploadBytesPerMsec)
+{
+  if (mPath.isEmpty()) {
+    mPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/flow_costs.json";
+  }
+  load();
+}
+
+FlowCostModel::Coefficients FlowCostModel::fit(Flow flow) const
+{
+  const int index = static_cast<int>(flow);
+  Coefficients defaults;
+  defaults.fixedMsecs = kDefaultFixedMsecs[index];
+  defaults.msecsPerSlide = kDefaultMsecsPerSlide[index];
+  const auto& samples = mSamples[index];
+  if (samples.size() < kMinSamples) return defaults;
+
+  // the upload is predicted from the live throughput, fit the rest
+  double sumX = 0, sumY = 0, sumXX = 0, sumXY = 0;
+  for (const auto& sample : samples) {
+    const double x = sample.slides;
+    const double y = sample.msecs - sample.uploadBytes / mUploadBytesPerMsec;
+    sumX += x;
+    sumY += y;
+    sumXX += x * x;
+    sumXY += x * y;
+  }
+  const double n = samples.size();
+  const double variance = sumXX - sumX * sumX / n;
+  Coefficients coefficients;
+  if (variance < 1.0) {
+    // all jobs had the same slide count: keep the default slope through their mean
+    coefficients.msecsPerSlide = defaults.msecsPerSlide;
+  }
+  else {
+    coefficients.msecsPerSlide = std::max(0.0, (sumXY - sumX * sumY / n) / variance);
+  }
+  coefficients.fixedMsecs = std::max(0.0, (sumY - coefficients.msecsPerSlide * sumX) / n);
+  return coefficients;
+}
+
+double FlowCostModel::predict(Flow flow, int slides, qint64 uploadBytes) const
+{
+  QMutexLocker locker(&mMutex);
+  const auto coefficients = fit(flow);
+  return coefficients.fixedMsecs + coefficients.msecsPerSlide * slides + uploadBytes / mUploadBytesPerMsec;
+}
+
+FlowCostModel::Flow FlowCostModel::choose(int slides, qint64 splitUploadBytes, qint64 convertUploadBytes) const
+{
+  {
+    QMutexLocker locker(&mMutex);
+    // the benchmark measured both flows uploading the deck
+    if (mMeasuredCrossover >= 0 && splitUploadBytes == convertUploadBytes) {
+      if (slides >= mMeasuredCrossover) return mMeasuredFlow;
+      return mMeasuredFlow == Flow::kSplit ? Flow::kConvert : Flow::kSplit;
+    }
+  }
+  return predict(Flow::kSplit, slides, splitUploadBytes) < predict(Flow::kConvert, slides, convertUploadBytes) ? Flow::kSplit : Flow::kConvert;
+}
+
+void FlowCostModel::recordJob(Flow flow, int slides, qint64 uploadBytes, qint64 msecs)
+{
+  QMutexLocker locker(&mMutex);
+  auto& samples = mSamples[static_cast<int>(flow)];
+  Sample sample;
+  sample.slides = slides;
+  sample.uploadBytes = uploadBytes;
+  sample.msecs = msecs;
+  samples << sample;
+  if (samples.size() > kMaxSamples) samples.removeFirst();
+  save();
+}
+
+void FlowCostModel::recordUpload(qint64 bytes, qint64 msecs)
+{
+  if (bytes <= 0 || msecs <= 0) return;
+  QMutexLocker locker(&mMutex);
+  mUploadBytesPerMsec = (1 - kThroughputWeight) * mUploadBytesPerMsec + kThroughputWeight * bytes / static_cast<double>(msecs);
+}
+
+void FlowCostModel::recordCrossover(int slides, Flow flow)
+{
+  QMutexLocker locker(&mMutex);
+  mMeasuredCrossover = std::max(0, slides);
+  mMeasuredFlow = flow;
+  mMeasuredAt = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+  save();
+}
+
+void FlowCostModel::load()
+{
+  QFile file(mPath);
+  if (!file.open(QIODevice::ReadOnly)) return;
+  const auto object = QJsonDocument::fromJson(file.readAll()).object();
+  for (auto flow : { Flow::kSplit, Flow::kConvert }) {
+    for (const auto& value : object[flowName(flow)].toArray()) {
+      const auto entry = value.toObject();
+      Sample sample;
+      sample.slides = entry["slides"].toInt();
+      sample.uploadBytes = static_cast<qint64>(entry["uploadBytes"].toDouble());
+      sample.msecs = static_cast<qint64>(entry["msecs"].toDouble());
+      mSamples[static_cast<int>(flow)] << sample;
+    }
+  }
+  mUploadBytesPerMsec = object["uploadBytesPerMsec"].toDouble(kDefaultUploadBytesPerMsec);
+  const auto crossover = object["crossover"].toObject();
+  // written by older versions from the fitted lines, without the flow
+  if (crossover.contains("flow")) {
+    mMeasuredCrossover = crossover["slides"].toInt(-1);
+    mMeasuredFlow = crossover["flow"].toString() == flowName(Flow::kConvert) ? Flow::kConvert : Flow::kSplit;
+    mMeasuredAt = crossover["measured"].toString();
+  }
+}
+
+void FlowCostModel::save() const
+{
+  QJsonObject object;
+  for (auto flow : { Flow::kSplit, Flow::kConvert }) {
+    QJsonArray samples;
+    for (const auto& sample : mSamples[static_cast<int>(flow)]) {
+      QJsonObject entry;
+      entry["slides"] = sample.slides;
+      entry["uploadBytes"] = static_cast<double>(sample.uploadBytes);
+      entry["msecs"] = static_cast<double>(sample.msecs);
+      samples << entry;
+    }
+    object[flowName(flow)] = samples;
+  }
+  object["uploadBytesPerMsec"] = mUploadBytesPerMsec;
+  if (mMeasuredCrossover >= 0) {
+    QJsonObject crossover;
+    crossover["slides"] = mMeasuredCrossover;
+    crossover["flow"] = flowName(mMeasuredFlow);
+    crossover["measured"] = mMeasuredAt;
+    object["crossover"] = crossover;
+  }
+
+  QDir().mkpath(QFileInfo(mPath).absolutePath());
+  QSaveFile file(mPath);
+  if (!file.open(QIODevice::WriteOnly)) return;
+  file.write(QJsonDocument(object).toJson());
+  file.commit();
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+// Expected duration of the two cloud flows for the automatic flow selection:
+// a fixed cost plus a cost per slide, fitted by least squares to the last
+// finished jobs of each flow, plus the bytes the flow uploads at the live
+// upload throughput (the split flow uploads nothing for a deck already in
+// storage). Until a flow has enough jobs the pre-measured defaults are used.
+// Kept in flow_costs.json in the application data folder, together with the
+// crossover measured by the flow benchmark (--benchmark-flows), which decides
+// over the fitted lines while both flows upload the deck.
+
+class FlowCostModel
+{
+public:
+  enum class Flow {
+    kSplit,   // upload, split, download every slide
+    kConvert, // one request returning a ZIP
+  };
+
+  // the shared model of the process
+  static FlowCostModel& instance();
+
+  // defaults to flow_costs.json in the application data folder
+  explicit FlowCostModel(const QString& path = QString());
+
+  // expected milliseconds of a job uploading uploadBytes
+  double predict(Flow flow, int slides, qint64 uploadBytes) const;
+  // the flow expected to be faster, given the bytes each flow has to upload
+  Flow choose(int slides, qint64 splitUploadBytes, qint64 convertUploadBytes) const;
+
+  // a finished job with the bytes it actually uploaded, and a finished upload for the live throughput
+  void recordJob(Flow flow, int slides, qint64 uploadBytes, qint64 msecs);
+  void recordUpload(qint64 bytes, qint64 msecs);
+
+  // persist the benchmark result: flow is faster for decks of slides and more
+  // slides, the other one for smaller decks (slides 0: faster for all decks)
+  void recordCrossover(int slides, Flow flow);
+
+private:
+  struct Sample {
+    int slides = 0;
+    qint64 uploadBytes = 0;
+    qint64 msecs = 0;
+  };
+
+  struct Coefficients {
+    double fixedMsecs = 0;
+    double msecsPerSlide = 0;
+  };
+
+  Coefficients fit(Flow flow) const;
+  void load();
+  void save() const;
+
+  mutable QMutex mMutex;
+  QString mPath;
+  QVector<Sample> mSamples[2];
+  double mUploadBytesPerMsec;
+  // -1 until the benchmark ran
+  int mMeasuredCrossover = -1;
+  Flow mMeasuredFlow = Flow::kSplit;
+  QString mMeasuredAt;
+};
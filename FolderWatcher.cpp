@@ -0,0 +1,245 @@
+#include "FolderWatcher.h"
+#include "ConsoleLog.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+namespace {
+  // a file must be unchanged this long before it is taken
+  const int kSettleMsecs = 2000;
+  const int kSettleCheckMsecs = 500;
+  // change notifications are unreliable on network shares, scan regularly as well
+  const int kRescanMsecs = 30 * 1000;
+  const int kConversionDeadlineMsecs = 120 * 1000;
+
+  bool isTerminal(PowerPointConverter::PowerPointConverterStatus status)
+  {
+    return status == PowerPointConverter::PowerPointConverterStatus::kFinishedConversion
+      || status == PowerPointConverter::PowerPointConverterStatus::kFailure
+      || status == PowerPointConverter::PowerPointConverterStatus::kCancelled;
+  }
+
+  QByteArray hashOfFile(QFile& file)
+  {
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    if (!hash.addData(&file)) return QByteArray();
+    return hash.result().toHex();
+  }
+}
+
+FolderWatcher::FolderWatcher(QObject* parent)
+  : QObject(parent)
+{
+  mClock.start();
+  mManifestPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/watch_manifest.json";
+
+  connect(&mWatcher, &QFileSystemWatcher::directoryChanged, this, &FolderWatcher::onDirectoryChanged);
+  mSettleTimer.setInterval(kSettleCheckMsecs);
+  connect(&mSettleTimer, &QTimer::timeout, this, &FolderWatcher::onSettleTimer);
+  mRescanTimer.setInterval(kRescanMsecs);
+  connect(&mRescanTimer, &QTimer::timeout, this, [this]() {
+    for (const auto& folder : mFolderPriorities.keys()) scanFolder(folder);
+  });
+
+  connect(&mConverter, &PowerPointConverter::statusChanged, this, &FolderWatcher::onConverterStatusChanged);
+  connect(&mConverter, &PowerPointConverter::error, this, &FolderWatcher::onConverterError);
+  mConverter.setConversionDeadline(kConversionDeadlineMsecs);
+}
+
+bool FolderWatcher::addFolder(const QString& folder, int priority)
+{
+  const auto path = QFileInfo(folder).absoluteFilePath();
+  if (!QFileInfo(path).isDir() || !mWatcher.addPath(path)) {
+    ConsoleLog::timedLine(QString("Watch: can't watch folder '%1'").arg(folder));
+    return false;
+  }
+  mFolderPriorities[path] = priority;
+  ConsoleLog::timedLine(QString("Watch: '%1' with priority %2").arg(path).arg(priority));
+  return true;
+}
+
+void FolderWatcher::start()
+{
+  loadManifest();
+  // decks interrupted by a crash first, they are known by the journal
+  mConverter.resumeUnfinishedJobs();
+  for (const auto& folder : mFolderPriorities.keys()) scanFolder(folder);
+  mRescanTimer.start();
+}
+
+void FolderWatcher::onDirectoryChanged(const QString& folder)
+{
+  scanFolder(folder);
+}
+
+void FolderWatcher::scanFolder(const QString& folder)
+{
+  const int priority = mFolderPriorities.value(folder);
+  const qint64 now = mClock.elapsed();
+  const auto files = QDir(folder).entryInfoList(QStringList() << "*.pptx", QDir::Files);
+  for (const auto& fileInfo : files) {
+    // lock files of open presentations
+    if (fileInfo.fileName().startsWith("~$")) continue;
+    const auto path = fileInfo.absoluteFilePath();
+    const qint64 size = fileInfo.size();
+    const qint64 modified = fileInfo.lastModified().toMSecsSinceEpoch();
+    auto taken = mTaken.find(path);
+    if (taken != mTaken.end() && taken->second == std::make_pair(size, modified)) continue;
+
+    auto& candidate = mCandidates[path];
+    if (candidate.size != size || candidate.modified != modified) {
+      // new or still being written, wait again
+      candidate.size = size;
+      candidate.modified = modified;
+      candidate.stableSince = now;
+    }
+    candidate.priority = priority;
+  }
+  if (!mCandidates.empty() && !mSettleTimer.isActive()) mSettleTimer.start();
+}
+
+void FolderWatcher::onSettleTimer()
+{
+  const qint64 now = mClock.elapsed();
+  for (auto iter = mCandidates.begin(); iter != mCandidates.end();) {
+    const auto& path = iter->first;
+    auto& candidate = iter->second;
+    QFileInfo fileInfo(path);
+    if (!fileInfo.exists()) {
+      iter = mCandidates.erase(iter);
+      continue;
+    }
+    const qint64 size = fileInfo.size();
+    const qint64 modified = fileInfo.lastModified().toMSecsSinceEpoch();
+    if (size != candidate.size || modified != candidate.modified) {
+      candidate.size = size;
+      candidate.modified = modified;
+      candidate.stableSince = now;
+    }
+    if (size == 0 || now - candidate.stableSince < kSettleMsecs) {
+      ++iter;
+      continue;
+    }
+    // the writer may still hold the file open exclusively
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+      ++iter;
+      continue;
+    }
+    const auto hash = hashOfFile(file);
+    if (hash.isEmpty()) {
+      ++iter;
+      continue;
+    }
+    mTaken[path] = std::make_pair(size, modified);
+    enqueue(path, hash, candidate.priority);
+    iter = mCandidates.erase(iter);
+  }
+  if (mCandidates.empty()) mSettleTimer.stop();
+  startNextDeck();
+}
+
+void FolderWatcher::enqueue(const QString& path, const QByteArray& hash, int priority)
+{
+  auto converted = mConverted.constFind(hash);
+  if (converted != mConverted.constEnd()) {
+    ConsoleLog::timedLine(QString("Watch: '%1' is unchanged, slides are in '%2'").arg(path).arg(converted.value()));
+    return;
+  }
+  if (mQueuedHashes.contains(hash)) {
+    ConsoleLog::timedLine(QString("Watch: '%1' has the same content as a queued deck, skipped").arg(path));
+    return;
+  }
+  QueuedDeck deck;
+  deck.path = path;
+  deck.hash = hash;
+  deck.priority = priority;
+  deck.sequence = mNextSequence++;
+  mQueue.push(deck);
+  mQueuedHashes.insert(hash);
+  ConsoleLog::timedLine(QString("Watch: queued '%1' (priority %2, %3 waiting)").arg(path).arg(priority).arg(mQueue.size()));
+}
+
+void FolderWatcher::startNextDeck()
+{
+  // the converter runs one job at a time, resumed jobs included
+  if (mRunning || !(mConverterStatus == PowerPointConverter::PowerPointConverterStatus::kNone || isTerminal(mConverterStatus))) return;
+  if (mQueue.empty()) return;
+
+  mRunningDeck = mQueue.top();
+  mQueue.pop();
+  QFileInfo fileInfo(mRunningDeck.path);
+  mRunningTarget = fileInfo.absolutePath() + "/converted/" + fileInfo.completeBaseName();
+  mRunning = true;
+  // the next decks are uploaded together with this one
+  QStringList nextDecks;
+  auto queue = mQueue;
+  while (!queue.empty() && nextDecks.size() < 8) {
+    nextDecks << queue.top().path;
+    queue.pop();
+  }
+  mConverter.setBatchUploadCandidates(nextDecks);
+  ConsoleLog::timedLine(QString("Watch: converting '%1' into '%2'").arg(mRunningDeck.path).arg(mRunningTarget));
+  mConverter.convertPowerpointFile(mRunningDeck.path, mRunningTarget);
+}
+
+void FolderWatcher::onConverterStatusChanged(const PowerPointConverter::PowerPointConverterStatus& status)
+{
+  mConverterStatus = status;
+  if (!isTerminal(status)) return;
+
+  if (mRunning) {
+    mRunning = false;
+    mQueuedHashes.remove(mRunningDeck.hash);
+    if (status == PowerPointConverter::PowerPointConverterStatus::kFinishedConversion) {
+      mConverted[mRunningDeck.hash] = mRunningTarget;
+      saveManifest();
+      ConsoleLog::timedLine(QString("Watch: converted '%1'").arg(mRunningDeck.path));
+    }
+    else {
+      // taken again once the file changes
+      ConsoleLog::timedLine(QString("Watch: conversion of '%1' failed").arg(mRunningDeck.path));
+    }
+  }
+  // leave the converter's call stack before starting the next job
+  QTimer::singleShot(0, this, &FolderWatcher::startNextDeck);
+}
+
+void FolderWatcher::onConverterError(const QString& error)
+{
+  ConsoleLog::timedLine(QString("Watch: converter error: %1").arg(error));
+}
+
+void FolderWatcher::loadManifest()
+{
+  mConverted.clear();
+  QFile file(mManifestPath);
+  if (!file.open(QIODevice::ReadOnly)) return;
+  auto converted = QJsonDocument::fromJson(file.readAll()).object()["converted"].toObject();
+  for (auto iter = converted.begin(); iter != converted.end(); ++iter) {
+    mConverted.insert(iter.key().toLatin1(), iter.value().toString());
+  }
+}
+
+void FolderWatcher::saveManifest() const
+{
+  QJsonObject converted;
+  for (auto iter = mConverted.begin(); iter != mConverted.end(); ++iter) {
+    converted[QString::fromLatin1(iter.key())] = iter.value();
+  }
+  QJsonObject object;
+  object["converted"] = converted;
+
+  QDir().mkpath(QFileInfo(mManifestPath).absolutePath());
+  QSaveFile file(mManifestPath);
+  if (!file.open(QIODevice::WriteOnly)) return;
+  file.write(QJsonDocument(object).toJson());
+  file.commit();
+}
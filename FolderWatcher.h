@@ -0,0 +1,91 @@
+#pragma once
+#include <QObject>
+#include <QElapsedTimer>
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QSet>
+#include <QTimer>
+#include <map>
+#include <queue>
+#include <vector>
+#include "PowerPointConverter.h"
+
+// Daemon mode: watches folders for dropped presentations and converts them
+// in the cloud, one after the other, into <folder>/converted/<name>.
+// A file is taken once its size and modification time stayed the same for a
+// while and it can be opened (copies in progress are skipped). Decks with the
+// same content (SHA-256) are converted once; the converted hashes are kept in
+// watch_manifest.json in the application data folder. Decks of folders with a
+// higher priority go first, otherwise in order of arrival.
+
+class FolderWatcher : public QObject
+{
+  Q_OBJECT
+
+public:
+  explicit FolderWatcher(QObject* parent = nullptr);
+
+  // watch a folder (not recursive), higher priorities are converted first
+  bool addFolder(const QString& folder, int priority);
+  // resume unfinished jobs and convert the decks already in the folders
+  void start();
+
+private slots:
+  void onDirectoryChanged(const QString& folder);
+  void onSettleTimer();
+  void onConverterStatusChanged(const PowerPointConverter::PowerPointConverterStatus& status);
+  void onConverterError(const QString& error);
+
+private:
+  struct Candidate {
+    qint64 size = -1;
+    qint64 modified = 0;
+    qint64 stableSince = 0;
+    int priority = 0;
+  };
+
+  struct QueuedDeck {
+    QString path;
+    QByteArray hash;
+    int priority = 0;
+    quint64 sequence = 0;
+  };
+
+  // highest priority first, then first come first served
+  struct DeckOrder {
+    bool operator()(const QueuedDeck& a, const QueuedDeck& b) const
+    {
+      if (a.priority != b.priority) return a.priority < b.priority;
+      return a.sequence > b.sequence;
+    }
+  };
+
+  void scanFolder(const QString& folder);
+  void enqueue(const QString& path, const QByteArray& hash, int priority);
+  void startNextDeck();
+  void loadManifest();
+  void saveManifest() const;
+
+  QFileSystemWatcher mWatcher;
+  QHash<QString, int> mFolderPriorities;
+  QTimer mSettleTimer;
+  QTimer mRescanTimer;
+  QElapsedTimer mClock;
+
+  // files waiting to settle, and the size and modification time of the files already taken
+  std::map<QString, Candidate> mCandidates;
+  std::map<QString, std::pair<qint64, qint64>> mTaken;
+
+  std::priority_queue<QueuedDeck, std::vector<QueuedDeck>, DeckOrder> mQueue;
+  quint64 mNextSequence = 0;
+  QSet<QByteArray> mQueuedHashes;
+  // content hash -> folder of the converted slides
+  QHash<QByteArray, QString> mConverted;
+  QString mManifestPath;
+
+  PowerPointConverter mConverter;
+  PowerPointConverter::PowerPointConverterStatus mConverterStatus = PowerPointConverter::PowerPointConverterStatus::kNone;
+  bool mRunning = false;
+  QueuedDeck mRunningDeck;
+  QString mRunningTarget;
+};
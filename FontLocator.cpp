@@ -0,0 +1,118 @@
+#include "FontLocator.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QSet>
+#include <QStandardPaths>
+#include <QtConcurrent>
+#include <QtEndian>
+
+namespace {
+  quint16 read16(const uchar* p) { return qFromBigEndian<quint16>(p); }
+  quint32 read32(const uchar* p) { return qFromBigEndian<quint32>(p); }
+
+  // family names (name id 1 and 16) of the font at the given offset table
+  void readFamilies(const uchar* data, qint64 size, qint64 fontOffset, QSet<QString>& families)
+  {
+    if (fontOffset + 12 > size) return;
+    const quint16 numTables = read16(data + fontOffset + 4);
+    for (int i = 0; i < numTables; ++i) {
+      const qint64 record = fontOffset + 12 + i * 16;
+      if (record + 16 > size) return;
+      if (read32(data + record) != 0x6E616D65 /* 'name' */) continue;
+
+      const qint64 table = read32(data + record + 8);
+      if (table + 6 > size) return;
+      const quint16 count = read16(data + table + 2);
+      const qint64 strings = table + read16(data + table + 4);
+      for (int n = 0; n < count; ++n) {
+        const uchar* name = data + table + 6 + n * 12;
+        if (name + 12 > data + size) return;
+        const quint16 platform = read16(name);
+        const quint16 encoding = read16(name + 2);
+        const quint16 nameId = read16(name + 6);
+        const quint16 length = read16(name + 8);
+        const qint64 offset = strings + read16(name + 10);
+        if ((nameId != 1 && nameId != 16) || offset + length > size) continue;
+
+        if (platform == 3 || platform == 0) {
+          // UTF-16 big endian
+          QString family;
+          for (int c = 0; c + 1 < length; c += 2) family.append(QChar(read16(data + offset + c)));
+          if (!family.isEmpty()) families.insert(family);
+        }
+        else if (platform == 1 && encoding == 0) {
+          families.insert(QString::fromLatin1(reinterpret_cast<const char*>(data + offset), length));
+        }
+      }
+      return;
+    }
+  }
+}
+
+FontLocator::FontLocator(const QStringList& fontFolders)
+  : mFontFolders(fontFolders)
+{
+  if (mFontFolders.isEmpty()) {
+    mFontFolders = QStandardPaths::standardLocations(QStandardPaths::FontsLocation);
+#ifdef Q_OS_WIN
+    // fonts installed for the current user only
+    mFontFolders << QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation) + "/Microsoft/Windows/Fonts";
+#endif
+  }
+}
+
+QFuture<void> FontLocator::index()
+{
+  if (!mIndexStarted) {
+    mIndexStarted = true;
+    mFamilyFiles = QtConcurrent::run(&FontLocator::buildIndex, mFontFolders);
+  }
+  return mFamilyFiles;
+}
+
+QStringList FontLocator::filesForFamily(const QString& family)
+{
+  index();
+  return mFamilyFiles.result().value(family.toLower());
+}
+
+QStringList FontLocator::familiesInFile(const QString& filepath)
+{
+  QSet<QString> families;
+  QFile file(filepath);
+  if (!file.open(QIODevice::ReadOnly)) return QStringList();
+  const qint64 size = file.size();
+  const uchar* data = size >= 12 ? file.map(0, size) : nullptr;
+  if (!data) return QStringList();
+
+  if (read32(data) == 0x74746366 /* 'ttcf' collection */) {
+    const quint32 numFonts = read32(data + 8);
+    for (quint32 i = 0; i < numFonts && 12 + (i + 1) * 4 <= size; ++i) {
+      readFamilies(data, size, read32(data + 12 + i * 4), families);
+    }
+  }
+  else {
+    readFamilies(data, size, 0, families);
+  }
+  file.unmap(const_cast<uchar*>(data));
+  return families.values();
+}
+
+QHash<QString, QStringList> FontLocator::buildIndex(const QStringList& fontFolders)
+{
+  QHash<QString, QStringList> familyFiles;
+  const QStringList filters = { "*.ttf", "*.otf", "*.ttc" };
+  for (const auto& folder : fontFolders) {
+    QDirIterator iter(folder, filters, QDir::Files, QDirIterator::Subdirectories);
+    while (iter.hasNext()) {
+      const QString filepath = iter.next();
+      for (const auto& family : familiesInFile(filepath)) {
+        auto& files = familyFiles[family.toLower()];
+        if (!files.contains(filepath)) files << filepath;
+      }
+    }
+  }
+  return familyFiles;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <QFuture>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+// Maps font family names (as referenced by PPTX typeface attributes) to the
+// local font files providing them. The font folders are indexed once by
+// reading the 'name' table of every TTF/OTF/TTC file, on the global thread
+// pool: a first scan of a large font folder takes seconds. Wait for index()
+// before asking for families to not block the calling thread.
+
+class FontLocator
+{
+public:
+  // defaults to the system (and on Windows the per user) font folders
+  explicit FontLocator(const QStringList& fontFolders = QStringList());
+
+  // starts indexing on first call, finished once the families can be looked up
+  QFuture<void> index();
+  // all files of a family (regular, bold, italic, ...), empty if not installed;
+  // blocks until the index is built
+  QStringList filesForFamily(const QString& family);
+  // the families provided by a single font file
+  static QStringList familiesInFile(const QString& filepath);
+
+private:
+  // lower case family name -> font files
+  static QHash<QString, QStringList> buildIndex(const QStringList& fontFolders);
+
+  QStringList mFontFolders;
+  bool mIndexStarted = false;
+  QFuture<QHash<QString, QStringList>> mFamilyFiles;
+};
@@ -0,0 +1,304 @@
+#include "FrameBufferPool.h"
+#include "Metrics.h"
+
+#include <QBuffer>
+#include <QImageReader>
+#include <QMutexLocker>
+#include <algorithm>
+#include <climits>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+namespace {
+  // smaller buffers are cheap for the allocator, pooling them is not worth it
+  const size_t kMinBufferBytes = 64 * 1024;
+  const size_t kHugePageBytes = 2 * 1024 * 1024;
+  // recycled arrays waiting for their other copies to go, older ones are dropped
+  const size_t kMaxSharedBytes = 64;
+
+  struct PoolMetrics {
+    MetricsRegistry& registry = MetricsRegistry::instance();
+    Counter& hits = registry.counter("pptx_converter_buffer_pool_total", "Buffers borrowed from the frame buffer pool", "result=\"hit\"");
+    Counter& misses = registry.counter("pptx_converter_buffer_pool_total", "Buffers borrowed from the frame buffer pool", "result=\"miss\"");
+    Gauge& inUse = registry.gauge("pptx_converter_buffer_pool_in_use_bytes", "Pixel memory borrowed from the frame buffer pool");
+    Gauge& idle = registry.gauge("pptx_converter_buffer_pool_idle_bytes", "Idle memory kept by the frame buffer pool");
+    Gauge& peak = registry.gauge("pptx_converter_buffer_pool_peak_bytes", "Most memory held by the frame buffer pool at any time");
+  };
+
+  PoolMetrics& metrics()
+  {
+    static PoolMetrics sMetrics;
+    return sMetrics;
+  }
+
+#ifdef Q_OS_WIN
+  // large pages need SeLockMemoryPrivilege enabled in the process token,
+  // returns the large page size or 0 if the account lacks the right
+  size_t enableLargePages()
+  {
+    const size_t pageSize = GetLargePageMinimum();
+    if (pageSize == 0) return 0;
+    HANDLE token = nullptr;
+    if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token)) return 0;
+    TOKEN_PRIVILEGES privileges = {};
+    privileges.PrivilegeCount = 1;
+    privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+    bool enabled = LookupPrivilegeValueW(nullptr, SE_LOCK_MEMORY_NAME, &privileges.Privileges[0].Luid)
+      && AdjustTokenPrivileges(token, FALSE, &privileges, 0, nullptr, nullptr)
+      && GetLastError() == ERROR_SUCCESS;
+    CloseHandle(token);
+    return enabled ? pageSize : 0;
+  }
+#endif
+}
+
+FrameBufferPool& FrameBufferPool::instance()
+{
+  static FrameBufferPool sInstance;
+  return sInstance;
+}
+
+FrameBufferPool::FrameBufferPool(qint64 idleBudgetBytes)
+  : mIdleBudgetBytes(idleBudgetBytes)
+{
+}
+
+FrameBufferPool::~FrameBufferPool()
+{
+  // pooled images must not outlive the pool, the idle blocks are freed here
+  for (const auto& idle : mIdle) deallocate(idle.second);
+}
+
+size_t FrameBufferPool::sizeClass(size_t size)
+{
+  // powers of two and the steps halfway between: at most a third is wasted
+  size = std::max(size, kMinBufferBytes);
+  size_t power = kMinBufferBytes;
+  while (power < size) power *= 2;
+  const size_t step = power / 2 + power / 4;
+  return size <= step ? step : power;
+}
+
+FrameBufferPool::Block FrameBufferPool::allocate(size_t size)
+{
+  Block block;
+#ifdef Q_OS_WIN
+  static const size_t sLargePageBytes = enableLargePages();
+  if (sLargePageBytes && size >= sLargePageBytes) {
+    const size_t rounded = (size + sLargePageBytes - 1) / sLargePageBytes * sLargePageBytes;
+    block.data = VirtualAlloc(nullptr, rounded, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+    if (block.data) block.size = rounded;
+  }
+  if (!block.data) {
+    // large pages fail when physical memory is fragmented, fall back to normal pages
+    block.data = VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    block.size = size;
+  }
+#else
+  void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (data != MAP_FAILED) {
+    block.data = data;
+    block.size = size;
+#ifdef MADV_HUGEPAGE
+    // transparent huge pages, a hint the kernel may ignore
+    if (size >= kHugePageBytes) madvise(data, size, MADV_HUGEPAGE);
+#endif
+  }
+#endif
+  return block;
+}
+
+void FrameBufferPool::deallocate(const Block& block)
+{
+#ifdef Q_OS_WIN
+  VirtualFree(block.data, 0, MEM_RELEASE);
+#else
+  munmap(block.data, block.size);
+#endif
+}
+
+QImage FrameBufferPool::image(int width, int height, QImage::Format format)
+{
+  if (width <= 0 || height <= 0 || format == QImage::Format_Invalid) return QImage();
+  // QImage needs 32 bit aligned lines
+  const int bitsPerPixel = QImage::toPixelFormat(format).bitsPerPixel();
+  const qint64 bytesPerLine = (static_cast<qint64>(width) * bitsPerPixel + 31) / 32 * 4;
+  if (bytesPerLine > INT_MAX) return QImage();
+  const size_t classSize = sizeClass(static_cast<size_t>(bytesPerLine) * height);
+
+  Block block;
+  {
+    QMutexLocker locker(&mMutex);
+    auto idle = mIdle.find(classSize);
+    if (idle != mIdle.end()) {
+      block = idle->second;
+      mIdle.erase(idle);
+      mStats.idleBytes -= block.size;
+    }
+  }
+  const bool hit = block.data != nullptr;
+  if (!hit) {
+    // the system call happens outside the lock
+    block = allocate(classSize);
+    if (!block.data) return QImage();
+    block.classSize = classSize;
+    block.pool = this;
+  }
+
+  QMutexLocker locker(&mMutex);
+  if (hit) {
+    ++mStats.hits;
+    metrics().hits.increment();
+  }
+  else {
+    ++mStats.misses;
+    metrics().misses.increment();
+  }
+  // map nodes are stable, the image keeps a pointer to its block
+  Block& borrowed = mBorrowed[block.data] = block;
+  mStats.inUseBytes += block.size;
+  updateMetricsLocked();
+  return QImage(static_cast<uchar*>(block.data), width, height, static_cast<int>(bytesPerLine), format, &FrameBufferPool::releaseImage, &borrowed);
+}
+
+QImage FrameBufferPool::decode(const QByteArray& data, const char* format)
+{
+  QBuffer buffer;
+  buffer.setData(data);
+  buffer.open(QIODevice::ReadOnly);
+  QImageReader reader(&buffer, format);
+  // the PNG handler decodes into an image of the right size and format in place
+  QImage image = this->image(reader.size().width(), reader.size().height(), reader.imageFormat());
+  if (image.isNull()) return reader.read();
+  if (!reader.read(&image)) return QImage();
+  return image;
+}
+
+void FrameBufferPool::releaseImage(void* info)
+{
+  const auto* block = static_cast<const Block*>(info);
+  block->pool->release(block->data);
+}
+
+void FrameBufferPool::release(void* data)
+{
+  QMutexLocker locker(&mMutex);
+  auto borrowed = mBorrowed.find(data);
+  if (borrowed == mBorrowed.end()) return;
+  const Block block = borrowed->second;
+  mBorrowed.erase(borrowed);
+  mStats.inUseBytes -= block.size;
+  mIdle.emplace(block.classSize, block);
+  mStats.idleBytes += block.size;
+  trimLocked(mIdleBudgetBytes);
+}
+
+QByteArray FrameBufferPool::bytes(int capacity)
+{
+  QByteArray data;
+  {
+    QMutexLocker locker(&mMutex);
+    adoptDetachedLocked();
+    // the smallest idle array big enough
+    auto best = mIdleBytes.lower_bound(capacity);
+    if (best != mIdleBytes.end()) {
+      data = std::move(best->second);
+      mIdleBytes.erase(best);
+      mStats.idleBytes -= data.capacity();
+      ++mStats.hits;
+      metrics().hits.increment();
+      updateMetricsLocked();
+    }
+    else {
+      ++mStats.misses;
+      metrics().misses.increment();
+    }
+  }
+  // a reserved capacity survives resizing down to nothing
+  if (data.capacity() == 0) data.reserve(static_cast<int>(std::min<size_t>(sizeClass(static_cast<size_t>(std::max(capacity, 0))), INT_MAX - 32)));
+  else data.reserve(data.capacity());
+  data.resize(0);
+  return data;
+}
+
+QByteArray FrameBufferPool::bytes(const System::SharedPtr<System::IO::MemoryStream>& stream)
+{
+  auto buffer = stream->GetBuffer();
+  const int length = static_cast<int>(stream->get_Length());
+  QByteArray data = bytes(length);
+  data.append(reinterpret_cast<const char*>(buffer->data_ptr()), length);
+  return data;
+}
+
+void FrameBufferPool::recycle(QByteArray&& data)
+{
+  if (static_cast<size_t>(data.capacity()) < kMinBufferBytes) return;
+  QMutexLocker locker(&mMutex);
+  adoptDetachedLocked();
+  if (!data.isDetached()) {
+    if (mSharedBytes.size() >= kMaxSharedBytes) mSharedBytes.erase(mSharedBytes.begin());
+    mSharedBytes.push_back(std::move(data));
+    return;
+  }
+  mStats.idleBytes += data.capacity();
+  const int capacity = data.capacity();
+  mIdleBytes.emplace(capacity, std::move(data));
+  trimLocked(mIdleBudgetBytes);
+}
+
+void FrameBufferPool::adoptDetachedLocked()
+{
+  for (auto shared = mSharedBytes.begin(); shared != mSharedBytes.end();) {
+    if (!shared->isDetached()) {
+      ++shared;
+      continue;
+    }
+    mStats.idleBytes += shared->capacity();
+    const int capacity = shared->capacity();
+    mIdleBytes.emplace(capacity, std::move(*shared));
+    shared = mSharedBytes.erase(shared);
+  }
+}
+
+FrameBufferPool::Stats FrameBufferPool::stats() const
+{
+  QMutexLocker locker(&mMutex);
+  return mStats;
+}
+
+void FrameBufferPool::trim()
+{
+  QMutexLocker locker(&mMutex);
+  trimLocked(0);
+}
+
+void FrameBufferPool::trimLocked(qint64 budget)
+{
+  // the biggest blocks go first, then the biggest byte arrays
+  while (mStats.idleBytes > budget && !mIdle.empty()) {
+    auto largest = std::prev(mIdle.end());
+    mStats.idleBytes -= largest->second.size;
+    deallocate(largest->second);
+    mIdle.erase(largest);
+  }
+  while (mStats.idleBytes > budget && !mIdleBytes.empty()) {
+    auto largest = std::prev(mIdleBytes.end());
+    mStats.idleBytes -= largest->first;
+    mIdleBytes.erase(largest);
+  }
+  if (budget == 0) mSharedBytes.clear();
+  updateMetricsLocked();
+}
+
+void FrameBufferPool::updateMetricsLocked()
+{
+  mStats.peakBytes = std::max(mStats.peakBytes, mStats.inUseBytes + mStats.idleBytes);
+  auto& poolMetrics = metrics();
+  poolMetrics.inUse.set(mStats.inUseBytes);
+  poolMetrics.idle.set(mStats.idleBytes);
+  poolMetrics.peak.set(mStats.peakBytes);
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include <QByteArray>
+#include <QImage>
+#include <QMutex>
+#include <cstddef>
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include <system/io/memory_stream.h>
+
+// Recycles the large buffers of the render, decode and download stages, so a
+// running conversion stops allocating (and page faulting) megabytes per slide.
+//
+// Pixel buffers are handed out as QImages whose memory returns to the pool
+// with the last copy of the image. Sizes are rounded up to size classes
+// (powers of two and the steps halfway between them), blocks of 2 MB and more
+// are backed by huge pages where the system allows it (large pages need the
+// "Lock pages in memory" right on Windows, transparent huge pages on Linux).
+// Encoded data (PNG, SVG) is recycled as QByteArrays with reserved capacity.
+//
+// Idle buffers are kept up to the budget, hits, misses and the peak are
+// exported as pptx_converter_buffer_pool_* metrics.
+
+class FrameBufferPool
+{
+public:
+  struct Stats {
+    quint64 hits = 0;
+    quint64 misses = 0;
+    // pixel memory borrowed right now
+    qint64 inUseBytes = 0;
+    // idle memory waiting for the next borrower
+    qint64 idleBytes = 0;
+    // the most memory (borrowed and idle) held at any time
+    qint64 peakBytes = 0;
+  };
+
+  // the shared pool of the process
+  static FrameBufferPool& instance();
+
+  explicit FrameBufferPool(qint64 idleBudgetBytes = 512 * 1024 * 1024);
+  // images borrowed from the pool must not outlive it
+  ~FrameBufferPool();
+
+  // an uninitialized image on pooled memory, null if the memory is exhausted
+  QImage image(int width, int height, QImage::Format format);
+  // decode data into a pooled image (format e.g. "PNG"), null on failure
+  QImage decode(const QByteArray& data, const char* format = nullptr);
+
+  // an empty byte array with at least capacity bytes reserved. Give it back
+  // with recycle(), copies still held elsewhere (e.g. by the file writer)
+  // keep it out of circulation until they are gone
+  QByteArray bytes(int capacity);
+  // the written part of an Aspose memory stream, copied into a pooled byte array
+  QByteArray bytes(const System::SharedPtr<System::IO::MemoryStream>& stream);
+  void recycle(QByteArray&& data);
+
+  Stats stats() const;
+  // free all idle buffers
+  void trim();
+
+private:
+  struct Block {
+    FrameBufferPool* pool = nullptr;
+    void* data = nullptr;
+    // allocated bytes, more than the size class if rounded to huge pages
+    size_t size = 0;
+    size_t classSize = 0;
+  };
+
+  static size_t sizeClass(size_t size);
+  // cleanup function of the pooled images, info is the borrowed Block
+  static void releaseImage(void* info);
+  static Block allocate(size_t size);
+  static void deallocate(const Block& block);
+  void release(void* data);
+  void trimLocked(qint64 budget);
+  // move the recycled arrays no longer shared to the idle ones
+  void adoptDetachedLocked();
+  void updateMetricsLocked();
+
+  const qint64 mIdleBudgetBytes;
+  mutable QMutex mMutex;
+  // idle blocks by size class
+  std::multimap<size_t, Block> mIdle;
+  std::unordered_map<void*, Block> mBorrowed;
+  // idle byte arrays by capacity
+  std::multimap<int, QByteArray> mIdleBytes;
+  // recycled while still shared, e.g. queued in the file writer: neither
+  // handed out nor counted as idle until the other copies are gone
+  std::vector<QByteArray> mSharedBytes;
+  Stats mStats;
+};
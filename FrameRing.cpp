@@ -0,0 +1,202 @@
+#include "FrameRing.h"
+#include "FrameBufferPool.h"
+#include "ImageKernels.h"
+
+#include <QMutexLocker>
+#include <QStringList>
+#include <algorithm>
+#include <climits>
+#include <new>
+
+namespace {
+  const int kDefaultSlotCount = 4;
+  const int kDefaultMaxWidth = 1920;
+  const int kDefaultMaxHeight = 1080;
+
+  uint64_t dataOffset(uint32_t slotCount)
+  {
+    return FrameRingLayout::segmentBytes(slotCount, 0);
+  }
+}
+
+std::shared_ptr<FrameRing> FrameRing::instance()
+{
+  static QMutex sInstanceMutex;
+  static std::shared_ptr<FrameRing> sInstance;
+  static bool sConfigured = false;
+  QMutexLocker locker(&sInstanceMutex);
+  if (!sConfigured) {
+    sConfigured = true;
+    // <key>[,<slots>[,<width>x<height>]]
+    const auto parts = qEnvironmentVariable("PPTX_CONVERTER_FRAME_RING").split(',');
+    if (parts.value(0).trimmed().isEmpty()) return nullptr;
+    const int slots = parts.size() > 1 ? parts[1].toInt() : kDefaultSlotCount;
+    const auto size = parts.value(2).split('x');
+    const int width = size.size() == 2 ? size[0].toInt() : kDefaultMaxWidth;
+    const int height = size.size() == 2 ? size[1].toInt() : kDefaultMaxHeight;
+    auto ring = std::make_shared<FrameRing>(parts[0].trimmed(), slots, width, height);
+    QString errorMessage;
+    if (!ring->create(&errorMessage)) {
+      qWarning("Frame ring '%s' not available: %s", qPrintable(parts[0]), qPrintable(errorMessage));
+      return nullptr;
+    }
+    sInstance = ring;
+  }
+  return sInstance;
+}
+
+FrameRing::FrameRing(const QString& key, int slotCount, int maxWidth, int maxHeight)
+  : mKey(key)
+  , mSlotCount(std::max(1, slotCount))
+  , mMaxWidth(std::max(1, maxWidth))
+  , mMaxHeight(std::max(1, maxHeight))
+{
+  mDecoder.setMaxThreadCount(1);
+}
+
+FrameRing::~FrameRing()
+{
+  // queued frames write into the segment
+  mDecoder.clear();
+  mDecoder.waitForDone();
+  if (mMemory.isAttached()) mMemory.detach();
+}
+
+bool FrameRing::create(QString* errorMessage)
+{
+  QMutexLocker locker(&mMutex);
+  // the native key is the mapping name consumers open without Qt
+  mMemory.setNativeKey(mKey);
+  const uint64_t slotBytes = static_cast<uint64_t>(mMaxWidth) * mMaxHeight * 4;
+  const uint64_t bytes = FrameRingLayout::segmentBytes(mSlotCount, slotBytes);
+  // QSharedMemory takes the size as int
+  if (bytes > static_cast<uint64_t>(INT_MAX)) {
+    if (errorMessage) *errorMessage = QString("%1 slots of %2x%3 need %4 MB, more than 2 GB").arg(mSlotCount).arg(mMaxWidth).arg(mMaxHeight).arg(bytes / (1024 * 1024));
+    return false;
+  }
+
+  if (mMemory.create(static_cast<int>(bytes))) {
+    // value initialized, all sequences and counters are 0
+    mHeader = new (mMemory.data()) FrameRingLayout::Header();
+    for (int i = 0; i < mSlotCount; ++i) {
+      new (&FrameRingLayout::slot(mHeader, i)) FrameRingLayout::SlotDescriptor();
+    }
+    mHeader->version = FrameRingLayout::kVersion;
+    mHeader->slotCount = mSlotCount;
+    mHeader->slotBytes = slotBytes;
+    mHeader->dataOffset = dataOffset(mSlotCount);
+    // consumers check the magic last
+    std::atomic_thread_fence(std::memory_order_release);
+    mHeader->magic = FrameRingLayout::kMagic;
+    return true;
+  }
+
+  // left by a previous run or kept alive by a consumer: reuse it if the layout matches
+  if (mMemory.error() != QSharedMemory::AlreadyExists || !mMemory.attach()) {
+    if (errorMessage) *errorMessage = mMemory.errorString();
+    return false;
+  }
+  auto* header = static_cast<FrameRingLayout::Header*>(mMemory.data());
+  if (static_cast<uint64_t>(mMemory.size()) < bytes || header->magic != FrameRingLayout::kMagic || header->version != FrameRingLayout::kVersion
+    || header->slotCount != static_cast<uint32_t>(mSlotCount) || header->slotBytes != slotBytes) {
+    mMemory.detach();
+    if (errorMessage) *errorMessage = "Segment exists with another layout";
+    return false;
+  }
+  mHeader = header;
+  mNextFrame = mHeader->latestFrame.load();
+  mGeneration = mHeader->generation.load();
+  return true;
+}
+
+QString FrameRing::key() const
+{
+  return mKey;
+}
+
+quint32 FrameRing::beginGeneration(int slideCount)
+{
+  QMutexLocker locker(&mMutex);
+  mSlideCount = slideCount;
+  mGeneration++;
+  if (mHeader) mHeader->generation.store(mGeneration, std::memory_order_release);
+  return mGeneration;
+}
+
+bool FrameRing::publishBgra(int slideIndex, const uchar* pixels, int width, int height, int stride)
+{
+  QMutexLocker locker(&mMutex);
+  return publishLocked(slideIndex, pixels, width, height, stride);
+}
+
+bool FrameRing::publishLocked(int slideIndex, const uchar* pixels, int width, int height, int stride)
+{
+  if (!mHeader || !pixels || width <= 0 || height <= 0) return false;
+
+  // fit into the slot keeping the aspect ratio
+  int frameWidth = width;
+  int frameHeight = height;
+  if (width > mMaxWidth || height > mMaxHeight) {
+    const double scale = std::min(static_cast<double>(mMaxWidth) / width, static_cast<double>(mMaxHeight) / height);
+    frameWidth = std::max(1, std::min(mMaxWidth, static_cast<int>(width * scale)));
+    frameHeight = std::max(1, std::min(mMaxHeight, static_cast<int>(height * scale)));
+  }
+
+  const uint32_t index = static_cast<uint32_t>(mNextFrame % mSlotCount);
+  auto& slot = FrameRingLayout::slot(mHeader, index);
+  const uint64_t sequence = slot.sequence.load(std::memory_order_relaxed);
+  // odd: readers drop what they read from this slot
+  slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  uint8_t* target = FrameRingLayout::pixels(mHeader, index);
+  const int targetStride = frameWidth * 4;
+  if (frameWidth == width && frameHeight == height) {
+    for (int y = 0; y < height; ++y) {
+      ImageKernels::swizzleRedBlue(pixels + static_cast<size_t>(stride) * y, target + static_cast<size_t>(targetStride) * y, width);
+    }
+  }
+  else {
+    ImageKernels::resample(pixels, width, height, stride, target, frameWidth, frameHeight, targetStride, ImageKernels::Filter::kBox);
+    ImageKernels::swizzleRedBlue(target, target, static_cast<size_t>(frameWidth) * frameHeight);
+  }
+
+  slot.frameNumber = mNextFrame;
+  slot.generation = mGeneration;
+  slot.slideIndex = static_cast<uint32_t>(slideIndex);
+  slot.slideCount = static_cast<uint32_t>(mSlideCount);
+  slot.width = static_cast<uint32_t>(frameWidth);
+  slot.height = static_cast<uint32_t>(frameHeight);
+  slot.stride = static_cast<uint32_t>(targetStride);
+  slot.format = FrameRingLayout::kFormatRgba8888;
+  slot.sequence.store(sequence + 2, std::memory_order_release);
+
+  mHeader->latestFrame.store(mNextFrame + 1, std::memory_order_release);
+  mNextFrame++;
+  return true;
+}
+
+bool FrameRing::publish(int slideIndex, const QImage& image)
+{
+  if (image.isNull()) return false;
+  // decoded PNGs are usually ARGB32 already, then this does not copy
+  const QImage argb = image.convertToFormat(QImage::Format_ARGB32);
+  return publishBgra(slideIndex, argb.constBits(), argb.width(), argb.height(), argb.bytesPerLine());
+}
+
+void FrameRing::publishPng(int slideIndex, const QByteArray& png)
+{
+  quint32 generation = 0;
+  {
+    QMutexLocker locker(&mMutex);
+    generation = mGeneration;
+  }
+  mDecoder.start([this, slideIndex, png, generation]() {
+    const QImage image = FrameBufferPool::instance().decode(png, "PNG").convertToFormat(QImage::Format_ARGB32);
+    if (image.isNull()) return;
+    QMutexLocker locker(&mMutex);
+    // the slide index belongs to the presentation of its generation
+    if (generation != mGeneration) return;
+    publishLocked(slideIndex, image.constBits(), image.width(), image.height(), image.bytesPerLine());
+  });
+}
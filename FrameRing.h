@@ -0,0 +1,56 @@
+#pragma once
+#include <QImage>
+#include <QMutex>
+#include <QSharedMemory>
+#include <QString>
+#include <QThreadPool>
+#include <memory>
+#include "FrameRingLayout.h"
+
+// Publishes rendered slides as raw RGBA frames into a shared memory ring
+// (see FrameRingLayout.h), so compositors read them in place instead of
+// decoding PNG files. Frames larger than a slot are scaled down to fit.
+// Downloaded PNGs are decoded on the ring's own thread, not the caller's.
+//
+// Enabled by PPTX_CONVERTER_FRAME_RING=<key>[,<slots>[,<width>x<height>]],
+// e.g. "pptx-frames,4,1920x1080" (the defaults).
+
+class FrameRing
+{
+public:
+  // the ring configured in the environment, nullptr if not configured or not available
+  static std::shared_ptr<FrameRing> instance();
+
+  FrameRing(const QString& key, int slotCount, int maxWidth, int maxHeight);
+  ~FrameRing();
+
+  // create the segment (or reuse one left with the same layout)
+  bool create(QString* errorMessage = nullptr);
+  QString key() const;
+
+  // a new presentation starts, returns its generation
+  quint32 beginGeneration(int slideCount);
+
+  // copy a frame with BGRA bytes (Aspose Format32bppArgb, QImage::Format_ARGB32) into the next slot
+  bool publishBgra(int slideIndex, const uchar* pixels, int width, int height, int stride);
+  bool publish(int slideIndex, const QImage& image);
+  // decode and publish on the ring's decoder thread, dropped if a new presentation began meanwhile
+  void publishPng(int slideIndex, const QByteArray& png);
+
+private:
+  bool publishLocked(int slideIndex, const uchar* pixels, int width, int height, int stride);
+
+  QString mKey;
+  int mSlotCount;
+  int mMaxWidth;
+  int mMaxHeight;
+
+  QMutex mMutex;
+  QSharedMemory mMemory;
+  FrameRingLayout::Header* mHeader = nullptr;
+  quint64 mNextFrame = 0;
+  quint32 mGeneration = 0;
+  int mSlideCount = 0;
+  // one thread, frames are published in the order they arrived
+  QThreadPool mDecoder;
+};
@@ -0,0 +1,88 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// Memory layout of the shared frame ring published by FrameRing, for
+// consumer processes (no Qt needed). The segment is created by QSharedMemory
+// with the configured key as its native key: on Windows a file mapping of
+// that name, on other systems a System V segment whose key is
+// ftok(<key>, 'Q'), where <key> is a file path Qt creates if it is missing
+// (e.g. "/tmp/pptx-frames"; a relative key is relative to the writer's
+// working directory). Consumers attach with shmget(ftok(...), 0, 0) and
+// shmat. The segment contains:
+//
+//   Header | SlotDescriptor[slotCount] | pixels of slot 0 | pixels of slot 1 | ...
+//
+// There is one writer. Each frame goes into slot frameNumber % slotCount,
+// guarded by a sequence number that is odd while the slot is written.
+// Frames are read in place:
+//
+//   uint64_t latest = header->latestFrame.load(std::memory_order_acquire); // 0: nothing yet
+//   auto& slot = FrameRingLayout::slot(header, (latest - 1) % header->slotCount);
+//   uint64_t sequence = FrameRingLayout::beginRead(slot);      // 0: being written, retry
+//   ... use slot.width/height/stride and FrameRingLayout::pixels(header, ...) ...
+//   if (!FrameRingLayout::endRead(slot, sequence)) { /* overwritten meanwhile, drop it */ }
+
+namespace FrameRingLayout
+{
+  const uint32_t kMagic = 0x46545050; // "PPTF"
+  const uint32_t kVersion = 1;
+
+  // 4 bytes per pixel R, G, B, A with straight (not premultiplied) alpha
+  const uint32_t kFormatRgba8888 = 1;
+
+  struct SlotDescriptor {
+    std::atomic<uint64_t> sequence; // odd while written, 0 if never written
+    uint64_t frameNumber;
+    uint32_t generation;            // changes with every presentation
+    uint32_t slideIndex;
+    uint32_t slideCount;
+    uint32_t width;
+    uint32_t height;
+    uint32_t stride;                // bytes per row
+    uint32_t format;
+    uint32_t reserved;
+  };
+
+  struct Header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slotCount;
+    uint32_t reserved;
+    uint64_t slotBytes;             // pixel bytes per slot
+    uint64_t dataOffset;            // offset of the pixels of slot 0
+    std::atomic<uint64_t> latestFrame; // frameNumber + 1 of the last complete frame
+    std::atomic<uint32_t> generation;
+    uint32_t reserved2;
+  };
+
+  inline SlotDescriptor& slot(Header* header, uint32_t index)
+  {
+    return reinterpret_cast<SlotDescriptor*>(header + 1)[index];
+  }
+
+  inline uint8_t* pixels(Header* header, uint32_t index)
+  {
+    return reinterpret_cast<uint8_t*>(header) + header->dataOffset + header->slotBytes * index;
+  }
+
+  inline uint64_t segmentBytes(uint32_t slotCount, uint64_t slotBytes)
+  {
+    // pixels start 64 byte aligned
+    const uint64_t descriptors = sizeof(Header) + sizeof(SlotDescriptor) * slotCount;
+    return ((descriptors + 63) / 64) * 64 + slotBytes * slotCount;
+  }
+
+  inline uint64_t beginRead(const SlotDescriptor& slot)
+  {
+    const uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+    return (sequence & 1) ? 0 : sequence;
+  }
+
+  // true if the slot was not rewritten since beginRead
+  inline bool endRead(const SlotDescriptor& slot, uint64_t sequence)
+  {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return sequence != 0 && slot.sequence.load(std::memory_order_relaxed) == sequence;
+  }
+}
@@ -0,0 +1,543 @@
+#include "ImageKernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define IMAGE_KERNELS_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+// MSVC allows all intrinsics without per function target flags
+#define IMAGE_KERNELS_TARGET_SSSE3
+#define IMAGE_KERNELS_TARGET_AVX2
+#else
+#include <cpuid.h>
+#define IMAGE_KERNELS_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define IMAGE_KERNELS_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define IMAGE_KERNELS_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+  // ---------------------------------------------------------------------------
+  // filter weights
+
+  // the source pixels contributing to one destination pixel
+  struct Contribution {
+    int start = 0;
+    int count = 0;
+    size_t weightOffset = 0;
+  };
+
+  struct Contributions {
+    std::vector<Contribution> pixels;
+    std::vector<float> weights;
+  };
+
+  double sinc(double x)
+  {
+    if (std::abs(x) < 1e-8) return 1.0;
+    const double pix = 3.14159265358979323846 * x;
+    return std::sin(pix) / pix;
+  }
+
+  double lanczos3(double x)
+  {
+    return std::abs(x) < 3.0 ? sinc(x) * sinc(x / 3.0) : 0.0;
+  }
+
+  Contributions computeContributions(int srcSize, int dstSize, ImageKernels::Filter filter)
+  {
+    Contributions result;
+    result.pixels.resize(dstSize);
+    const double scale = static_cast<double>(srcSize) / dstSize;
+    std::vector<double> weights;
+
+    for (int i = 0; i < dstSize; ++i) {
+      weights.clear();
+      int start = 0;
+      if (filter == ImageKernels::Filter::kBox) {
+        // coverage of [left, right) by every source pixel
+        const double left = i * scale;
+        const double right = (i + 1) * scale;
+        start = std::max(0, static_cast<int>(std::floor(left)));
+        const int end = std::min(srcSize, static_cast<int>(std::ceil(right)));
+        for (int j = start; j < end; ++j) {
+          weights.push_back(std::min<double>(j + 1, right) - std::max<double>(j, left));
+        }
+      }
+      else {
+        // widen the kernel when reducing to avoid aliasing
+        const double filterScale = std::max(scale, 1.0);
+        const double support = 3.0 * filterScale;
+        const double center = (i + 0.5) * scale;
+        start = std::max(0, static_cast<int>(std::floor(center - support)));
+        const int end = std::min(srcSize, static_cast<int>(std::ceil(center + support)));
+        for (int j = start; j < end; ++j) {
+          weights.push_back(lanczos3((j + 0.5 - center) / filterScale));
+        }
+      }
+
+      double sum = 0.0;
+      for (double weight : weights) sum += weight;
+      if (weights.empty() || std::abs(sum) < 1e-12) {
+        // degenerate, use the nearest pixel
+        weights.assign(1, 1.0);
+        start = std::min(srcSize - 1, static_cast<int>(i * scale));
+        sum = 1.0;
+      }
+
+      auto& pixel = result.pixels[i];
+      pixel.start = start;
+      pixel.count = static_cast<int>(weights.size());
+      pixel.weightOffset = result.weights.size();
+      for (double weight : weights) result.weights.push_back(static_cast<float>(weight / sum));
+    }
+    return result;
+  }
+
+  // ---------------------------------------------------------------------------
+  // scalar kernels
+
+  void swizzleScalar(const uint8_t* src, uint8_t* dst, size_t count)
+  {
+    for (size_t i = 0; i < count; ++i, src += 4, dst += 4) {
+      const uint8_t c0 = src[0];
+      const uint8_t c2 = src[2];
+      dst[0] = c2;
+      dst[1] = src[1];
+      dst[2] = c0;
+      dst[3] = src[3];
+    }
+  }
+
+  inline uint8_t multiplyDiv255(unsigned value, unsigned alpha)
+  {
+    // exact rounding of value * alpha / 255
+    const unsigned t = value * alpha;
+    return static_cast<uint8_t>((t + ((t + 128) >> 8) + 128) >> 8);
+  }
+
+  void premultiplyScalar(const uint8_t* src, uint8_t* dst, size_t count)
+  {
+    for (size_t i = 0; i < count; ++i, src += 4, dst += 4) {
+      const unsigned alpha = src[3];
+      dst[0] = multiplyDiv255(src[0], alpha);
+      dst[1] = multiplyDiv255(src[1], alpha);
+      dst[2] = multiplyDiv255(src[2], alpha);
+      dst[3] = static_cast<uint8_t>(alpha);
+    }
+  }
+
+  // one source row -> dstWidth float pixels
+  void horizontalScalar(const uint8_t* src, float* dst, const Contributions& contributions)
+  {
+    for (const auto& pixel : contributions.pixels) {
+      float acc[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+      const uint8_t* p = src + pixel.start * 4;
+      const float* w = contributions.weights.data() + pixel.weightOffset;
+      for (int t = 0; t < pixel.count; ++t, p += 4) {
+        for (int c = 0; c < 4; ++c) acc[c] += w[t] * p[c];
+      }
+      std::memcpy(dst, acc, sizeof(acc));
+      dst += 4;
+    }
+  }
+
+  void accumulateScalar(const float* row, float weight, float* acc, size_t count)
+  {
+    for (size_t i = 0; i < count; ++i) acc[i] += weight * row[i];
+  }
+
+  inline uint8_t clampToByte(float value)
+  {
+    return static_cast<uint8_t>(std::min(255.0f, std::max(0.0f, value + 0.5f)));
+  }
+
+  void storeScalar(const float* acc, uint8_t* dst, size_t count)
+  {
+    for (size_t i = 0; i < count; ++i) dst[i] = clampToByte(acc[i]);
+  }
+
+#ifdef IMAGE_KERNELS_X86
+  // ---------------------------------------------------------------------------
+  // x86 kernels
+
+  void swizzleSse2(const uint8_t* src, uint8_t* dst, size_t count)
+  {
+    const __m128i keep = _mm_set1_epi32(static_cast<int>(0xFF00FF00));
+    const __m128i low = _mm_set1_epi32(0x000000FF);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+      const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+      const __m128i swapped = _mm_or_si128(_mm_and_si128(v, keep),
+        _mm_or_si128(_mm_slli_epi32(_mm_and_si128(v, low), 16), _mm_and_si128(_mm_srli_epi32(v, 16), low)));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), swapped);
+    }
+    swizzleScalar(src + i * 4, dst + i * 4, count - i);
+  }
+
+  IMAGE_KERNELS_TARGET_SSSE3 void swizzleSsse3(const uint8_t* src, uint8_t* dst, size_t count)
+  {
+    const __m128i mask = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+      const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), _mm_shuffle_epi8(v, mask));
+    }
+    swizzleScalar(src + i * 4, dst + i * 4, count - i);
+  }
+
+  IMAGE_KERNELS_TARGET_AVX2 void swizzleAvx2(const uint8_t* src, uint8_t* dst, size_t count)
+  {
+    const __m256i mask = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+      2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+      const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * 4));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * 4), _mm256_shuffle_epi8(v, mask));
+    }
+    swizzleScalar(src + i * 4, dst + i * 4, count - i);
+  }
+
+  // 8 x 16 bit (2 pixels): multiply by alpha (alpha lane by 255) and divide by 255
+  inline __m128i premultiply2Sse2(__m128i pixels, __m128i alphaLaneMask, __m128i alphaLane255)
+  {
+    __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(pixels, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+    alpha = _mm_or_si128(_mm_andnot_si128(alphaLaneMask, alpha), alphaLane255);
+    __m128i t = _mm_add_epi16(_mm_mullo_epi16(pixels, alpha), _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+  }
+
+  void premultiplySse2(const uint8_t* src, uint8_t* dst, size_t count)
+  {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alphaLaneMask = _mm_setr_epi16(0, 0, 0, -1, 0, 0, 0, -1);
+    const __m128i alphaLane255 = _mm_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+      const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+      const __m128i lo = premultiply2Sse2(_mm_unpacklo_epi8(v, zero), alphaLaneMask, alphaLane255);
+      const __m128i hi = premultiply2Sse2(_mm_unpackhi_epi8(v, zero), alphaLaneMask, alphaLane255);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), _mm_packus_epi16(lo, hi));
+    }
+    premultiplyScalar(src + i * 4, dst + i * 4, count - i);
+  }
+
+  IMAGE_KERNELS_TARGET_AVX2 void premultiplyAvx2(const uint8_t* src, uint8_t* dst, size_t count)
+  {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i alphaLaneMask = _mm256_setr_epi16(0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0, -1);
+    const __m256i alphaLane255 = _mm256_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255);
+    const __m256i rounding = _mm256_set1_epi16(128);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+      const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * 4));
+      // unpack and pack both work per 128 bit lane, so the pixel order is preserved
+      __m256i halves[2] = { _mm256_unpacklo_epi8(v, zero), _mm256_unpackhi_epi8(v, zero) };
+      for (auto& pixels : halves) {
+        __m256i alpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(pixels, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+        alpha = _mm256_or_si256(_mm256_andnot_si256(alphaLaneMask, alpha), alphaLane255);
+        __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(pixels, alpha), rounding);
+        pixels = _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+      }
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * 4), _mm256_packus_epi16(halves[0], halves[1]));
+    }
+    premultiplyScalar(src + i * 4, dst + i * 4, count - i);
+  }
+
+  inline __m128 loadPixelSse2(const uint8_t* p)
+  {
+    int32_t value;
+    std::memcpy(&value, p, 4);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i bytes = _mm_cvtsi32_si128(value);
+    return _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(bytes, zero), zero));
+  }
+
+  void horizontalSse2(const uint8_t* src, float* dst, const Contributions& contributions)
+  {
+    for (const auto& pixel : contributions.pixels) {
+      __m128 acc = _mm_setzero_ps();
+      const uint8_t* p = src + pixel.start * 4;
+      const float* w = contributions.weights.data() + pixel.weightOffset;
+      for (int t = 0; t < pixel.count; ++t, p += 4) {
+        acc = _mm_add_ps(acc, _mm_mul_ps(loadPixelSse2(p), _mm_set1_ps(w[t])));
+      }
+      _mm_storeu_ps(dst, acc);
+      dst += 4;
+    }
+  }
+
+  void accumulateSse2(const float* row, float weight, float* acc, size_t count)
+  {
+    const __m128 w = _mm_set1_ps(weight);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+      _mm_storeu_ps(acc + i, _mm_add_ps(_mm_loadu_ps(acc + i), _mm_mul_ps(_mm_loadu_ps(row + i), w)));
+    }
+    accumulateScalar(row + i, weight, acc + i, count - i);
+  }
+
+  IMAGE_KERNELS_TARGET_AVX2 void accumulateAvx2(const float* row, float weight, float* acc, size_t count)
+  {
+    const __m256 w = _mm256_set1_ps(weight);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+      _mm256_storeu_ps(acc + i, _mm256_add_ps(_mm256_loadu_ps(acc + i), _mm256_mul_ps(_mm256_loadu_ps(row + i), w)));
+    }
+    accumulateScalar(row + i, weight, acc + i, count - i);
+  }
+
+  void storeSse2(const float* acc, uint8_t* dst, size_t count)
+  {
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+      // round to nearest, the packs saturate to 0..255
+      const __m128i a = _mm_cvtps_epi32(_mm_loadu_ps(acc + i));
+      const __m128i b = _mm_cvtps_epi32(_mm_loadu_ps(acc + i + 4));
+      const __m128i c = _mm_cvtps_epi32(_mm_loadu_ps(acc + i + 8));
+      const __m128i d = _mm_cvtps_epi32(_mm_loadu_ps(acc + i + 12));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d)));
+    }
+    storeScalar(acc + i, dst + i, count - i);
+  }
+#endif
+
+#ifdef IMAGE_KERNELS_NEON
+  // ---------------------------------------------------------------------------
+  // ARM kernels
+
+  void swizzleNeon(const uint8_t* src, uint8_t* dst, size_t count)
+  {
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+      uint8x16x4_t v = vld4q_u8(src + i * 4);
+      const uint8x16_t c0 = v.val[0];
+      v.val[0] = v.val[2];
+      v.val[2] = c0;
+      vst4q_u8(dst + i * 4, v);
+    }
+    swizzleScalar(src + i * 4, dst + i * 4, count - i);
+  }
+
+  inline uint8x16_t multiplyDiv255Neon(uint8x16_t value, uint8x16_t alpha)
+  {
+    const uint16x8_t lo = vmull_u8(vget_low_u8(value), vget_low_u8(alpha));
+    const uint16x8_t hi = vmull_u8(vget_high_u8(value), vget_high_u8(alpha));
+    return vcombine_u8(vrshrn_n_u16(vrsraq_n_u16(lo, lo, 8), 8), vrshrn_n_u16(vrsraq_n_u16(hi, hi, 8), 8));
+  }
+
+  void premultiplyNeon(const uint8_t* src, uint8_t* dst, size_t count)
+  {
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+      uint8x16x4_t v = vld4q_u8(src + i * 4);
+      v.val[0] = multiplyDiv255Neon(v.val[0], v.val[3]);
+      v.val[1] = multiplyDiv255Neon(v.val[1], v.val[3]);
+      v.val[2] = multiplyDiv255Neon(v.val[2], v.val[3]);
+      vst4q_u8(dst + i * 4, v);
+    }
+    premultiplyScalar(src + i * 4, dst + i * 4, count - i);
+  }
+
+  void horizontalNeon(const uint8_t* src, float* dst, const Contributions& contributions)
+  {
+    for (const auto& pixel : contributions.pixels) {
+      float32x4_t acc = vdupq_n_f32(0.0f);
+      const uint8_t* p = src + pixel.start * 4;
+      const float* w = contributions.weights.data() + pixel.weightOffset;
+      for (int t = 0; t < pixel.count; ++t, p += 4) {
+        uint32_t value;
+        std::memcpy(&value, p, 4);
+        const uint16x8_t wide = vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(value)));
+        acc = vmlaq_n_f32(acc, vcvtq_f32_u32(vmovl_u16(vget_low_u16(wide))), w[t]);
+      }
+      vst1q_f32(dst, acc);
+      dst += 4;
+    }
+  }
+
+  void accumulateNeon(const float* row, float weight, float* acc, size_t count)
+  {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+      vst1q_f32(acc + i, vmlaq_n_f32(vld1q_f32(acc + i), vld1q_f32(row + i), weight));
+    }
+    accumulateScalar(row + i, weight, acc + i, count - i);
+  }
+#endif
+
+  // ---------------------------------------------------------------------------
+  // runtime dispatch
+
+  struct Dispatch {
+    const char* name = "Scalar";
+    void (*swizzle)(const uint8_t*, uint8_t*, size_t) = swizzleScalar;
+    void (*premultiply)(const uint8_t*, uint8_t*, size_t) = premultiplyScalar;
+    void (*horizontal)(const uint8_t*, float*, const Contributions&) = horizontalScalar;
+    void (*accumulate)(const float*, float, float*, size_t) = accumulateScalar;
+    void (*store)(const float*, uint8_t*, size_t) = storeScalar;
+  };
+
+#ifdef IMAGE_KERNELS_X86
+  void cpuid(int info[4], int function, int subfunction)
+  {
+#ifdef _MSC_VER
+    __cpuidex(info, function, subfunction);
+#else
+    unsigned a = 0, b = 0, c = 0, d = 0;
+    __cpuid_count(function, subfunction, a, b, c, d);
+    info[0] = static_cast<int>(a);
+    info[1] = static_cast<int>(b);
+    info[2] = static_cast<int>(c);
+    info[3] = static_cast<int>(d);
+#endif
+  }
+
+  bool osSupportsAvx()
+  {
+#ifdef _MSC_VER
+    return (_xgetbv(0) & 6) == 6;
+#else
+    unsigned eax = 0, edx = 0;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (eax & 6) == 6;
+#endif
+  }
+#endif
+
+  Dispatch createDispatch()
+  {
+    Dispatch dispatch;
+#ifdef IMAGE_KERNELS_X86
+    int info[4];
+    cpuid(info, 0, 0);
+    const int maxFunction = info[0];
+    cpuid(info, 1, 0);
+    const bool sse2 = (info[3] & (1 << 26)) != 0;
+    const bool ssse3 = (info[2] & (1 << 9)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0 && (info[2] & (1 << 27)) != 0 && osSupportsAvx();
+    bool avx2 = false;
+    if (avx && maxFunction >= 7) {
+      cpuid(info, 7, 0);
+      avx2 = (info[1] & (1 << 5)) != 0;
+    }
+    if (sse2) {
+      dispatch.name = "SSE2";
+      dispatch.swizzle = swizzleSse2;
+      dispatch.premultiply = premultiplySse2;
+      dispatch.horizontal = horizontalSse2;
+      dispatch.accumulate = accumulateSse2;
+      dispatch.store = storeSse2;
+    }
+    if (sse2 && ssse3) {
+      dispatch.name = "SSSE3";
+      dispatch.swizzle = swizzleSsse3;
+    }
+    if (sse2 && ssse3 && avx2) {
+      dispatch.name = "AVX2";
+      dispatch.swizzle = swizzleAvx2;
+      dispatch.premultiply = premultiplyAvx2;
+      dispatch.accumulate = accumulateAvx2;
+    }
+#elif defined(IMAGE_KERNELS_NEON)
+    dispatch.name = "NEON";
+    dispatch.swizzle = swizzleNeon;
+    dispatch.premultiply = premultiplyNeon;
+    dispatch.horizontal = horizontalNeon;
+    dispatch.accumulate = accumulateNeon;
+#endif
+    return dispatch;
+  }
+
+  const Dispatch& dispatch()
+  {
+    static const Dispatch sDispatch = createDispatch();
+    return sDispatch;
+  }
+}
+
+const char* ImageKernels::instructionSet()
+{
+  return dispatch().name;
+}
+
+void ImageKernels::swizzleRedBlue(const uint8_t* src, uint8_t* dst, size_t pixelCount)
+{
+  dispatch().swizzle(src, dst, pixelCount);
+}
+
+void ImageKernels::premultiplyAlpha(const uint8_t* src, uint8_t* dst, size_t pixelCount)
+{
+  dispatch().premultiply(src, dst, pixelCount);
+}
+
+void ImageKernels::resample(const uint8_t* src, int srcWidth, int srcHeight, int srcStride,
+  uint8_t* dst, int dstWidth, int dstHeight, int dstStride, Filter filter)
+{
+  if (srcWidth <= 0 || srcHeight <= 0 || dstWidth <= 0 || dstHeight <= 0) return;
+  const auto& kernels = dispatch();
+  const auto horizontal = computeContributions(srcWidth, dstWidth, filter);
+  const auto vertical = computeContributions(srcHeight, dstHeight, filter);
+
+  // horizontal pass into a ring of as many float rows as the vertical filter
+  // spans: the windows of consecutive output rows move down, a source row
+  // leaves the ring once no later output row uses it
+  const size_t rowFloats = static_cast<size_t>(dstWidth) * 4;
+  int ringRows = 1;
+  for (const auto& contribution : vertical.pixels) ringRows = std::max(ringRows, contribution.count);
+  std::vector<float> ring(rowFloats * ringRows);
+  // source row held by every ring slot, -1: none
+  std::vector<int> slotRow(ringRows, -1);
+  std::vector<float> acc(rowFloats);
+
+  for (int y = 0; y < dstHeight; ++y) {
+    const auto& contribution = vertical.pixels[y];
+    std::fill(acc.begin(), acc.end(), 0.0f);
+    for (int t = 0; t < contribution.count; ++t) {
+      const int sy = contribution.start + t;
+      const int slot = sy % ringRows;
+      float* row = ring.data() + rowFloats * slot;
+      if (slotRow[slot] != sy) {
+        kernels.horizontal(src + static_cast<size_t>(srcStride) * sy, row, horizontal);
+        slotRow[slot] = sy;
+      }
+      kernels.accumulate(row, vertical.weights[contribution.weightOffset + t], acc.data(), rowFloats);
+    }
+    kernels.store(acc.data(), dst + static_cast<size_t>(dstStride) * y, rowFloats);
+  }
+}
+
+ImageKernels::Rect ImageKernels::letterbox(const uint8_t* src, int srcWidth, int srcHeight, int srcStride,
+  uint8_t* dst, int dstWidth, int dstHeight, int dstStride, uint32_t fillPixel, Filter filter)
+{
+  Rect rect;
+  if (srcWidth <= 0 || srcHeight <= 0 || dstWidth <= 0 || dstHeight <= 0) return rect;
+
+  const double scale = std::min(static_cast<double>(dstWidth) / srcWidth, static_cast<double>(dstHeight) / srcHeight);
+  rect.width = std::max(1, std::min(dstWidth, static_cast<int>(std::lround(srcWidth * scale))));
+  rect.height = std::max(1, std::min(dstHeight, static_cast<int>(std::lround(srcHeight * scale))));
+  rect.x = (dstWidth - rect.width) / 2;
+  rect.y = (dstHeight - rect.height) / 2;
+
+  // fill the bars only, the image area is written by resample
+  for (int y = 0; y < dstHeight; ++y) {
+    uint8_t* row = dst + static_cast<size_t>(dstStride) * y;
+    const bool bar = y < rect.y || y >= rect.y + rect.height;
+    for (int x = 0; x < dstWidth; ++x) {
+      if (!bar && x == rect.x) x += rect.width;
+      if (x >= dstWidth) break;
+      std::memcpy(row + x * 4, &fillPixel, 4);
+    }
+  }
+
+  resample(src, srcWidth, srcHeight, srcStride, dst + static_cast<size_t>(dstStride) * rect.y + rect.x * 4, rect.width, rect.height, dstStride, filter);
+  return rect;
+}
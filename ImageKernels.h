@@ -0,0 +1,43 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Image post-processing kernels on 32 bit pixels (4 bytes, alpha last in
+// memory, i.e. BGRA/RGBA as delivered by Aspose Format32bppArgb and
+// QImage::Format_ARGB32 on little endian).
+// The implementation is picked at runtime: AVX2, SSSE3/SSE2 or NEON with a
+// scalar fallback, so thumbnails and other formats are derived from a single
+// full resolution render instead of rasterizing again.
+
+namespace ImageKernels
+{
+  enum class Filter {
+    kBox,     // area average, fast and good for large reductions
+    kLanczos3 // sharper, for small reductions and enlargements
+  };
+
+  struct Rect {
+    int x = 0;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+  };
+
+  // the instruction set used, e.g. "AVX2"
+  const char* instructionSet();
+
+  // swap byte 0 and 2 of every pixel (BGRA <-> RGBA), src and dst may be equal
+  void swizzleRedBlue(const uint8_t* src, uint8_t* dst, size_t pixelCount);
+
+  // multiply the color channels by alpha, src and dst may be equal
+  void premultiplyAlpha(const uint8_t* src, uint8_t* dst, size_t pixelCount);
+
+  // resize src into dst (strides in bytes). Resample premultiplied data to avoid color fringes
+  void resample(const uint8_t* src, int srcWidth, int srcHeight, int srcStride,
+    uint8_t* dst, int dstWidth, int dstHeight, int dstStride, Filter filter = Filter::kBox);
+
+  // resize src into dst keeping its aspect ratio, the bars are filled with
+  // fillPixel (4 bytes in memory order). Returns the area covered by the image
+  Rect letterbox(const uint8_t* src, int srcWidth, int srcHeight, int srcStride,
+    uint8_t* dst, int dstWidth, int dstHeight, int dstStride, uint32_t fillPixel, Filter filter = Filter::kBox);
+}
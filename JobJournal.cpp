@@ -0,0 +1,204 @@
+#include "JobJournal.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QUuid>
+#include <map>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+  // the record must be on disk before the job acts on it
+  bool syncToDisk(QFile& file)
+  {
+    if (!file.flush()) return false;
+#ifdef Q_OS_WIN
+    return _commit(file.handle()) == 0;
+#else
+    return ::fsync(file.handle()) == 0;
+#endif
+  }
+
+  QJsonObject record(const QString& id, const QString& event)
+  {
+    QJsonObject object;
+    object["job"] = id;
+    object["event"] = event;
+    object["time"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    return object;
+  }
+}
+
+JobJournal& JobJournal::instance()
+{
+  static JobJournal sInstance;
+  return sInstance;
+}
+
+JobJournal::JobJournal(const QString& journalPath)
+  : mJournalPath(journalPath)
+{
+  if (mJournalPath.isEmpty()) {
+    mJournalPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/job_journal.jsonl";
+  }
+  mLock = std::make_unique<QLockFile>(mJournalPath + ".lock");
+  // held for the lifetime of the process, only a dead owner makes it stale
+  mLock->setStaleLockTime(0);
+}
+
+bool JobJournal::ownsJournal()
+{
+  QMutexLocker locker(&mMutex);
+  if (mLock->isLocked()) return true;
+  QDir().mkpath(QFileInfo(mJournalPath).absolutePath());
+  return mLock->tryLock(0);
+}
+
+QString JobJournal::begin(Job job)
+{
+  if (job.id.isEmpty()) job.id = QUuid::createUuid().toString(QUuid::WithoutBraces);
+  auto object = record(job.id, "start");
+  object["flow"] = job.flow;
+  object["service"] = job.service;
+  object["clientId"] = job.clientId;
+  object["localFile"] = job.localFile;
+  object["localSize"] = static_cast<double>(job.localSize);
+  object["localModified"] = static_cast<double>(job.localModified);
+  object["targetPath"] = job.targetPath;
+  append(object);
+  return job.id;
+}
+
+void JobJournal::recordUploaded(const QString& id, const QString& serverPath, const QString& serverFile)
+{
+  auto object = record(id, "uploaded");
+  object["serverPath"] = serverPath;
+  object["serverFile"] = serverFile;
+  append(object);
+}
+
+void JobJournal::recordJobFolder(const QString& id, const QString& folder)
+{
+  auto object = record(id, "folder");
+  object["folder"] = folder;
+  append(object);
+}
+
+void JobJournal::recordSplit(const QString& id, const QStringList& slideUrls)
+{
+  auto object = record(id, "split");
+  object["slides"] = QJsonArray::fromStringList(slideUrls);
+  append(object);
+}
+
+void JobJournal::recordSaved(const QString& id, const QString& slideUrl, const QString& localFile)
+{
+  auto object = record(id, "saved");
+  object["slide"] = slideUrl;
+  object["file"] = localFile;
+  append(object);
+}
+
+void JobJournal::end(const QString& id, const QString& result)
+{
+  auto object = record(id, "end");
+  object["result"] = result;
+  append(object);
+}
+
+bool JobJournal::append(const QJsonObject& record)
+{
+  QMutexLocker locker(&mMutex);
+  QDir().mkpath(QFileInfo(mJournalPath).absolutePath());
+  QFile file(mJournalPath);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) return false;
+  const auto line = QJsonDocument(record).toJson(QJsonDocument::Compact) + '\n';
+  return file.write(line) == line.size() && syncToDisk(file);
+}
+
+QVector<JobJournal::Job> JobJournal::unfinishedJobs()
+{
+  // the unfinished jobs may be running in the process owning the journal
+  if (!ownsJournal()) return {};
+  QMutexLocker locker(&mMutex);
+  QFile file(mJournalPath);
+  if (!file.open(QIODevice::ReadOnly)) return {};
+
+  // replay in order, a line torn by a crash is skipped
+  std::map<QString, Job> jobs;
+  QStringList order;
+  std::map<QString, QList<QByteArray>> lines;
+  while (!file.atEnd()) {
+    const auto line = file.readLine().trimmed();
+    if (line.isEmpty()) continue;
+    const auto object = QJsonDocument::fromJson(line).object();
+    const auto id = object["job"].toString();
+    const auto event = object["event"].toString();
+    if (id.isEmpty()) continue;
+
+    if (event == "start") {
+      Job job;
+      job.id = id;
+      job.flow = object["flow"].toString();
+      job.service = object["service"].toString();
+      job.clientId = object["clientId"].toString();
+      job.localFile = object["localFile"].toString();
+      job.localSize = static_cast<qint64>(object["localSize"].toDouble());
+      job.localModified = static_cast<qint64>(object["localModified"].toDouble());
+      job.targetPath = object["targetPath"].toString();
+      jobs[id] = job;
+      order << id;
+    }
+    auto iter = jobs.find(id);
+    if (iter == jobs.end()) continue;
+    auto& job = iter->second;
+    lines[id] << line;
+
+    if (event == "uploaded") {
+      job.stage = Stage::kUploaded;
+      job.serverPath = object["serverPath"].toString();
+      job.serverFile = object["serverFile"].toString();
+    }
+    else if (event == "folder") {
+      job.jobFolder = object["folder"].toString();
+    }
+    else if (event == "split") {
+      job.stage = Stage::kSplit;
+      job.slideUrls.clear();
+      for (const auto& slide : object["slides"].toArray()) job.slideUrls << slide.toString();
+    }
+    else if (event == "saved") {
+      job.savedFiles.insert(object["slide"].toString(), object["file"].toString());
+    }
+    else if (event == "end") {
+      jobs.erase(iter);
+      lines.erase(id);
+    }
+  }
+  file.close();
+
+  // compact: only the records of unfinished jobs are kept
+  QVector<Job> unfinished;
+  QSaveFile compacted(mJournalPath);
+  const bool compact = compacted.open(QIODevice::WriteOnly);
+  for (const auto& id : order) {
+    auto iter = jobs.find(id);
+    if (iter == jobs.end()) continue;
+    unfinished << iter->second;
+    if (!compact) continue;
+    for (const auto& line : lines[id]) compacted.write(line + '\n');
+  }
+  if (compact) compacted.commit();
+  return unfinished;
+}
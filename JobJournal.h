@@ -0,0 +1,82 @@
+#pragma once
+#include <QJsonObject>
+#include <QLockFile>
+#include <QMap>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <memory>
+
+// Append-only journal of the cloud conversions (job_journal.jsonl in the
+// application data folder). Every durable step of a job is one JSON line,
+// synced to disk before the job continues:
+//   start    local file (size, modification time), target path, flow, service, account
+//   uploaded server folder and file name
+//   folder   storage folder the split writes the slides to
+//   split    the slide URLs to download
+//   saved    one downloaded slide and its local file
+//   end      finished, failed, cancelled or restarted
+// After a crash, unfinishedJobs() replays the journal so the jobs continue
+// from their last durable step instead of uploading and converting again.
+// All processes append to the journal, but only the one holding its lock file
+// (for its whole lifetime) replays and compacts it: the jobs of another live
+// process are never resumed twice.
+
+class JobJournal
+{
+public:
+  // last durable step of a job
+  enum class Stage {
+    kStarted,
+    kUploaded,
+    kSplit,
+  };
+
+  struct Job {
+    QString id;
+    QString flow; // "split" (upload, split, download) or "convert" (single request)
+    QString service;
+    QString clientId;
+    QString localFile;
+    qint64 localSize = 0;
+    qint64 localModified = 0;
+    QString targetPath;
+    Stage stage = Stage::kStarted;
+    QString serverPath;
+    QString serverFile;
+    // storage folder of the split slides, deleted after the job
+    QString jobFolder;
+    QStringList slideUrls;
+    // slide url -> saved local file
+    QMap<QString, QString> savedFiles;
+  };
+
+  // the shared journal of the process
+  static JobJournal& instance();
+
+  // defaults to job_journal.jsonl in the application data folder
+  explicit JobJournal(const QString& journalPath = QString());
+
+  // record a new job (its id is created if empty), returns the id
+  QString begin(Job job);
+  void recordUploaded(const QString& id, const QString& serverPath, const QString& serverFile);
+  void recordJobFolder(const QString& id, const QString& folder);
+  void recordSplit(const QString& id, const QStringList& slideUrls);
+  void recordSaved(const QString& id, const QString& slideUrl, const QString& localFile);
+  void end(const QString& id, const QString& result);
+
+  // replay the journal: all jobs without end record. The journal is compacted
+  // to these jobs, so call it once at startup before new jobs are recorded.
+  // Empty if another running process owns the journal
+  QVector<Job> unfinishedJobs();
+  // true if this process holds the journal's lock
+  bool ownsJournal();
+
+private:
+  bool append(const QJsonObject& record);
+
+  QMutex mMutex;
+  QString mJournalPath;
+  std::unique_ptr<QLockFile> mLock;
+};
@@ -0,0 +1,75 @@
+#include "MappedPresentation.h"
+
+#include <QFileInfo>
+#include <QDateTime>
+
+QMutex MappedPresentation::sRegistryMutex;
+std::map<QString, std::weak_ptr<MappedPresentation>> MappedPresentation::sRegistry;
+
+std::shared_ptr<MappedPresentation> MappedPresentation::acquire(const QString& filepath, QString* errorMessage)
+{
+  QFileInfo fileInfo(filepath);
+  if (!fileInfo.exists()) {
+    if (errorMessage) *errorMessage = QString("File %1 does not exist").arg(filepath);
+    return nullptr;
+  }
+
+  // a changed file on disk must not reuse the old mapping
+  auto key = QString("%1|%2|%3").arg(fileInfo.canonicalFilePath()).arg(fileInfo.size()).arg(fileInfo.lastModified().toMSecsSinceEpoch());
+
+  {
+    QMutexLocker locker(&sRegistryMutex);
+    auto iter = sRegistry.find(key);
+    if (iter != sRegistry.end()) {
+      if (auto existing = iter->second.lock()) return existing;
+    }
+  }
+
+  // map outside the lock, a failed mapping unregisters itself in the destructor
+  std::shared_ptr<MappedPresentation> mapping(new MappedPresentation(filepath, key));
+  if (!mapping->map(errorMessage)) return nullptr;
+
+  QMutexLocker locker(&sRegistryMutex);
+  auto& entry = sRegistry[key];
+  if (auto existing = entry.lock()) return existing; // another job was faster
+  entry = mapping;
+  return mapping;
+}
+
+MappedPresentation::MappedPresentation(const QString& filepath, const QString& key)
+  : mFile(filepath)
+  , mFilepath(filepath)
+  , mRegistryKey(key)
+{
+}
+
+MappedPresentation::~MappedPresentation()
+{
+  if (mData) mFile.unmap(mData);
+  QMutexLocker locker(&sRegistryMutex);
+  auto iter = sRegistry.find(mRegistryKey);
+  // only remove our own (expired) entry, a newer mapping may have replaced it
+  if (iter != sRegistry.end() && iter->second.expired()) sRegistry.erase(iter);
+}
+
+bool MappedPresentation::map(QString* errorMessage)
+{
+  if (!mFile.open(QIODevice::ReadOnly)) {
+    if (errorMessage) *errorMessage = QString("Presentation file '%1' can't be opened").arg(mFilepath);
+    return false;
+  }
+  mSize = mFile.size();
+  mData = mSize > 0 ? mFile.map(0, mSize) : nullptr;
+  // the map stays valid after closing, so the file handle is not kept around
+  mFile.close();
+  if (!mData) {
+    if (errorMessage) *errorMessage = QString("Presentation file '%1' can't be mapped: %2").arg(mFilepath).arg(mFile.errorString());
+    return false;
+  }
+  return true;
+}
+
+QByteArray MappedPresentation::data() const
+{
+  return QByteArray::fromRawData(reinterpret_cast<const char*>(mData), static_cast<int>(mSize));
+}
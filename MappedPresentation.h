@@ -0,0 +1,42 @@
+#pragma once
+#include <QFile>
+#include <QMutex>
+#include <QByteArray>
+#include <QString>
+#include <map>
+#include <memory>
+
+// Read-only memory map of a presentation file used as zero-copy upload source.
+// Mappings are shared: concurrent jobs uploading the same (unchanged) file get
+// the same instance. The map is released when the last job drops its reference.
+
+class MappedPresentation
+{
+public:
+  // map the file or return the existing mapping; nullptr and errorMessage on failure
+  static std::shared_ptr<MappedPresentation> acquire(const QString& filepath, QString* errorMessage = nullptr);
+
+  ~MappedPresentation();
+  MappedPresentation(const MappedPresentation&) = delete;
+  MappedPresentation& operator=(const MappedPresentation&) = delete;
+
+  // the mapped bytes wrapped without copying. Only valid while this object is alive!
+  QByteArray data() const;
+  const uchar* constData() const { return mData; }
+  qint64 size() const { return mSize; }
+  const QString& filepath() const { return mFilepath; }
+
+private:
+  MappedPresentation(const QString& filepath, const QString& key);
+  bool map(QString* errorMessage);
+
+  QFile mFile;
+  QString mFilepath;
+  QString mRegistryKey;
+  uchar* mData = nullptr;
+  qint64 mSize = 0;
+
+  // all live mappings keyed by canonical path, size and modification time
+  static QMutex sRegistryMutex;
+  static std::map<QString, std::weak_ptr<MappedPresentation>> sRegistry;
+};
@@ -0,0 +1,102 @@
+#include "Metrics.h"
+
+namespace {
+  QByteArray formatName(const QString& name, const QString& labels)
+  {
+    if (labels.isEmpty()) return name.toUtf8();
+    return QString("%1{%2}").arg(name).arg(labels).toUtf8();
+  }
+}
+
+void Counter::write(QByteArray& out, const QString& name, const QString& labels) const
+{
+  out += formatName(name, labels) + ' ' + QByteArray::number(value()) + '\n';
+}
+
+void Gauge::write(QByteArray& out, const QString& name, const QString& labels) const
+{
+  out += formatName(name, labels) + ' ' + QByteArray::number(value()) + '\n';
+}
+
+Histogram::Histogram(const std::vector<double>& bounds)
+  : mBounds(bounds)
+  , mBuckets(new std::atomic<quint64>[bounds.size() + 1])
+{
+  for (size_t i = 0; i <= mBounds.size(); ++i) mBuckets[i].store(0);
+}
+
+void Histogram::observeMsecs(qint64 msecs)
+{
+  const double seconds = msecs / 1000.0;
+  size_t bucket = 0;
+  while (bucket < mBounds.size() && seconds > mBounds[bucket]) ++bucket;
+  mBuckets[bucket].fetch_add(1, std::memory_order_relaxed);
+  mCount.fetch_add(1, std::memory_order_relaxed);
+  mSumMsecs.fetch_add(static_cast<quint64>(qMax<qint64>(0, msecs)), std::memory_order_relaxed);
+}
+
+void Histogram::write(QByteArray& out, const QString& name, const QString& labels) const
+{
+  const QString separator = labels.isEmpty() ? "" : ",";
+  quint64 cumulative = 0;
+  for (size_t i = 0; i <= mBounds.size(); ++i) {
+    cumulative += mBuckets[i].load(std::memory_order_relaxed);
+    const QString le = i < mBounds.size() ? QString::number(mBounds[i]) : "+Inf";
+    out += formatName(name + "_bucket", QString("%1%2le=\"%3\"").arg(labels).arg(separator).arg(le)) + ' ' + QByteArray::number(cumulative) + '\n';
+  }
+  out += formatName(name + "_sum", labels) + ' ' + QByteArray::number(mSumMsecs.load(std::memory_order_relaxed) / 1000.0) + '\n';
+  out += formatName(name + "_count", labels) + ' ' + QByteArray::number(mCount.load(std::memory_order_relaxed)) + '\n';
+}
+
+MetricsRegistry& MetricsRegistry::instance()
+{
+  static MetricsRegistry sInstance;
+  return sInstance;
+}
+
+template <typename T, typename... Args>
+T& MetricsRegistry::getOrCreate(const QString& name, const QString& help, const QString& type, const QString& labels, Args&&... args)
+{
+  QMutexLocker locker(&mMutex);
+  auto& family = mFamilies[name];
+  if (family.type.isEmpty()) {
+    family.help = help;
+    family.type = type;
+  }
+  auto& metric = family.metrics[labels];
+  if (!metric) metric = std::make_unique<T>(std::forward<Args>(args)...);
+  return static_cast<T&>(*metric);
+}
+
+Counter& MetricsRegistry::counter(const QString& name, const QString& help, const QString& labels)
+{
+  return getOrCreate<Counter>(name, help, "counter", labels);
+}
+
+Gauge& MetricsRegistry::gauge(const QString& name, const QString& help, const QString& labels)
+{
+  return getOrCreate<Gauge>(name, help, "gauge", labels);
+}
+
+Histogram& MetricsRegistry::histogram(const QString& name, const QString& help, const QString& labels)
+{
+  return getOrCreate<Histogram>(name, help, "histogram", labels, defaultLatencyBounds());
+}
+
+QByteArray MetricsRegistry::exposition() const
+{
+  QMutexLocker locker(&mMutex);
+  QByteArray out;
+  for (const auto& family : mFamilies) {
+    out += QString("# HELP %1 %2\n# TYPE %1 %3\n").arg(family.first).arg(family.second.help).arg(family.second.type).toUtf8();
+    for (const auto& metric : family.second.metrics) {
+      metric.second->write(out, family.first, metric.first);
+    }
+  }
+  return out;
+}
+
+std::vector<double> MetricsRegistry::defaultLatencyBounds()
+{
+  return { 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30, 60, 120 };
+}
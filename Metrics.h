@@ -0,0 +1,87 @@
+#pragma once
+#include <QByteArray>
+#include <QMutex>
+#include <QString>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <vector>
+
+// Process wide metrics in Prometheus text format.
+// Registration (and exposition) take a lock, updates are lock-free atomics,
+// so callers look up their metrics once and keep the references.
+
+class Metric
+{
+public:
+  virtual ~Metric() = default;
+  virtual void write(QByteArray& out, const QString& name, const QString& labels) const = 0;
+};
+
+class Counter : public Metric
+{
+public:
+  void increment(quint64 value = 1) { mValue.fetch_add(value, std::memory_order_relaxed); }
+  quint64 value() const { return mValue.load(std::memory_order_relaxed); }
+  void write(QByteArray& out, const QString& name, const QString& labels) const override;
+
+private:
+  std::atomic<quint64> mValue{ 0 };
+};
+
+class Gauge : public Metric
+{
+public:
+  void set(qint64 value) { mValue.store(value, std::memory_order_relaxed); }
+  void add(qint64 value) { mValue.fetch_add(value, std::memory_order_relaxed); }
+  qint64 value() const { return mValue.load(std::memory_order_relaxed); }
+  void write(QByteArray& out, const QString& name, const QString& labels) const override;
+
+private:
+  std::atomic<qint64> mValue{ 0 };
+};
+
+class Histogram : public Metric
+{
+public:
+  // upper bucket bounds in seconds, ascending
+  explicit Histogram(const std::vector<double>& bounds);
+  void observeMsecs(qint64 msecs);
+  void write(QByteArray& out, const QString& name, const QString& labels) const override;
+
+private:
+  std::vector<double> mBounds;
+  // per bucket (not cumulative) counts, the last one is +Inf
+  std::unique_ptr<std::atomic<quint64>[]> mBuckets;
+  std::atomic<quint64> mCount{ 0 };
+  std::atomic<quint64> mSumMsecs{ 0 };
+};
+
+class MetricsRegistry
+{
+public:
+  static MetricsRegistry& instance();
+
+  // get or create a metric, labels in Prometheus syntax, e.g. stage="upload"
+  Counter& counter(const QString& name, const QString& help, const QString& labels = QString());
+  Gauge& gauge(const QString& name, const QString& help, const QString& labels = QString());
+  Histogram& histogram(const QString& name, const QString& help, const QString& labels = QString());
+
+  // all metrics in the Prometheus text exposition format
+  QByteArray exposition() const;
+
+  // default latency buckets: 5 ms ... 2 min
+  static std::vector<double> defaultLatencyBounds();
+
+private:
+  struct Family {
+    QString help;
+    QString type;
+    std::map<QString, std::unique_ptr<Metric>> metrics;
+  };
+  template <typename T, typename... Args>
+  T& getOrCreate(const QString& name, const QString& help, const QString& type, const QString& labels, Args&&... args);
+
+  mutable QMutex mMutex;
+  std::map<QString, Family> mFamilies;
+};
@@ -0,0 +1,42 @@
+#include "MetricsServer.h"
+#include "Metrics.h"
+
+#include <QTcpSocket>
+
+MetricsServer::MetricsServer(QObject* parent)
+  : QObject(parent)
+{
+  connect(&mServer, &QTcpServer::newConnection, this, &MetricsServer::onNewConnection);
+}
+
+bool MetricsServer::start(quint16 port, const QHostAddress& address)
+{
+  return mServer.listen(address, port);
+}
+
+void MetricsServer::onNewConnection()
+{
+  while (auto* socket = mServer.nextPendingConnection()) {
+    connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+    connect(socket, &QTcpSocket::readyRead, socket, [socket]() {
+      // wait for the complete request head, the body (if any) is ignored
+      if (!socket->peek(socket->bytesAvailable()).contains("\r\n\r\n")) return;
+      const auto requestLine = socket->readLine();
+      socket->readAll();
+
+      QByteArray status = "200 OK";
+      QByteArray contentType = "text/plain; version=0.0.4";
+      QByteArray body;
+      if (requestLine.startsWith("GET /metrics ") || requestLine.startsWith("GET / ")) {
+        body = MetricsRegistry::instance().exposition();
+      }
+      else {
+        status = "404 Not Found";
+        contentType = "text/plain";
+        body = "Not found\n";
+      }
+      socket->write("HTTP/1.1 " + status + "\r\nContent-Type: " + contentType + "\r\nContent-Length: " + QByteArray::number(body.size()) + "\r\nConnection: close\r\n\r\n" + body);
+      socket->disconnectFromHost();
+    });
+  }
+}
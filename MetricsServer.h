@@ -0,0 +1,22 @@
+#pragma once
+#include <QObject>
+#include <QTcpServer>
+
+// Serves MetricsRegistry::exposition() as Prometheus text on GET /metrics.
+
+class MetricsServer : public QObject
+{
+  Q_OBJECT
+
+public:
+  explicit MetricsServer(QObject* parent = nullptr);
+
+  // listen on the given port, only for local scrapers unless another address is given
+  bool start(quint16 port, const QHostAddress& address = QHostAddress::LocalHost);
+
+private slots:
+  void onNewConnection();
+
+private:
+  QTcpServer mServer;
+};
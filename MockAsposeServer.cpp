@@ -0,0 +1,162 @@
+#include "MockAsposeServer.h"
+
+#include <QBuffer>
+#include <QImage>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRegularExpression>
+#include <QTcpSocket>
+#include <QUrlQuery>
+
+MockAsposeServer::MockAsposeServer(QObject* parent)
+  : QObject(parent)
+{
+  connect(&mServer, &QTcpServer::newConnection, this, &MockAsposeServer::onNewConnection);
+
+  // a real (small) PNG so consumers can decode the downloads
+  QImage image(192, 108, QImage::Format_RGB32);
+  image.fill(Qt::darkBlue);
+  QBuffer buffer(&mSlidePng);
+  buffer.open(QIODevice::WriteOnly);
+  image.save(&buffer, "PNG");
+}
+
+bool MockAsposeServer::start(quint16 port)
+{
+  return mServer.listen(QHostAddress::LocalHost, port);
+}
+
+QUrl MockAsposeServer::url() const
+{
+  return QUrl(QString("http://127.0.0.1:%1").arg(mServer.serverPort()));
+}
+
+void MockAsposeServer::onNewConnection()
+{
+  while (auto* socket = mServer.nextPendingConnection()) {
+    mBuffers.insert(socket, QByteArray());
+    connect(socket, &QTcpSocket::readyRead, this, &MockAsposeServer::onReadyRead);
+    connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+      mBuffers.remove(socket);
+      socket->deleteLater();
+    });
+  }
+}
+
+void MockAsposeServer::onReadyRead()
+{
+  auto* socket = static_cast<QTcpSocket*>(sender());
+  auto& buffer = mBuffers[socket];
+  buffer.append(socket->readAll());
+  Request request;
+  while (takeRequest(buffer, request)) {
+    mRequestCount++;
+    handleRequest(socket, request);
+    request = Request();
+  }
+}
+
+bool MockAsposeServer::takeRequest(QByteArray& buffer, Request& request)
+{
+  const int headerEnd = buffer.indexOf("\r\n\r\n");
+  if (headerEnd < 0) return false;
+
+  auto lines = buffer.left(headerEnd).split('\n');
+  auto requestLine = lines.takeFirst().trimmed().split(' ');
+  if (requestLine.size() < 2) {
+    buffer.clear();
+    return false;
+  }
+  for (const auto& line : lines) {
+    const int colon = line.indexOf(':');
+    if (colon > 0) request.headers.insert(line.left(colon).trimmed().toLower(), line.mid(colon + 1).trimmed());
+  }
+  const int contentLength = request.headers.value("content-length", "0").toInt();
+  if (buffer.size() < headerEnd + 4 + contentLength) return false;
+
+  request.method = requestLine[0];
+  request.path = requestLine[1];
+  request.body = buffer.mid(headerEnd + 4, contentLength);
+  buffer.remove(0, headerEnd + 4 + contentLength);
+  return true;
+}
+
+void MockAsposeServer::handleRequest(QTcpSocket* socket, const Request& request)
+{
+  const QUrl url(QString::fromLatin1(request.path));
+  const QString path = url.path();
+
+  if (path == "/connect/token") {
+    sendResponse(socket, 200, "application/json", R"({"access_token":"mock-token","expires_in":3600})");
+  }
+  else if (request.method == "PUT" && path.startsWith("/v3.0/slides/storage/file/")) {
+    QJsonArray uploaded;
+    if (request.headers.value("content-type").startsWith("multipart/")) {
+      // batch upload into the folder, the files are named by the parts
+      QRegularExpression filenameExpression("filename=\"([^\"]+)\"");
+      auto matches = filenameExpression.globalMatch(QString::fromLatin1(request.body));
+      while (matches.hasNext()) {
+        const auto filename = matches.next().captured(1);
+        mStoredFiles.insert(path + "/" + filename);
+        uploaded.append(filename);
+      }
+    }
+    else {
+      mStoredFiles.insert(path);
+      uploaded.append(path.section('/', -1));
+    }
+    QJsonObject object;
+    object["uploaded"] = uploaded;
+    object["errors"] = QJsonArray();
+    sendResponse(socket, 200, "application/json", QJsonDocument(object).toJson(QJsonDocument::Compact));
+  }
+  else if (request.method == "GET" && path.startsWith("/v3.0/slides/storage/exist/")) {
+    const auto storedPath = QString(path).replace("/storage/exist/", "/storage/file/");
+    QJsonObject object;
+    object["exists"] = mStoredFiles.contains(storedPath);
+    object["isFolder"] = false;
+    sendResponse(socket, 200, "application/json", QJsonDocument(object).toJson(QJsonDocument::Compact));
+  }
+  else if (request.method == "DELETE" && path.startsWith("/v3.0/slides/storage/")) {
+    mStoredFiles.remove(path);
+    sendResponse(socket, 200, "application/json", "{}");
+  }
+  else if (request.method == "GET" && path.startsWith("/v3.0/slides/storage/file/")) {
+    auto filename = path.section('/', -1);
+    sendResponse(socket, 200, "image/png", mSlidePng, QString("Content-Disposition: attachment; filename=%1\r\n").arg(filename).toLatin1());
+  }
+  else if (request.method == "POST" && path.endsWith("/split")) {
+    // slides are stored in the requested destination folder
+    auto folder = QUrlQuery(url).queryItemValue("destFolder", QUrl::FullyDecoded);
+    QJsonArray slides;
+    for (int i = 1; i <= mSlideCount; ++i) {
+      QUrl href = this->url();
+      href.setPath(QString("/v3.0/slides/storage/file/%1/slide_%2.png").arg(folder).arg(i));
+      slides.append(QJsonObject({ { "href", href.toString() } }));
+    }
+    sendResponse(socket, 200, "application/json", QJsonDocument(QJsonObject({ { "slides", slides } })).toJson(QJsonDocument::Compact));
+  }
+  else if (request.method == "POST" && path == "/v3.0/slides/convert/Png") {
+    // the content is irrelevant for the converter, it is only saved
+    QByteArray result;
+    for (int i = 0; i < mSlideCount; ++i) result.append(mSlidePng);
+    sendResponse(socket, 200, "application/zip", result, "Content-Disposition: attachment; filename=result.zip\r\n");
+  }
+  else {
+    sendResponse(socket, 404, "application/json", R"({"error":{"code":"NotFound"}})");
+  }
+}
+
+void MockAsposeServer::sendResponse(QTcpSocket* socket, int status, const QByteArray& contentType, const QByteArray& body, const QByteArray& extraHeaders)
+{
+  QByteArray response;
+  response += QString("HTTP/1.1 %1 %2\r\n").arg(status).arg(status == 200 ? "OK" : "Error").toLatin1();
+  response += "Content-Type: " + contentType + "\r\n";
+  response += "Content-Length: " + QByteArray::number(body.size()) + "\r\n";
+  response += "Connection: keep-alive\r\n";
+  response += extraHeaders;
+  response += "\r\n";
+  response += body;
+  socket->write(response);
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <QObject>
+#include <QTcpServer>
+#include <QHash>
+#include <QSet>
+#include <QByteArray>
+#include <QUrl>
+
+class QTcpSocket;
+
+// Minimal local HTTP endpoint mimicking the Aspose cloud API used by the
+// converter (token, storage upload, split, slide download, convert).
+// Supports keep-alive connections. Only meant for soak and load tests.
+
+class MockAsposeServer : public QObject
+{
+  Q_OBJECT
+
+public:
+  explicit MockAsposeServer(QObject* parent = nullptr);
+
+  // listen on localhost, port 0 = any free port
+  bool start(quint16 port = 0);
+  QUrl url() const;
+
+  void setSlideCount(int slideCount) { mSlideCount = slideCount; }
+  qint64 requestCount() const { return mRequestCount; }
+
+private slots:
+  void onNewConnection();
+  void onReadyRead();
+
+private:
+  struct Request {
+    QByteArray method;
+    QByteArray path;
+    QHash<QByteArray, QByteArray> headers;
+    QByteArray body;
+  };
+  // parse one complete request from the buffer, false if more data is needed
+  bool takeRequest(QByteArray& buffer, Request& request);
+  void handleRequest(QTcpSocket* socket, const Request& request);
+  void sendResponse(QTcpSocket* socket, int status, const QByteArray& contentType, const QByteArray& body, const QByteArray& extraHeaders = QByteArray());
+
+  QTcpServer mServer;
+  QHash<QTcpSocket*, QByteArray> mBuffers;
+  QByteArray mSlidePng;
+  int mSlideCount = 10;
+  // paths of the uploaded files
+  QSet<QString> mStoredFiles;
+  qint64 mRequestCount = 0;
+};
@@ -4,12 +4,30 @@
 #include <QTime>
 #include <QBitmap>
 #include <QProcess>
+#include <QElapsedTimer>
+#include <QSaveFile>
+#include <QScrollBar>
+#include <QFutureWatcher>
+#include <QScopeGuard>
+#include <QtConcurrent/QtConcurrentRun>
+#include <algorithm>
+#include <memory>
+#include "Metrics.h"
+#include "AsyncFileWriter.h"
+#include "ImageKernels.h"
+#include "FrameBufferPool.h"
+#include "FrameRing.h"
+#include "PresentationCache.h"
+#include "SlideFingerprint.h"
+#include "SlideImageStore.h"
+#include "TiledRenderer.h"
 
 #include <Export/SaveFormat.h>
 #include <DOM/Presentation.h>
 #include <DOM/ISlideCollection.h>
 #include <DOM/ISlide.h>
 #include <DOM/ISlidesize.h>
+#include <Export/RenderingOptions.h>
 #include <drawing/imaging/image_format.h>
 #include <drawing/image.h>
 #include <system/string.h>
@@ -17,8 +35,28 @@
 #include <system/io/memory_stream.h>
 #include <system/io/file_stream.h>
 #include <drawing/bitmap.h>
+#include <drawing/color.h>
+#include <drawing/graphics.h>
+#include <drawing/rectangle.h>
+#include <drawing/imaging/bitmap_data.h>
 #include <system/io/directory.h>
 
+namespace {
+  // abort cloud conversions taking longer than this
+  const int kConversionDeadlineMsecs = 120 * 1000;
+  // slide store spec of the SVG written by the local engine
+  const QString kSvgSpec = "local-svg";
+  // PNG output beyond 4K is rendered by the TiledRenderer
+  const qint64 kTiledRenderPixels = 3840 * 2160;
+
+  // empty a reused memory stream, its buffer stays allocated
+  void rewind(const System::SharedPtr<System::IO::MemoryStream>& stream)
+  {
+    stream->SetLength(0);
+    stream->set_Position(0);
+  }
+}
+
 //using namespace Aspose::Slides;
 //using System::Drawing::Imaging::ImageFormat;
 //using System::IO::Path;
@@ -27,8 +65,17 @@ PPTXConverterTestApp::PPTXConverterTestApp(QWidget* parent)
   : QMainWindow(parent)
 {
   ui.setupUi(this);
+  // the TiledRenderer renders one slide at a time, its own threads cut it into bands
+  mTileJobs.setMaxThreadCount(1);
   ui.progressBar->setValue(0);
   ui.scrollArea->setBackgroundRole(QPalette::Dark);
+  // the slides scrolled into view are rendered first
+  connect(ui.scrollArea->horizontalScrollBar(), &QScrollBar::valueChanged, this, &PPTXConverterTestApp::updateVisibleSlides);
+  connect(ui.scrollArea->horizontalScrollBar(), &QScrollBar::rangeChanged, this, &PPTXConverterTestApp::updateVisibleSlides);
+  // vector previews follow the thumbnail size without another Aspose render
+  connect(ui.spinBoxX, QOverload<int>::of(&QSpinBox::valueChanged), this, &PPTXConverterTestApp::onThumbnailSizeChanged);
+  connect(ui.spinBoxY, QOverload<int>::of(&QSpinBox::valueChanged), this, &PPTXConverterTestApp::onThumbnailSizeChanged);
+  connect(&mSvgPreview, &SvgPreview::previewReady, this, &PPTXConverterTestApp::onPreviewReady);
 
   mConverter = new PowerPointConverter();
   mConverter->moveToThread(&mConverterThread);
@@ -38,12 +85,20 @@ PPTXConverterTestApp::PPTXConverterTestApp(QWidget* parent)
   connect(mConverter, &PowerPointConverter::progress, this, &PPTXConverterTestApp::onConverterProgress);
   connect(mConverter, &PowerPointConverter::statusChanged, this, &PPTXConverterTestApp::onConverterStatusChanged);
   connect(mConverter, &PowerPointConverter::debug, this, &PPTXConverterTestApp::onConverterDebug);
-  connect(this, &PPTXConverterTestApp::startProcessing, mConverter, &PowerPointConverter::convertPowerpointFile2);
+  connect(this, &PPTXConverterTestApp::startProcessing, mConverter, &PowerPointConverter::convertPowerpointFileAuto);
+  connect(this, &PPTXConverterTestApp::cancelProcessing, mConverter, &PowerPointConverter::cancelConversion);
+  // converter thread is not started yet, safe to call directly
+  mConverter->setConversionDeadline(kConversionDeadlineMsecs);
   mConverterThread.start();
+  // continue the cloud conversions interrupted by a crash
+  QMetaObject::invokeMethod(mConverter, &PowerPointConverter::resumeUnfinishedJobs, Qt::QueuedConnection);
 }
 
 PPTXConverterTestApp::~PPTXConverterTestApp()
 {
+  // the queued tiled PNGs are skipped, the running one finishes its file
+  if (mTileJobsCancelled) *mTileJobsCancelled = true;
+  mTileJobs.waitForDone();
   mConverter->deleteLater();
   mConverterThread.quit();
   mConverterThread.wait();
@@ -58,9 +113,23 @@ void PPTXConverterTestApp::on_actionOpen_triggered()
 void PPTXConverterTestApp::on_pushButton_clicked()
 {
   auto filename = ui.lineEdit->text();
-  if (filename.isEmpty()) return;
+  if (filename.isEmpty() || mLocalRenderRunning) return;
+
+  // processEvents runs below, a second click must not clear the labels under the loop
+  mLocalRenderRunning = true;
+  const int job = ++mLocalRenderJob;
+  ui.pushButton->setEnabled(false);
+  ui.pushButtonCloud->setEnabled(false);
+  auto renderDone = qScopeGuard([this]() {
+    mLocalRenderRunning = false;
+    ui.pushButton->setEnabled(true);
+    ui.pushButtonCloud->setEnabled(true);
+  });
 
   ui.plainTextEdit->clear();
+  mSlideLabels.clear();
+  mRenderQueue.reset(0);
+  mSvgPreview.clear();
   while (ui.scrollAreaWidgetContents->layout()->count() > 0) {
     auto* item = ui.scrollAreaWidgetContents->layout()->itemAt(0);
     ui.scrollAreaWidgetContents->layout()->removeItem(item);
@@ -68,12 +137,24 @@ void PPTXConverterTestApp::on_pushButton_clicked()
     delete item;
   }
 
+  auto& registry = MetricsRegistry::instance();
+  auto& openDuration = registry.histogram("pptx_converter_stage_duration_seconds", "Duration of the conversion stages", "stage=\"local_open\"");
+  auto& renderDuration = registry.histogram("pptx_converter_stage_duration_seconds", "Duration of the conversion stages", "stage=\"local_render_slide\"");
+  auto& slidesCounter = registry.counter("pptx_converter_slides_total", "Converted slides", "path=\"local\"");
+  registry.counter("pptx_converter_jobs_started_total", "Conversions started", "path=\"local\"").increment();
+  QElapsedTimer jobTimer;
+  jobTimer.start();
+
   QTime time;
   System::String input(filename.toStdU16String());
 
   time.start();
-  auto pres = System::MakeObject<Aspose::Slides::Presentation>(input);
-  ui.plainTextEdit->appendPlainText(QString("Opening %1 took %2 ms...").arg(filename).arg(time.elapsed()));
+  // parsed once, rendering the unchanged file again reuses it
+  bool cached = false;
+  auto pres = PresentationCache::instance().open(filename, &cached);
+  openDuration.observeMsecs(time.elapsed());
+  ui.plainTextEdit->appendPlainText(QString("Opening %1 took %2 ms%3...").arg(filename).arg(time.elapsed()).arg(cached ? " (cached)" : ""));
+  ui.plainTextEdit->appendPlainText(QString("> Presentation cache: %1 files, %2 MB").arg(PresentationCache::instance().count()).arg(PresentationCache::instance().usedBytes() / (1024 * 1024)));
 
   auto count = pres->get_Slides()->get_Count();
   auto size = pres->get_SlideSize()->get_Size();
@@ -84,63 +165,260 @@ void PPTXConverterTestApp::on_pushButton_clicked()
   ui.progressBar->setMaximum(count - 1);
   ui.progressBar->setValue(0);
   QApplication::processEvents();
+  if (job != mLocalRenderJob) return;
+  mLocalRenderCancelled = false;
+  QStringList writtenFiles;
 
   int desiredW = ui.spinBoxX->value();
   int desiredH = ui.spinBoxY->value();
-  float ScaleX = (float)(1.0 / sizeW) * desiredW;
-  float ScaleY = (float)(1.0 / sizeH) * desiredH;
   auto PngScale = ui.doubleSpinBox->value();
 
 
+  ui.plainTextEdit->appendPlainText(QString("Image kernels: %1").arg(ImageKernels::instructionSet()));
+  auto frameRing = FrameRing::instance();
+  if (frameRing) {
+    frameRing->beginGeneration(count);
+    ui.plainTextEdit->appendPlainText(QString("Publishing frames to '%1'").arg(frameRing->key()));
+  }
+  // placeholders for all slides, so the visible ones are known before they are rendered
+  for (int i = 0; i < count; ++i) {
+    auto* imageLabel = new QLabel(QString("Slide %1").arg(i + 1));
+    imageLabel->setStyleSheet("border: 1px solid black");
+    imageLabel->setAlignment(Qt::AlignCenter);
+    imageLabel->setFixedSize(desiredW + 2, desiredH + 2);
+    ui.scrollAreaWidgetContents->layout()->addWidget(imageLabel);
+    mSlideLabels << imageLabel;
+  }
+  mRenderQueue.reset(count);
+  QApplication::processEvents();
+  if (job != mLocalRenderJob) return;
+  updateVisibleSlides();
+
+  // renders of identical slides in this or other decks are reused
+  QElapsedTimer fingerprintTimer;
+  fingerprintTimer.start();
+  const auto fingerprints = SlideFingerprint::compute(filename);
+  auto& slideStore = SlideImageStore::instance();
+  const QString pngSpec = SlideImageStore::localPngSpec(PngScale);
+  ui.plainTextEdit->appendPlainText(QString("Fingerprinted %1 slides in %2 ms").arg(fingerprints.count()).arg(fingerprintTimer.elapsed()));
+
+  // the preview mode skips PNG output and frame publishing
+  const bool vectorPreview = ui.checkBoxVectorPreview->isChecked();
+  // frames for LED walls are rendered in tiles, never as one bitmap
+  const bool tiledOutput = !vectorPreview && qRound64(sizeW * PngScale) * qRound64(sizeH * PngScale) > kTiledRenderPixels;
+  std::shared_ptr<TiledRenderer> tiledRenderer;
+  if (tiledOutput) {
+    // kept with the cached presentation, its copies are opened once per deck
+    tiledRenderer = PresentationCache::instance().tiledRenderer(filename);
+    mTileJobsCancelled = std::make_shared<std::atomic<bool>>(false);
+    ui.plainTextEdit->appendPlainText(QString("Tiled rendering of %1x%2 frames on %3 threads").arg(qRound(sizeW * PngScale)).arg(qRound(sizeH * PngScale)).arg(tiledRenderer->threadCount()));
+  }
+  // allocated once per deck instead of once per slide
+  auto& bufferPool = FrameBufferPool::instance();
+  auto svgStream = System::MakeObject<System::IO::MemoryStream>();
+  auto pngStream = System::MakeObject<System::IO::MemoryStream>();
+  auto renderingOptions = System::MakeObject<Aspose::Slides::Export::RenderingOptions>();
+  System::SharedPtr<System::Drawing::Bitmap> frame;
   ui.plainTextEdit->appendPlainText(QString("\nStarting conversion to SVG").arg(filename));
-  for (int i = 0; i < count; ++i)
+  int rendered = 0;
+  // visible and background slides alike, one at a time (see RenderQueue.h)
+  for (int i; (i = mRenderQueue.takeNext()) >= 0; )
   {
     auto slide = pres->get_Slides()->idx_get(i);
     ui.plainTextEdit->appendPlainText(QString("> Page %1/%2").arg(i + 1).arg(count));
+    QElapsedTimer slideTimer;
+    slideTimer.start();
 
     // save as SVG
     time.start();
     System::String outputSlideNameSvg = System::IO::Path::GetFileNameWithoutExtension(input) + u"_" + System::ObjectExt::ToString(i) + u".svg";
-    auto fileStream = System::MakeObject<System::IO::FileStream>(outputSlideNameSvg, System::IO::FileMode::Create, System::IO::FileAccess::Write);
-    slide->WriteAsSvg(fileStream);
-    ui.plainTextEdit->appendPlainText(QString("> SVG %1/%2 : %3ms").arg(sizeW * PngScale).arg(sizeH * PngScale).arg(time.elapsed()));
-
-    // get thumbnail bitmap
-    time.start();
-    auto fullres = slide->GetThumbnail(PngScale, PngScale);
-    auto thumbnail = slide->GetThumbnail(ScaleX, ScaleY);
-    ui.plainTextEdit->appendPlainText(QString("> GetThumbnails : %3ms").arg(time.elapsed()));
-
-    // save to PNG
-    time.start();
-    System::String outputSlideNamePng = System::IO::Path::GetFileNameWithoutExtension(input) + u"_" + System::ObjectExt::ToString(i) + u".png";
-    slide->GetThumbnail(PngScale, PngScale)->Save(outputSlideNamePng, System::Drawing::Imaging::ImageFormat::get_Png());
-    ui.plainTextEdit->appendPlainText(QString("> PNG %1/%2 : %3ms").arg(sizeW * PngScale).arg(sizeH * PngScale).arg(time.elapsed()));
-
-    // save to memory BMP full res
-    time.start();
-    auto iostream = System::MakeObject<System::IO::MemoryStream>();
-    fullres->Save(iostream.dynamic_pointer_cast<System::IO::Stream>(), System::Drawing::Imaging::ImageFormat::get_MemoryBmp());
-    auto buffer = iostream->GetBuffer();
-    auto dataptr = buffer->data_ptr();
-    ui.plainTextEdit->appendPlainText(QString("> Memory bitmap %1/%2 : %3ms").arg(sizeW * PngScale).arg(sizeH * PngScale).arg(time.elapsed()));
-
-    //ui.plainTextEdit->appendPlainText(QString("> Thumb: %1/%2: %3ms").arg(sizeW * ScaleX).arg(sizeH * ScaleY).arg(time.elapsed()));
+    // identical slides of any deck are rendered once
+    const QByteArray fingerprint = fingerprints.value(i);
+    QByteArray svg = slideStore.find(fingerprint, kSvgSpec);
+    const bool svgStored = !svg.isEmpty();
+    if (!svgStored) {
+      rewind(svgStream);
+      slide->WriteAsSvg(svgStream);
+      svg = bufferPool.bytes(svgStream);
+      slideStore.store(fingerprint, kSvgSpec, svg);
+    }
+    writtenFiles << QString::fromStdU16String(outputSlideNameSvg.ToU16Str());
+    // the disk write happens on the file writer thread
+    AsyncFileWriter::instance().write(writtenFiles.last(), svg);
+    ui.plainTextEdit->appendPlainText(QString("> SVG %1/%2 : %3ms%4").arg(sizeW * PngScale).arg(sizeH * PngScale).arg(time.elapsed()).arg(svgStored ? " (stored)" : ""));
+
+    if (vectorPreview) {
+      // the gallery renders the vectors in the background, no bitmap from Aspose
+      mSvgPreview.setSlide(i, svg);
+      mSvgPreview.render(i, QSize(ui.spinBoxX->value(), ui.spinBoxY->value()));
+    }
+    else if (tiledOutput) {
+      // streamed to disk tile row by tile row on the tile job thread, not kept in the slide store
+      System::String outputSlideNamePng = System::IO::Path::GetFileNameWithoutExtension(input) + u"_" + System::ObjectExt::ToString(i) + u".png";
+      writtenFiles << QString::fromStdU16String(outputSlideNamePng.ToU16Str());
+      queueTiledPng(tiledRenderer, i, PngScale, writtenFiles.last());
+
+      // the thumbnail is rendered at its own size, the full frame is too big for the frame ring
+      time.start();
+      const float thumbnailScale = std::min(desiredW / sizeW, desiredH / sizeH);
+      QImage image = bufferPool.image(desiredW, desiredH, QImage::Format_ARGB32_Premultiplied);
+      auto thumbnail = slide->GetThumbnail(thumbnailScale, thumbnailScale);
+      auto bits = thumbnail->LockBits(System::Drawing::Rectangle(0, 0, thumbnail->get_Width(), thumbnail->get_Height()),
+        System::Drawing::Imaging::ImageLockMode::ReadOnly, System::Drawing::Imaging::PixelFormat::Format32bppArgb);
+      ImageKernels::letterbox(reinterpret_cast<const uint8_t*>(static_cast<intptr_t>(bits->get_Scan0())), thumbnail->get_Width(), thumbnail->get_Height(),
+        bits->get_Stride(), image.bits(), desiredW, desiredH, image.bytesPerLine(), 0xFFFFFFFF, ImageKernels::Filter::kBox);
+      thumbnail->UnlockBits(bits);
+      for (int y = 0; y < desiredH; ++y) {
+        ImageKernels::premultiplyAlpha(image.scanLine(y), image.scanLine(y), desiredW);
+      }
+      ui.plainTextEdit->appendPlainText(QString("> Thumbnail %1/%2 : %3ms").arg(desiredW).arg(desiredH).arg(time.elapsed()));
+      mSlideLabels[i]->setPixmap(QPixmap::fromImage(image));
+    }
+    else {
+      // render once at full resolution, everything else is derived from it
+      time.start();
+      QByteArray png = slideStore.find(fingerprint, pngSpec);
+      // a stored render is decoded instead of rendered
+      QImage decoded;
+      if (!png.isEmpty()) decoded = bufferPool.decode(png, "PNG").convertToFormat(QImage::Format_ARGB32);
+      const bool pngStored = !decoded.isNull();
+      if (!pngStored) {
+        // every slide is drawn into the bitmap of the previous one
+        if (!frame) {
+          frame = System::MakeObject<System::Drawing::Bitmap>(qRound(sizeW * PngScale), qRound(sizeH * PngScale), System::Drawing::Imaging::PixelFormat::Format32bppArgb);
+        }
+        auto graphics = System::Drawing::Graphics::FromImage(frame);
+        graphics->Clear(System::Drawing::Color::get_White());
+        slide->RenderToGraphics(renderingOptions, graphics, PngScale, PngScale);
+        graphics->Flush();
+        ui.plainTextEdit->appendPlainText(QString("> RenderToGraphics : %1ms").arg(time.elapsed()));
+        time.start();
+        rewind(pngStream);
+        frame->Save(pngStream.dynamic_pointer_cast<System::IO::Stream>(), System::Drawing::Imaging::ImageFormat::get_Png());
+        png = bufferPool.bytes(pngStream);
+        slideStore.store(fingerprint, pngSpec, png);
+      }
+
+      // save to PNG
+      System::String outputSlideNamePng = System::IO::Path::GetFileNameWithoutExtension(input) + u"_" + System::ObjectExt::ToString(i) + u".png";
+      writtenFiles << QString::fromStdU16String(outputSlideNamePng.ToU16Str());
+      AsyncFileWriter::instance().write(writtenFiles.last(), png);
+      ui.plainTextEdit->appendPlainText(QString("> PNG %1/%2 : %3ms%4").arg(sizeW * PngScale).arg(sizeH * PngScale).arg(time.elapsed()).arg(pngStored ? " (stored)" : ""));
+
+      // scale the full resolution pixels down to the preview size
+      time.start();
+      System::SharedPtr<System::Drawing::Imaging::BitmapData> bits;
+      const uint8_t* pixels = nullptr;
+      int fullW = 0;
+      int fullH = 0;
+      int stride = 0;
+      if (!pngStored) {
+        fullW = frame->get_Width();
+        fullH = frame->get_Height();
+        bits = frame->LockBits(System::Drawing::Rectangle(0, 0, fullW, fullH),
+          System::Drawing::Imaging::ImageLockMode::ReadOnly, System::Drawing::Imaging::PixelFormat::Format32bppArgb);
+        // Format32bppArgb has the memory layout of QImage::Format_ARGB32
+        pixels = reinterpret_cast<const uint8_t*>(static_cast<intptr_t>(bits->get_Scan0()));
+        stride = bits->get_Stride();
+      }
+      else {
+        fullW = decoded.width();
+        fullH = decoded.height();
+        pixels = decoded.constBits();
+        stride = decoded.bytesPerLine();
+      }
+      QImage image = bufferPool.image(desiredW, desiredH, QImage::Format_ARGB32_Premultiplied);
+      ImageKernels::letterbox(pixels, fullW, fullH, stride, image.bits(), desiredW, desiredH,
+        image.bytesPerLine(), 0xFFFFFFFF, ImageKernels::Filter::kBox);
+      // raw frame for compositors, no PNG round trip
+      if (frameRing) frameRing->publishBgra(i, pixels, fullW, fullH, stride);
+      if (bits) frame->UnlockBits(bits);
+      // slides are opaque, so premultiplying after scaling is exact
+      for (int y = 0; y < desiredH; ++y) {
+        ImageKernels::premultiplyAlpha(image.scanLine(y), image.scanLine(y), desiredW);
+      }
+      ui.plainTextEdit->appendPlainText(QString("> Thumbnail %1/%2 : %3ms").arg(desiredW).arg(desiredH).arg(time.elapsed()));
+
+      // show the thumbnail in the slide's placeholder
+      mSlideLabels[i]->setPixmap(QPixmap::fromImage(image));
+      // back to the pool once the file writer is done with it
+      bufferPool.recycle(std::move(png));
+    }
+    bufferPool.recycle(std::move(svg));
+
+    renderDuration.observeMsecs(slideTimer.elapsed());
+    slidesCounter.increment();
 
     // qt stuff
-    ui.progressBar->setValue(i);
-
-    // create label to show thumbnail
-    auto* imageLabel = new QLabel;
-    imageLabel->setStyleSheet("border: 1px solid black");
-    QImage image;
-    image.loadFromData(dataptr, buffer->get_Length());
-    imageLabel->setPixmap(QPixmap::fromImage(image));
-    ui.scrollAreaWidgetContents->layout()->addWidget(imageLabel);
+    ui.progressBar->setValue(rendered++);
 
     // update ui
     QApplication::processEvents();
+    if (job != mLocalRenderJob) return;
+
+    // the cancel button is handled during processEvents
+    if (mLocalRenderCancelled) {
+      // queued files must be on disk before they can be removed
+      if (mTileJobsCancelled) *mTileJobsCancelled = true;
+      mTileJobs.waitForDone();
+      AsyncFileWriter::instance().flush();
+      for (const auto& file : writtenFiles) {
+        QFile::remove(file);
+      }
+      ui.plainTextEdit->appendPlainText(QString("Cancelled after %1/%2 pages, removed %3 files").arg(rendered).arg(count).arg(writtenFiles.count()));
+      break;
+    }
   }
+
+  // the images and fonts are loaded now, the cache sizes the presentation again
+  PresentationCache::instance().updateSize(filename);
+  const auto poolStats = bufferPool.stats();
+  ui.plainTextEdit->appendPlainText(QString("> Buffer pool: %1 hits, %2 misses, peak %3 MB")
+    .arg(poolStats.hits).arg(poolStats.misses).arg(poolStats.peakBytes / (1024 * 1024)));
+  registry.histogram("pptx_converter_job_duration_seconds", "Duration of whole conversions", "path=\"local\"").observeMsecs(jobTimer.elapsed());
+  auto result = mLocalRenderCancelled ? "cancelled" : "finished";
+  registry.counter("pptx_converter_jobs_total", "Conversions ended by result", QString("path=\"local\",result=\"%1\"").arg(result)).increment();
+}
+
+void PPTXConverterTestApp::queueTiledPng(const std::shared_ptr<TiledRenderer>& renderer, int index, float scale, const QString& filepath)
+{
+  const float width = renderer->slideWidth() * scale;
+  const float height = renderer->slideHeight() * scale;
+  // the job owns its file and shares the renderer, nothing of the render loop is referenced
+  auto cancelled = mTileJobsCancelled;
+  auto future = QtConcurrent::run(&mTileJobs, [renderer, cancelled, index, scale, filepath]() {
+    QElapsedTimer timer;
+    timer.start();
+    TiledPngResult result;
+    if (*cancelled) {
+      result.error = "cancelled";
+      return result;
+    }
+    QSaveFile pngFile(filepath);
+    if (!pngFile.open(QIODevice::WriteOnly)) {
+      result.error = pngFile.errorString();
+    }
+    else if (renderer->renderSlide(index, scale, &pngFile, &result.error) && !pngFile.commit()) {
+      result.error = pngFile.errorString();
+    }
+    result.msecs = timer.elapsed();
+    return result;
+  });
+  auto* watcher = new QFutureWatcher<TiledPngResult>(this);
+  const int job = mLocalRenderJob;
+  connect(watcher, &QFutureWatcher<TiledPngResult>::finished, this, [this, watcher, job, width, height]() {
+    watcher->deleteLater();
+    // finished after the next render started, whose log doesn't show this slide
+    if (job != mLocalRenderJob) return;
+    const auto result = watcher->result();
+    if (!result.error.isEmpty()) {
+      ui.plainTextEdit->appendPlainText(QString("> Tiled PNG failed: %1").arg(result.error));
+    }
+    else {
+      ui.plainTextEdit->appendPlainText(QString("> Tiled PNG %1/%2 : %3ms").arg(width).arg(height).arg(result.msecs));
+    }
+  });
+  watcher->setFuture(future);
 }
 
 #include <asposeslidescloud/api/SlidesApi.h>
@@ -154,7 +432,16 @@ void PPTXConverterTestApp::on_pushButtonCloud_clicked()
 
   auto input = utility::conversions::to_string_t((filename.toUtf8().constData()));
 
-  auto api = std::make_shared<asposeslidescloud::api::SlidesApi>(utility::conversions::to_string_t("71ac8316-49ca-4e4a-84dd-7d5941ccaafc"), utility::conversions::to_string_t("8dc30cfec1501a6b574b08de50cdca4c"));
+  // credentials from the shared pool instead of a hard-coded pair
+  auto credentials = CredentialPool::instance();
+  const CredentialPool::Lease lease(credentials, credentials->acquireAccount());
+  const int account = lease.account();
+  if (account < 0) {
+    ui.plainTextEdit->appendPlainText("No cloud credentials configured");
+    return;
+  }
+  auto credential = credentials->credential(account);
+  auto api = std::make_shared<asposeslidescloud::api::SlidesApi>(utility::conversions::to_string_t(credential.clientId.toUtf8().constData()), utility::conversions::to_string_t(credential.clientSecret.toUtf8().constData()));
   auto httpRequest = std::make_shared<asposeslidescloud::api::HttpContent>();
 
   auto inputfilestream = std::make_shared<std::ifstream>(filename.toUtf8().constData(), std::ios::binary);
@@ -174,21 +461,30 @@ void PPTXConverterTestApp::on_pushButtonCloud_clicked()
   QTime time;
   time.start();
   const bool saveToCloud = false;
-  if (saveToCloud) {
-    // save to cloud storage
-    auto outpath = utility::conversions::to_string_t("test234");
-    api->convertAndSave(httpRequest, format, outpath).get();
-    // saved as test234.zip
+  try {
+    // the SDK requests a token first, both count against the account's quota
+    credentials->waitForRequest(account);
+    credentials->waitForRequest(account);
+    if (saveToCloud) {
+      // save to cloud storage
+      auto outpath = utility::conversions::to_string_t("test234");
+      api->convertAndSave(httpRequest, format, outpath).get();
+      // saved as test234.zip
+    }
+    else {
+      // save locally
+      std::ofstream fs("output.zip", std::ios::binary);
+      auto response = api->convert(httpRequest, format, password, storage, fontsFolder, slides, exportOptions).get();
+      ui.plainTextEdit->appendPlainText(QString("> Upload, convert, and download took %1 ms").arg(time.elapsed()));
+      time.start();
+      response.writeTo(fs);
+      fs.close();
+      ui.plainTextEdit->appendPlainText(QString("> Saving locally took %1 ms").arg(time.elapsed()));
+    }
+    credentials->reportSuccess(account);
   }
-  else {
-    // save locally
-    std::ofstream fs("output.zip", std::ios::binary);
-    auto response = api->convert(httpRequest, format, password, storage, fontsFolder, slides, exportOptions).get();
-    ui.plainTextEdit->appendPlainText(QString("> Upload, convert, and download took %1 ms").arg(time.elapsed()));
-    time.start();
-    response.writeTo(fs);
-    fs.close();
-    ui.plainTextEdit->appendPlainText(QString("> Saving locally took %1 ms").arg(time.elapsed()));
+  catch (const std::exception& exception) {
+    ui.plainTextEdit->appendPlainText(QString("> Cloud conversion failed: %1").arg(exception.what()));
   }
 }
 
@@ -200,6 +496,50 @@ void PPTXConverterTestApp::on_pushButtonCloudQt_clicked()
   emit startProcessing(ui.lineEdit->text(), "download");
 }
 
+void PPTXConverterTestApp::on_pushButtonCancel_clicked()
+{
+  mLocalRenderCancelled = true;
+  emit cancelProcessing();
+}
+
+void PPTXConverterTestApp::prioritizeSlide(int index)
+{
+  mRenderQueue.request(index);
+}
+
+void PPTXConverterTestApp::updateVisibleSlides()
+{
+  if (mSlideLabels.isEmpty()) return;
+  const int left = ui.scrollArea->horizontalScrollBar()->value();
+  const int right = left + ui.scrollArea->viewport()->width();
+  int first = -1;
+  int last = -2;
+  for (int i = 0; i < mSlideLabels.count(); ++i) {
+    const auto geometry = mSlideLabels[i]->geometry();
+    if (geometry.right() < left || geometry.left() > right) continue;
+    if (first < 0) first = i;
+    last = i;
+  }
+  mRenderQueue.setVisibleRange(first, last);
+}
+
+void PPTXConverterTestApp::onThumbnailSizeChanged()
+{
+  if (mSvgPreview.count() == 0) return;
+  const QSize size(ui.spinBoxX->value(), ui.spinBoxY->value());
+  for (auto* label : mSlideLabels) {
+    label->setFixedSize(size.width() + 2, size.height() + 2);
+  }
+  mSvgPreview.renderAll(size);
+}
+
+void PPTXConverterTestApp::onPreviewReady(int index, const QImage& image)
+{
+  // drop the renders of a size that was changed meanwhile
+  if (index >= mSlideLabels.count() || image.size() != QSize(ui.spinBoxX->value(), ui.spinBoxY->value())) return;
+  mSlideLabels[index]->setPixmap(QPixmap::fromImage(image));
+}
+
 void PPTXConverterTestApp::on_actionExtract_triggered()
 {
   QProcess process;
@@ -1,8 +1,15 @@
 #pragma once
 
 #include <QtWidgets/QMainWindow>
+#include <QThreadPool>
+#include <atomic>
+#include <memory>
 #include "ui_PPTXConverterTest.h"
 #include "PowerPointConverter.h"
+#include "RenderQueue.h"
+#include "SvgPreview.h"
+
+class TiledRenderer;
 
 class PPTXConverterTestApp : public QMainWindow
 {
@@ -12,11 +19,16 @@ public:
   PPTXConverterTestApp(QWidget* parent = Q_NULLPTR);
   ~PPTXConverterTestApp();
 
+public slots:
+  // render this slide of the running local conversion next
+  void prioritizeSlide(int index);
+
 private slots:
   void on_actionOpen_triggered();
   void on_pushButton_clicked();
   void on_pushButtonCloud_clicked();
   void on_pushButtonCloudQt_clicked();
+  void on_pushButtonCancel_clicked();
 
   void on_actionExtract_triggered();
 
@@ -25,13 +37,42 @@ private slots:
   void onConverterProgress(float value);
   void onConverterStatusChanged(const PowerPointConverter::PowerPointConverterStatus& status);
   void onConverterDone(const QStringList& generatedFiles);
+  void onThumbnailSizeChanged();
+  void onPreviewReady(int index, const QImage& image);
 
 signals:
   void startProcessing(const QString& filepath, const QString& targetpath);
+  void cancelProcessing();
 
 private:
+  // outcome of one tiled PNG job
+  struct TiledPngResult {
+    QString error;
+    qint64 msecs = 0;
+  };
+
+  // hand the slides in the viewport to the render queue
+  void updateVisibleSlides();
+  // render a slide beyond 4K into filepath on the tile job thread
+  void queueTiledPng(const std::shared_ptr<TiledRenderer>& renderer, int index, float scale, const QString& filepath);
 
   Ui::PPTXConverterTestUserInterface ui;
   QThread mConverterThread;
   PowerPointConverter* mConverter;
+  // set by the cancel button, checked by the local render loop between slides
+  bool mLocalRenderCancelled = false;
+  // the render buttons are disabled while this is set, the loop runs processEvents
+  bool mLocalRenderRunning = false;
+  // bumped per local render, the loop and its tiled jobs stop using a newer render's state
+  int mLocalRenderJob = 0;
+  // render order of the local conversion, follows the scroll position
+  RenderQueue mRenderQueue;
+  // one placeholder per slide, filled when the slide is rendered
+  QVector<QLabel*> mSlideLabels;
+  // gallery images of the vector preview mode
+  SvgPreview mSvgPreview;
+  // tiled PNG jobs, one at a time; the destructor waits for them
+  QThreadPool mTileJobs;
+  // set on cancel, the queued tiled PNGs of the render are skipped
+  std::shared_ptr<std::atomic<bool>> mTileJobsCancelled;
 };
@@ -0,0 +1,92 @@
+#include "PngStreamWriter.h"
+#include "ImageKernels.h"
+
+#include <QIODevice>
+#include <QtEndian>
+
+namespace {
+  const int kChunkBytes = 256 * 1024;
+  const char kSignature[] = { '\x89', 'P', 'N', 'G', '\r', '\n', '\x1a', '\n' };
+  // PNG row filter: each byte minus the same byte of the pixel to its left
+  const char kFilterSub = 1;
+
+  QByteArray bigEndian32(quint32 value)
+  {
+    QByteArray bytes(4, Qt::Uninitialized);
+    qToBigEndian(value, bytes.data());
+    return bytes;
+  }
+}
+
+PngStreamWriter::PngStreamWriter(QIODevice* device, int compressionLevel)
+  : mDevice(device)
+{
+  mStreamOpen = deflateInit(&mStream, compressionLevel) == Z_OK;
+}
+
+PngStreamWriter::~PngStreamWriter()
+{
+  if (mStreamOpen) deflateEnd(&mStream);
+}
+
+bool PngStreamWriter::writeChunk(const char* type, const QByteArray& data)
+{
+  const QByteArray typeAndData = QByteArray(type, 4) + data;
+  const quint32 crc = crc32(crc32(0, nullptr, 0), reinterpret_cast<const Bytef*>(typeAndData.constData()), typeAndData.size());
+  const QByteArray chunk = bigEndian32(data.size()) + typeAndData + bigEndian32(crc);
+  return mDevice->write(chunk) == chunk.size();
+}
+
+bool PngStreamWriter::begin(int width, int height)
+{
+  if (!mStreamOpen || width <= 0 || height <= 0) return false;
+  mWidth = width;
+  mHeight = height;
+  mRow = QByteArray(width * 4, Qt::Uninitialized);
+  mFiltered = QByteArray(width * 4 + 1, Qt::Uninitialized);
+  mOutput = QByteArray(kChunkBytes, Qt::Uninitialized);
+  mStream.next_out = reinterpret_cast<Bytef*>(mOutput.data());
+  mStream.avail_out = kChunkBytes;
+
+  // width, height, 8 bit, RGBA, deflate, adaptive filtering, no interlace
+  const QByteArray header = bigEndian32(width) + bigEndian32(height) + QByteArray("\x08\x06\x00\x00\x00", 5);
+  return mDevice->write(kSignature, sizeof(kSignature)) == sizeof(kSignature) && writeChunk("IHDR", header);
+}
+
+bool PngStreamWriter::deflateRow(int flush)
+{
+  mStream.next_in = reinterpret_cast<Bytef*>(mFiltered.data());
+  mStream.avail_in = flush == Z_FINISH ? 0 : static_cast<uInt>(mFiltered.size());
+  for (;;) {
+    const int status = deflate(&mStream, flush);
+    if (status == Z_STREAM_ERROR) return false;
+    const bool outputFull = mStream.avail_out == 0;
+    const bool done = flush == Z_FINISH ? status == Z_STREAM_END : mStream.avail_in == 0 && !outputFull;
+    if (outputFull || (done && flush == Z_FINISH)) {
+      if (!writeChunk("IDAT", mOutput.left(kChunkBytes - mStream.avail_out))) return false;
+      mStream.next_out = reinterpret_cast<Bytef*>(mOutput.data());
+      mStream.avail_out = kChunkBytes;
+    }
+    if (done) return true;
+  }
+}
+
+bool PngStreamWriter::writeRows(const uchar* bgra, int stride, int rows)
+{
+  for (int y = 0; y < rows && mRowsWritten < mHeight; ++y, ++mRowsWritten) {
+    auto* rgba = reinterpret_cast<uint8_t*>(mRow.data());
+    ImageKernels::swizzleRedBlue(bgra + static_cast<qint64>(y) * stride, rgba, mWidth);
+    auto* filtered = reinterpret_cast<uint8_t*>(mFiltered.data());
+    filtered[0] = kFilterSub;
+    for (int i = 0; i < 4; ++i) filtered[1 + i] = rgba[i];
+    for (int i = 4; i < mWidth * 4; ++i) filtered[1 + i] = static_cast<uint8_t>(rgba[i] - rgba[i - 4]);
+    if (!deflateRow(Z_NO_FLUSH)) return false;
+  }
+  return true;
+}
+
+bool PngStreamWriter::finish()
+{
+  if (mRowsWritten != mHeight) return false;
+  return deflateRow(Z_FINISH) && writeChunk("IEND", QByteArray());
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <QByteArray>
+#include <zlib.h>
+
+class QIODevice;
+
+// PNG encoder fed row by row, for images too big to be held in memory at
+// once (see TiledRenderer). Writes 8 bit RGBA with the Sub filter; the
+// deflate output is flushed to the device as IDAT chunks of 256 KB.
+
+class PngStreamWriter
+{
+public:
+  explicit PngStreamWriter(QIODevice* device, int compressionLevel = 3);
+  ~PngStreamWriter();
+
+  // signature and header, call once before the rows
+  bool begin(int width, int height);
+  // the next rows, 4 bytes per pixel in BGRA order (QImage::Format_ARGB32, Format32bppArgb)
+  bool writeRows(const uchar* bgra, int stride, int rows);
+  // the remaining data and the end chunk, false if not all rows were written
+  bool finish();
+
+private:
+  bool writeChunk(const char* type, const QByteArray& data);
+  bool deflateRow(int flush);
+
+  QIODevice* mDevice;
+  z_stream mStream = {};
+  bool mStreamOpen = false;
+  int mWidth = 0;
+  int mHeight = 0;
+  int mRowsWritten = 0;
+  // filter byte and RGBA pixels of the current and previous row
+  QByteArray mRow;
+  QByteArray mFiltered;
+  QByteArray mOutput;
+};
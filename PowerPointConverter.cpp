@@ -8,11 +8,96 @@
 #include <QJsonArray>
 #include <QFileInfo>
 #include <QProcess>
+#include <QElapsedTimer>
+#include <QDateTime>
+#include <QUuid>
+#include <QRegularExpression>
+#include <algorithm>
+#include <vector>
+#include "Metrics.h"
+#include "AsyncFileWriter.h"
+#include "FrameRing.h"
+#include "FrameBufferPool.h"
+#include "SlideFingerprint.h"
+#include "SlideImageStore.h"
+#include <QImage>
+
+std::atomic<int> PowerPointConverter::sLiveReplies(0);
+
+namespace {
+  // storage layout: decks/<sha256>.pptx shared by all jobs, jobs/<uuid> with the slides of one job
+  const char* kDeckFolder = "decks";
+  const char* kJobFolder = "jobs";
+  // decks not converted for this long are removed from the storage
+  const qint64 kDeckMaxUnusedMsecs = 7LL * 24 * 60 * 60 * 1000;
+  // limits of a batch upload
+  const int kMaxBatchFiles = 8;
+  const qint64 kMaxBatchBytes = 100 * 1024 * 1024;
+  // marks the request checking for an uploaded deck
+  const char* kStorageExistsRequest = "storage-exists";
+  // marks the token request after a 401, the job's stage goes on meanwhile
+  const char* kTokenRefreshRequest = "token-refresh";
+  // download queue entry of a slide taken from the slide store
+  const char* kStoredSlideScheme = "slide-store:";
+
+  // secrets in the debug output: enough to tell two apart, not to use them
+  QString redacted(const QString& secret)
+  {
+    if (secret.size() <= 8) return QString(secret.size(), '*');
+    return secret.left(4) + QString("...(%1 chars)").arg(secret.size());
+  }
+
+  QString stageName(PowerPointConverter::PowerPointConverterStatus status)
+  {
+    switch (status)
+    {
+    case PowerPointConverter::PowerPointConverterStatus::kUpdateBearerToken: return "bearer_token";
+    case PowerPointConverter::PowerPointConverterStatus::kUploadFile: return "upload";
+    case PowerPointConverter::PowerPointConverterStatus::kSplitAndConvert: return "split";
+    case PowerPointConverter::PowerPointConverterStatus::kDownloadSlides: return "download";
+    case PowerPointConverter::PowerPointConverterStatus::kUploadAndConvert: return "upload_and_convert";
+    case PowerPointConverter::PowerPointConverterStatus::kSyncFonts: return "sync_fonts";
+    default: return QString();
+    }
+  }
+
+  // looked up once, updates are lock-free
+  struct ConverterMetrics {
+    MetricsRegistry& registry = MetricsRegistry::instance();
+    Counter& jobsStarted = registry.counter("pptx_converter_jobs_started_total", "Conversions started", "path=\"cloud\"");
+    Counter& jobsFinished = registry.counter("pptx_converter_jobs_total", "Conversions ended by result", "path=\"cloud\",result=\"finished\"");
+    Counter& jobsFailed = registry.counter("pptx_converter_jobs_total", "Conversions ended by result", "path=\"cloud\",result=\"failed\"");
+    Counter& jobsCancelled = registry.counter("pptx_converter_jobs_total", "Conversions ended by result", "path=\"cloud\",result=\"cancelled\"");
+    Counter& slides = registry.counter("pptx_converter_slides_total", "Converted slides", "path=\"cloud\"");
+    Counter& uploadBytes = registry.counter("pptx_converter_upload_bytes_total", "Bytes uploaded to the service");
+    Counter& downloadBytes = registry.counter("pptx_converter_download_bytes_total", "Bytes downloaded from the service");
+    Histogram& jobDuration = registry.histogram("pptx_converter_job_duration_seconds", "Duration of whole conversions", "path=\"cloud\"");
+    Gauge& inflightReplies = registry.gauge("pptx_converter_inflight_replies", "Network replies not yet finished and deleted");
+    Gauge& queuedRequests = registry.gauge("pptx_converter_queued_requests", "Requests waiting for the rate limiter");
+    std::map<PowerPointConverter::PowerPointConverterStatus, Histogram*> stageDuration;
+
+    ConverterMetrics()
+    {
+      for (int i = 0; i <= static_cast<int>(PowerPointConverter::PowerPointConverterStatus::kCancelled); ++i) {
+        auto status = static_cast<PowerPointConverter::PowerPointConverterStatus>(i);
+        auto name = stageName(status);
+        if (name.isEmpty()) continue;
+        stageDuration[status] = &registry.histogram("pptx_converter_stage_duration_seconds", "Duration of the conversion stages", QString("stage=\"%1\"").arg(name));
+      }
+    }
+  };
+
+  ConverterMetrics& metrics()
+  {
+    static ConverterMetrics sMetrics;
+    return sMetrics;
+  }
+}
 
 void PowerPointConverter::convertPowerpointFile(const QString& filepath, const QString& targetpath)
 {
   // main entrypoint from the outside
-  if (mCurrentStatus != PowerPointConverterStatus::kNone && mCurrentStatus != PowerPointConverterStatus::kFailure && mCurrentStatus != PowerPointConverterStatus::kFinishedConversion) {
+  if (mCurrentStatus != PowerPointConverterStatus::kNone && mCurrentStatus != PowerPointConverterStatus::kFailure && mCurrentStatus != PowerPointConverterStatus::kFinishedConversion && mCurrentStatus != PowerPointConverterStatus::kCancelled) {
     // conversion in progress
     emit("Conversion already in progress... Please wait!");
     return;
@@ -20,13 +105,7 @@ void PowerPointConverter::convertPowerpointFile(const QString& filepath, const Q
 
   mCurrentStatus = PowerPointConverterStatus::kNone;
 
-  if (!mNetworkAccessManager) {
-    // needs to be created here to have it in the right thread
-    mNetworkAccessManager = std::make_unique<QNetworkAccessManager>(this);
-  }
-  if (!mExtractProcess) {
-    mExtractProcess = std::make_unique<QProcess>();
-  }
+  createNetworkAccessManager();
   // set file and target path
   setPowerpointFile(filepath);
   setTargetPath(targetpath);
@@ -37,14 +116,26 @@ void PowerPointConverter::convertPowerpointFile(const QString& filepath, const Q
     return;
   }
 
-  // first step: upload file (will update authentication token automatically)
-  uploadPresentation();
+  // an account already holding the deck skips the upload
+  if (!startJob(deckAccount(mLocalFilepath))) return;
+  beginJournal(PowerPointConverterStatus::kUploadFile);
+  mJobFlow = PowerPointConverterStatus::kUploadFile;
+
+  if (allSlidesStored()) {
+    // every slide was converted before, nothing to upload or split
+    mJobFlow = PowerPointConverterStatus::kNone;
+    convertFromSlideStore();
+    return;
+  }
+
+  // first step: make sure the fonts are available, then upload file (will update authentication token automatically)
+  syncFonts(PowerPointConverterStatus::kUploadFile);
 }
 
 void PowerPointConverter::convertPowerpointFile2(const QString& filepath, const QString& targetpath)
 {
   // main entrypoint from the outside
-  if (mCurrentStatus != PowerPointConverterStatus::kNone && mCurrentStatus != PowerPointConverterStatus::kFailure && mCurrentStatus != PowerPointConverterStatus::kFinishedConversion) {
+  if (mCurrentStatus != PowerPointConverterStatus::kNone && mCurrentStatus != PowerPointConverterStatus::kFailure && mCurrentStatus != PowerPointConverterStatus::kFinishedConversion && mCurrentStatus != PowerPointConverterStatus::kCancelled) {
     // conversion in progress
     emit("Conversion already in progress... Please wait!");
     return;
@@ -52,10 +143,7 @@ void PowerPointConverter::convertPowerpointFile2(const QString& filepath, const
 
   mCurrentStatus = PowerPointConverterStatus::kNone;
 
-  if (!mNetworkAccessManager) {
-    // needs to be created here to have it in the right thread
-    mNetworkAccessManager = std::make_unique<QNetworkAccessManager>(this);
-  }
+  createNetworkAccessManager();
 
   // set file and target path
   setPowerpointFile(filepath);
@@ -67,14 +155,69 @@ void PowerPointConverter::convertPowerpointFile2(const QString& filepath, const
     return;
   }
 
-  // upload and convert
-  uploadAndConvert();
+  if (!startJob()) return;
+  beginJournal(PowerPointConverterStatus::kUploadAndConvert);
+  mJobFlow = PowerPointConverterStatus::kUploadAndConvert;
+
+  // upload and convert once the fonts are available
+  syncFonts(PowerPointConverterStatus::kUploadAndConvert);
+}
+
+void PowerPointConverter::convertPowerpointFileAuto(const QString& filepath, const QString& targetpath)
+{
+  const auto info = PresentationInspector::inspect(filepath);
+  if (!info.valid) {
+    // reported by the flow like any other invalid file
+    convertPowerpointFile2(filepath, targetpath);
+    return;
+  }
+
+  // the convert flow always uploads, the split flow reuses a deck in storage
+  const qint64 fileSize = QFileInfo(filepath).size();
+  const qint64 splitUploadBytes = deckAccount(filepath).isEmpty() ? fileSize : 0;
+  auto& model = FlowCostModel::instance();
+  const double splitMsecs = model.predict(FlowCostModel::Flow::kSplit, info.slideCount, splitUploadBytes);
+  const double convertMsecs = model.predict(FlowCostModel::Flow::kConvert, info.slideCount, fileSize);
+  const auto flow = model.choose(info.slideCount, splitUploadBytes, fileSize);
+  emit debug(QString("Auto flow for %1 slides, %2 KB (%3 KB to upload for split): split %4 ms, convert %5 ms expected, %6 chosen")
+    .arg(info.slideCount).arg(fileSize / 1024).arg(splitUploadBytes / 1024).arg(qRound(splitMsecs)).arg(qRound(convertMsecs))
+    .arg(flow == FlowCostModel::Flow::kSplit ? "split" : "convert"));
+
+  if (flow == FlowCostModel::Flow::kSplit) convertPowerpointFile(filepath, targetpath);
+  else convertPowerpointFile2(filepath, targetpath);
+}
+
+void PowerPointConverter::setServiceUrl(const QUrl& url)
+{
+  mServiceUrl = url;
+}
+
+int PowerPointConverter::liveReplyCount()
+{
+  return sLiveReplies.load();
+}
+
+void PowerPointConverter::createNetworkAccessManager()
+{
+  if (mNetworkAccessManager) return;
+  // needs to be created here to have it in the right thread
+  mNetworkAccessManager = std::make_unique<QNetworkAccessManager>(this);
+  // the manager signals every finished reply (also aborted ones) and owns its deletion
+  connect(mNetworkAccessManager.get(), &QNetworkAccessManager::finished, this, &PowerPointConverter::onRequestFinished);
+}
+
+QUrl PowerPointConverter::serviceUrl(const QString& path) const
+{
+  QUrl url = mServiceUrl;
+  url.setPath(path);
+  return url;
 }
 
 void PowerPointConverter::setPowerpointFile(const QString& filepath)
 {
   mLocalFilename = "";
   mLocalFilepath = "";
+  mSlideFingerprints.clear();
   if (!QFile::exists(filepath)) {
     stopOnFailure(QString("File %1 does not exist").arg(filepath));
     return;
@@ -92,18 +235,40 @@ void PowerPointConverter::setPowerpointFile(const QString& filepath)
     return;
   }
 
-  mPresentationFile = std::make_unique<QFile>(filepath);
-  if (!mPresentationFile->open(QIODevice::ReadOnly)) {
-    mPresentationFile.release();
-    emit error(QString("Presentation file '%1' can't be opened").arg(filepath));
+  // map the file, shared with other jobs converting the same file
+  QString mapError;
+  mPresentation = MappedPresentation::acquire(filepath, &mapError);
+  if (!mPresentation) {
+    stopOnFailure(mapError);
     return;
   }
 
-  // check presentation
-  if (!mPresentationFile->isOpen() || !mPresentationFile->isReadable()) {
-    stopOnFailure(QString("Presentation file '%1' is not set/open/readable").arg(mLocalFilename));
+  // pre-flight inspection of the package (few ms), before anything is sent
+  QElapsedTimer inspectTimer;
+  inspectTimer.start();
+  mPresentationInfo = PresentationInspector::inspect(mPresentation->data());
+  if (!mPresentationInfo.valid) {
+    mPresentation.reset();
+    stopOnFailure(QString("Presentation file '%1' is invalid: %2").arg(filepath).arg(mPresentationInfo.errorMessage));
     return;
   }
+  if (mPresentationInfo.slideCount == 0) {
+    mPresentation.reset();
+    stopOnFailure(QString("Presentation file '%1' has no slides").arg(filepath));
+    return;
+  }
+  auto slideSize = mPresentationInfo.slideSizePoints();
+  emit debug(QString("Inspected '%1' in %2 ms: %3 slides, size %4x%5 pt, %6 media bytes, fonts: %7")
+    .arg(fileInfo.fileName()).arg(inspectTimer.elapsed()).arg(mPresentationInfo.slideCount)
+    .arg(slideSize.width()).arg(slideSize.height()).arg(mPresentationInfo.totalMediaBytes)
+    .arg(mPresentationInfo.fonts.join(", ")));
+
+  // identical slides converted before, in any deck, are not downloaded again
+  if (mSlideStoreEnabled) {
+    inspectTimer.start();
+    mSlideFingerprints = SlideFingerprint::compute(mPresentation->data(), mPresentationInfo.slideParts);
+    emit debug(QString("Fingerprinted %1 slides in %2 ms").arg(mSlideFingerprints.count()).arg(inspectTimer.elapsed()));
+  }
 
   // file exists and can be opened
   mLocalFilename = fileInfo.fileName();
@@ -122,16 +287,478 @@ void PowerPointConverter::setTargetPath(const QString& targetpath)
   mTargetPath = targetpath;
 }
 
+void PowerPointConverter::setJournalEnabled(bool enabled)
+{
+  mJournalEnabled = enabled;
+}
+
+void PowerPointConverter::setSlideStoreEnabled(bool enabled)
+{
+  mSlideStoreEnabled = enabled;
+}
+
+void PowerPointConverter::setStorageManifestPath(const QString& path)
+{
+  mStorageManifest = StorageManifest(path);
+}
+
+void PowerPointConverter::setFontSyncEnabled(bool enabled)
+{
+  mFontSyncEnabled = enabled;
+}
+
+void PowerPointConverter::setFlowCostSamplesEnabled(bool enabled)
+{
+  mFlowCostSamplesEnabled = enabled;
+}
+
+void PowerPointConverter::setCredentialPool(std::shared_ptr<CredentialPool> credentials)
+{
+  releaseAccount();
+  mCredentials = std::move(credentials);
+}
+
+void PowerPointConverter::beginJournal(PowerPointConverterStatus flow)
+{
+  mJobId.clear();
+  if (!mJournalEnabled) return;
+  QFileInfo fileInfo(mLocalFilepath);
+  JobJournal::Job job;
+  job.flow = flow == PowerPointConverterStatus::kUploadAndConvert ? "convert" : "split";
+  job.service = mServiceUrl.toString();
+  job.clientId = mCredentials->credential(mAccount).clientId;
+  job.localFile = fileInfo.absoluteFilePath();
+  job.localSize = fileInfo.size();
+  job.localModified = fileInfo.lastModified().toMSecsSinceEpoch();
+  job.targetPath = QFileInfo(mTargetPath).absoluteFilePath();
+  mJobId = JobJournal::instance().begin(job);
+}
+
+void PowerPointConverter::endJournal(PowerPointConverterStatus status)
+{
+  if (mJobId.isEmpty()) return;
+  QString result = "failed";
+  if (status == PowerPointConverterStatus::kFinishedConversion) result = "finished";
+  else if (status == PowerPointConverterStatus::kCancelled) result = "cancelled";
+  JobJournal::instance().end(mJobId, result);
+  mJobId.clear();
+}
+
+void PowerPointConverter::resumeUnfinishedJobs()
+{
+  if (!mJournalEnabled) return;
+  if (!JobJournal::instance().ownsJournal()) {
+    emit debug("Journal: owned by another running instance, nothing resumed");
+    return;
+  }
+  for (const auto& job : JobJournal::instance().unfinishedJobs()) {
+    mResumeQueue.push_back(job);
+  }
+  emit debug(QString("Journal: %1 unfinished jobs").arg(mResumeQueue.size()));
+  startNextQueuedJob();
+}
+
+ConversionJob PowerPointConverter::convert(const QString& filepath, const QString& targetpath)
+{
+  auto job = std::make_shared<QueuedJob>();
+  job->filepath = filepath;
+  job->targetpath = targetpath;
+  job->slides.reportStarted();
+  job->done.reportStarted();
+
+  ConversionJob handle;
+  handle.slides = job->slides.future();
+  handle.done = job->done.future();
+  // queued to the converter's thread
+  QMetaObject::invokeMethod(this, [this, job]() {
+    mQueuedJobs.push_back(job);
+    startNextQueuedJob();
+  }, Qt::QueuedConnection);
+  return handle;
+}
+
+void PowerPointConverter::startNextQueuedJob()
+{
+  // one job at a time, the next one is started when the running one ended
+  if (mCurrentStatus != PowerPointConverterStatus::kNone && mCurrentStatus != PowerPointConverterStatus::kFailure && mCurrentStatus != PowerPointConverterStatus::kFinishedConversion && mCurrentStatus != PowerPointConverterStatus::kCancelled) return;
+  if (!mResumeQueue.empty()) {
+    auto job = mResumeQueue.front();
+    mResumeQueue.pop_front();
+    resumeJob(job);
+    return;
+  }
+  while (!mQueuedJobs.empty()) {
+    auto job = mQueuedJobs.front();
+    mQueuedJobs.pop_front();
+    if (job->slides.isCanceled()) {
+      // cancelled while queued
+      job->done.reportException(ConversionError("Conversion cancelled"));
+      job->done.reportFinished();
+      job->slides.reportFinished();
+      continue;
+    }
+    mRunningJob = job;
+    if (!mRunningJobWatcher) {
+      // created here to have it in the converter thread
+      mRunningJobWatcher = std::make_unique<QFutureWatcher<SlideResult>>();
+      connect(mRunningJobWatcher.get(), &QFutureWatcherBase::canceled, this, &PowerPointConverter::cancelConversion);
+    }
+    mRunningJobWatcher->setFuture(job->slides.future());
+    convertPowerpointFile(job->filepath, job->targetpath);
+    return;
+  }
+}
+
+void PowerPointConverter::completeRunningJob(PowerPointConverterStatus status)
+{
+  if (!mRunningJob) return;
+  auto job = mRunningJob;
+  mRunningJob.reset();
+  // cancelling the finished job must not cancel the next one
+  if (mRunningJobWatcher) mRunningJobWatcher->setFuture(QFuture<SlideResult>());
+  if (status == PowerPointConverterStatus::kFinishedConversion) {
+    job->done.reportResult(mConvertedFiles);
+  }
+  else {
+    job->done.reportException(ConversionError(mJobError.isEmpty() ? QString("Conversion failed") : mJobError));
+  }
+  job->done.reportFinished();
+  job->slides.reportFinished();
+}
+
+void PowerPointConverter::resumeJob(const JobJournal::Job& job)
+{
+  emit debug(QString("Resume job %1 of '%2'").arg(job.id).arg(job.localFile));
+  QFileInfo fileInfo(job.localFile);
+  if (job.service != mServiceUrl.toString() || !fileInfo.exists()) {
+    // the server files or the local file are gone
+    emit error(QString("Unfinished conversion of '%1' can't be resumed").arg(job.localFile));
+    if (job.service == mServiceUrl.toString() && !job.jobFolder.isEmpty()) collectJobFolder(job.clientId, job.jobFolder);
+    JobJournal::instance().end(job.id, "abandoned");
+    QTimer::singleShot(0, this, &PowerPointConverter::startNextQueuedJob);
+    return;
+  }
+
+  // the uploaded file is only usable if the local one is unchanged and its account still exists
+  bool knownAccount = false;
+  if (!mCredentials) mCredentials = CredentialPool::instance();
+  for (int i = 0; i < mCredentials->accountCount(); ++i) {
+    if (mCredentials->credential(i).clientId == job.clientId) knownAccount = true;
+  }
+  const bool unchanged = fileInfo.size() == job.localSize && fileInfo.lastModified().toMSecsSinceEpoch() == job.localModified;
+  if (job.stage == JobJournal::Stage::kStarted || job.flow != "split" || !unchanged || !knownAccount) {
+    // nothing reusable on the server: convert again as a new job
+    if (!job.jobFolder.isEmpty() && knownAccount) collectJobFolder(job.clientId, job.jobFolder);
+    JobJournal::instance().end(job.id, "restarted");
+    if (job.flow == "convert") convertPowerpointFile2(job.localFile, job.targetPath);
+    else convertPowerpointFile(job.localFile, job.targetPath);
+    return;
+  }
+
+  mCurrentStatus = PowerPointConverterStatus::kNone;
+  createNetworkAccessManager();
+  mLocalFilename = fileInfo.fileName();
+  mLocalFilepath = fileInfo.filePath();
+  mSlideFingerprints.clear();
+  setTargetPath(job.targetPath);
+  if (!startJob(job.clientId)) return;
+  mJobFlow = PowerPointConverterStatus::kNone;
+  mJobId = job.id;
+  mServerpathAfterUpload = job.serverPath;
+  mServerfileAfterUpload = job.serverFile;
+
+  if (job.stage == JobJournal::Stage::kUploaded) {
+    emit debug(QString("Resume job %1: already uploaded to %2/%3").arg(job.id).arg(job.serverPath).arg(job.serverFile));
+    // the split may have written slides before the crash, it writes into a new folder
+    if (!job.jobFolder.isEmpty()) collectJobFolder(job.clientId, job.jobFolder);
+    splitPresentationAndCreatePNGs();
+    return;
+  }
+
+  // the slides are downloaded from the folder of the split, deleted at the end
+  mServerJobFolder = job.jobFolder;
+
+  // split: only download the slides not saved yet
+  mDownloadQueue = job.slideUrls;
+  mConvertedFiles.clear();
+  for (auto iter = job.savedFiles.constBegin(); iter != job.savedFiles.constEnd(); ++iter) {
+    if (!mDownloadQueue.contains(iter.key()) || QFileInfo(iter.value()).size() == 0) continue;
+    mSavedSlideUrls.insert(iter.key());
+    mConvertedFiles << iter.value();
+  }
+  emit debug(QString("Resume job %1: %2 of %3 slides already saved").arg(job.id).arg(mConvertedFiles.count()).arg(mDownloadQueue.count()));
+  downloadQueuedSlides();
+}
+
 void PowerPointConverter::setStatus(PowerPointConverterStatus status)
 {
+  // latency of the stage we leave
+  auto stageHistogram = metrics().stageDuration.find(mCurrentStatus);
+  if (mStageTimer.isValid() && stageHistogram != metrics().stageDuration.end()) {
+    stageHistogram->second->observeMsecs(mStageTimer.elapsed());
+  }
+  mStageTimer.start();
+
   mCurrentStatus = status;
+  if (status == PowerPointConverterStatus::kFinishedConversion || status == PowerPointConverterStatus::kFailure || status == PowerPointConverterStatus::kCancelled) {
+    // the job is over, clean up its storage and let other jobs use the account
+    collectStaleStorage();
+    releaseAccount();
+    mStageTimer.invalidate();
+    if (mJobTimer.isValid()) {
+      metrics().jobDuration.observeMsecs(mJobTimer.elapsed());
+      if (status == PowerPointConverterStatus::kFinishedConversion && mJobFlow != PowerPointConverterStatus::kNone && mFlowCostSamplesEnabled) {
+        // the durations the automatic flow selection is based on
+        const auto flow = mJobFlow == PowerPointConverterStatus::kUploadFile ? FlowCostModel::Flow::kSplit : FlowCostModel::Flow::kConvert;
+        FlowCostModel::instance().recordJob(flow, mPresentationInfo.slideCount, mJobUploadBytes, mJobTimer.elapsed());
+      }
+      if (status == PowerPointConverterStatus::kFinishedConversion) metrics().jobsFinished.increment();
+      else if (status == PowerPointConverterStatus::kFailure) metrics().jobsFailed.increment();
+      else metrics().jobsCancelled.increment();
+      // count each job once, failures may be reported several times
+      mJobTimer.invalidate();
+    }
+    // partial outputs of a cancelled job are removed, the ones of a failed job kept like the saved slides
+    discardPendingWrites(status == PowerPointConverterStatus::kCancelled);
+    endJournal(status);
+    completeRunningJob(status);
+    if (!mResumeQueue.empty() || !mQueuedJobs.empty()) QTimer::singleShot(0, this, &PowerPointConverter::startNextQueuedJob);
+  }
   emit statusChanged(mCurrentStatus);
 }
 
+void PowerPointConverter::setBatchUploadCandidates(const QStringList& filepaths)
+{
+  mBatchCandidates = filepaths;
+}
+
+void PowerPointConverter::collectStaleStorage()
+{
+  if (!mCredentials || mAccount < 0) return;
+  const auto clientId = mCredentials->credential(mAccount).clientId;
+  if (!mServerJobFolder.isEmpty()) {
+    collectJobFolder(clientId, mServerJobFolder);
+    mServerJobFolder.clear();
+  }
+
+  // decks of this account not converted for a while, forgotten once they are deleted
+  const auto prefix = deckStorageKey(QString());
+  for (const auto& key : mStorageManifest.unusedSince(prefix, kDeckMaxUnusedMsecs)) {
+    StaleStorage deck;
+    deck.clientId = clientId;
+    deck.url = serviceUrl(QString("/v3.0/slides/storage/file/%1/%2").arg(kDeckFolder).arg(key.mid(prefix.size())));
+    deck.manifestKey = key;
+    queueStorageDelete(deck);
+  }
+  sendStorageDeletes();
+}
+
+void PowerPointConverter::collectJobFolder(const QString& clientId, const QString& folder)
+{
+  StaleStorage jobFolder;
+  jobFolder.clientId = clientId;
+  jobFolder.url = serviceUrl(QString("/v3.0/slides/storage/folder/%1").arg(folder));
+  QUrlQuery query;
+  query.addQueryItem("recursive", "true");
+  jobFolder.url.setQuery(query);
+  queueStorageDelete(jobFolder);
+}
+
+void PowerPointConverter::queueStorageDelete(const StaleStorage& storage)
+{
+  // a deck stays unused until its delete is answered
+  const auto url = storage.url.toString();
+  if (mDeletingStorage.count(url) > 0) return;
+  for (const auto& queued : mStaleStorage) {
+    if (queued.url.toString() == url) return;
+  }
+  mStaleStorage.push_back(storage);
+}
+
+void PowerPointConverter::sendStorageDeletes()
+{
+  // sent with the token of the account, the requests outlive the job
+  if (!mNetworkAccessManager || mAccount < 0 || !hasBearerToken()) return;
+  const auto clientId = mCredentials->credential(mAccount).clientId;
+  for (auto iter = mStaleStorage.begin(); iter != mStaleStorage.end();) {
+    if (iter->clientId != clientId) {
+      ++iter;
+      continue;
+    }
+    QNetworkRequest request(iter->url);
+    request.setRawHeader("Authorization", QString("Bearer %1").arg(mBearerToken).toUtf8());
+    request.setAttribute(QNetworkRequest::User, iter->manifestKey);
+    request.setAttribute(static_cast<QNetworkRequest::Attribute>(QNetworkRequest::User + 1), iter->clientId);
+    emit debug(QString(">> Delete stale storage %1").arg(iter->url.path()));
+    mDeletingStorage.insert(iter->url.toString());
+    sendRequest(PowerPointConverterStatus::kCollectStorage, [this, request]() { return mNetworkAccessManager->deleteResource(request); });
+    iter = mStaleStorage.erase(iter);
+  }
+}
+
+void PowerPointConverter::handleStorageDeleteReply(QNetworkReply* reply)
+{
+  StaleStorage storage;
+  storage.url = reply->request().url();
+  storage.manifestKey = reply->request().attribute(QNetworkRequest::User).toString();
+  storage.clientId = reply->request().attribute(static_cast<QNetworkRequest::Attribute>(QNetworkRequest::User + 1)).toString();
+  mDeletingStorage.erase(storage.url.toString());
+
+  const int httpStatus = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+  if ((httpStatus >= 200 && httpStatus < 300) || httpStatus == 404) {
+    emit debug(QString("Deleted stale storage %1").arg(storage.url.path()));
+    if (!storage.manifestKey.isEmpty()) {
+      mStorageManifest.remove(storage.manifestKey);
+      mStorageManifest.save();
+    }
+    return;
+  }
+  // rate limits were retried already: try again after a later job of the account
+  emit debug(QString("Deleting stale storage %1 failed (HTTP %2: %3), retried later").arg(storage.url.path()).arg(httpStatus).arg(reply->errorString()));
+  queueStorageDelete(storage);
+}
+
+bool PowerPointConverter::startJob(const QString& clientId)
+{
+  connect(&AsyncFileWriter::instance(), &AsyncFileWriter::written, this, &PowerPointConverter::onFileWritten, Qt::UniqueConnection);
+  acquireAccount(clientId);
+  if (mAccount < 0) {
+    stopOnFailure("No cloud credentials configured: set PPTX_CONVERTER_CREDENTIALS or put credentials.json next to the executable");
+    return false;
+  }
+  mSavedSlideUrls.clear();
+  mJobError.clear();
+  startDeadline();
+  metrics().jobsStarted.increment();
+  mJobTimer.start();
+  mJobUploadBytes = 0;
+  mStageTimer.invalidate();
+  return true;
+}
+
+void PowerPointConverter::updateQueuedRequestsGauge()
+{
+  const qint64 queued = static_cast<qint64>(mPendingRequests.size());
+  metrics().queuedRequests.add(queued - mReportedQueuedRequests);
+  mReportedQueuedRequests = queued;
+}
+
+void PowerPointConverter::acquireAccount(const QString& clientId)
+{
+  if (!mCredentials) mCredentials = CredentialPool::instance();
+  releaseAccount();
+  // a resumed job needs the account holding its uploaded file
+  if (!clientId.isEmpty()) mAccount = mCredentials->acquireAccount(clientId);
+  if (mAccount < 0) mAccount = mCredentials->acquireAccount();
+  // the token of the account may already be known from previous jobs
+  mBearerToken = mCredentials->bearerToken(mAccount);
+  emit debug(QString("Using account %1 of %2").arg(mAccount).arg(mCredentials->accountCount()));
+}
+
+bool PowerPointConverter::hasBearerToken()
+{
+  // shared by the jobs of the account, empty shortly before it expires. The
+  // old token stays for requests of the running stage, a 401 refreshes it
+  const QString token = mCredentials ? mCredentials->bearerToken(mAccount) : QString();
+  if (!token.isEmpty()) mBearerToken = token;
+  return !token.isEmpty();
+}
+
+QNetworkRequest PowerPointConverter::authorized(QNetworkRequest request) const
+{
+  // set when sent, a request resent after a refresh carries the new token
+  request.setRawHeader("Authorization", QString("Bearer %1").arg(mBearerToken).toUtf8());
+  return request;
+}
+
+void PowerPointConverter::releaseAccount()
+{
+  if (mCredentials && mAccount >= 0) mCredentials->releaseAccount(mAccount);
+  mAccount = -1;
+}
+
 void PowerPointConverter::stopOnFailure(const QString& message)
 {
+  // the first error is the cause, the following ones are consequences
+  if (mJobError.isEmpty()) mJobError = message;
   emit error(message);
   setStatus(PowerPointConverterStatus::kFailure);
+  // the failing reply (if any) is kept to read the error details when it finishes
+  abortOutstandingReplies(qobject_cast<QNetworkReply*>(sender()));
+}
+
+void PowerPointConverter::cancelConversion()
+{
+  if (mCurrentStatus == PowerPointConverterStatus::kNone || mCurrentStatus == PowerPointConverterStatus::kFailure
+    || mCurrentStatus == PowerPointConverterStatus::kFinishedConversion || mCurrentStatus == PowerPointConverterStatus::kCancelled) {
+    // nothing running
+    return;
+  }
+
+  emit debug("Cancel conversion");
+  if (mJobError.isEmpty()) mJobError = "Conversion cancelled";
+  abortOutstandingReplies();
+
+  // delete partial outputs, including the ones still being written
+  for (const auto& file : mConvertedFiles) {
+    QFile::remove(file);
+  }
+  mConvertedFiles.clear();
+  mDownloadQueue.clear();
+
+  setStatus(PowerPointConverterStatus::kCancelled);
+  emit error("Conversion cancelled");
+}
+
+void PowerPointConverter::setConversionDeadline(int msecs)
+{
+  mDeadlineMsecs = msecs;
+}
+
+void PowerPointConverter::abortOutstandingReplies(QNetworkReply* keep)
+{
+  // copy, aborting must not modify the map we iterate
+  auto replies = mNetworkReplies;
+  for (const auto& pair : replies) {
+    auto* reply = pair.first;
+    // storage deletes are not part of the job, they go on
+    if (reply == keep || pair.second == PowerPointConverterStatus::kCollectStorage) continue;
+    // disconnect first, abort emits errorOccurred and finished synchronously
+    disconnect(reply, nullptr, this, nullptr);
+    reply->abort();
+    reply->deleteLater();
+    mNetworkReplies.erase(reply);
+    mRequestSenders.erase(reply);
+    mFontUploads.erase(reply);
+  }
+  mPendingRequests.erase(std::remove_if(mPendingRequests.begin(), mPendingRequests.end(), [](const auto& pending) {
+    return pending.first != PowerPointConverterStatus::kCollectStorage;
+  }), mPendingRequests.end());
+  mAwaitingToken.clear();
+  if (mThrottleTimer && mPendingRequests.empty()) mThrottleTimer->stop();
+  updateQueuedRequestsGauge();
+
+  if (mSplitAndConvertTimer) mSplitAndConvertTimer->stop();
+  if (mDeadlineTimer) mDeadlineTimer->stop();
+  mPresentation.reset();
+}
+
+void PowerPointConverter::startDeadline()
+{
+  if (!mDeadlineTimer) {
+    // created here to have it in the converter thread
+    mDeadlineTimer = std::make_unique<QTimer>();
+    mDeadlineTimer->setSingleShot(true);
+    connect(mDeadlineTimer.get(), &QTimer::timeout, this, &PowerPointConverter::onDeadlineTimeout);
+  }
+  mDeadlineTimer->stop();
+  if (mDeadlineMsecs > 0) mDeadlineTimer->start(mDeadlineMsecs);
+}
+
+void PowerPointConverter::onDeadlineTimeout()
+{
+  emit debug(QString("Conversion deadline of %1 ms exceeded").arg(mDeadlineMsecs));
+  cancelConversion();
 }
 
 void PowerPointConverter::updateBearerToken(PowerPointConverterStatus nextStage)
@@ -142,23 +769,46 @@ void PowerPointConverter::updateBearerToken(PowerPointConverterStatus nextStage)
   // keep next stage once token is successfully updated
   mStageAfterTokenUpdate = nextStage;
 
+  QByteArray data;
+  auto request = bearerTokenRequest(&data);
+  sendRequest(PowerPointConverterStatus::kUpdateBearerToken, [this, request, data]() { return mNetworkAccessManager->post(request, data); });
+}
+
+void PowerPointConverter::refreshRejectedToken(PowerPointConverterStatus stage, const RequestSender& sender)
+{
+  // the stage goes on, only the rejected requests wait for the new token
+  mCredentials->invalidateBearerToken(mAccount, mBearerToken);
+  mAwaitingToken.emplace_back(stage, sender);
+  if (mAwaitingToken.size() > 1) return;
+
+  emit debug("Bearer token rejected (401), refreshing it");
+  QByteArray data;
+  auto request = bearerTokenRequest(&data);
+  request.setAttribute(QNetworkRequest::User, kTokenRefreshRequest);
+  sendRequest(PowerPointConverterStatus::kUpdateBearerToken, [this, request, data]() { return mNetworkAccessManager->post(request, data); });
+}
+
+QNetworkRequest PowerPointConverter::bearerTokenRequest(QByteArray* data) const
+{
   QNetworkRequest request;
-  request.setUrl(QUrl("https://api.aspose.cloud/connect/token"));
+  request.setUrl(serviceUrl("/connect/token"));
   request.setHeader(QNetworkRequest::ContentTypeHeader, "application/x-www-form-urlencoded");
   request.setRawHeader("Accept", "application/json");
 
   QUrlQuery postData;
   postData.addQueryItem("grant_type", "client_credentials");
-  postData.addQueryItem("client_id", kClientId);
-  postData.addQueryItem("client_secret", kClientSecret);
-  emit debug(QString(">> Post Data: '%1'").arg(postData.toString()));
-
-  registerNetworkReply(mNetworkAccessManager->post(request, postData.toString(QUrl::FullyEncoded).toUtf8()), PowerPointConverterStatus::kUpdateBearerToken);
+  auto credential = mCredentials->credential(mAccount);
+  postData.addQueryItem("client_id", credential.clientId);
+  postData.addQueryItem("client_secret", credential.clientSecret);
+  emit debug(QString(">> Post Data: 'grant_type=client_credentials&client_id=%1&client_secret=%2'").arg(credential.clientId).arg(redacted(credential.clientSecret)));
+  *data = postData.toString(QUrl::FullyEncoded).toUtf8();
+  return request;
 }
 
 void PowerPointConverter::handleBearerReply(QNetworkReply* reply)
 {
-  if (mCurrentStatus != PowerPointConverterStatus::kUpdateBearerToken) {
+  const bool refresh = reply->request().attribute(QNetworkRequest::User).toString() == kTokenRefreshRequest;
+  if (!refresh && mCurrentStatus != PowerPointConverterStatus::kUpdateBearerToken) {
     stopOnFailure(QString("Bearer reply: wrong status: %1").arg(static_cast<int>(mCurrentStatus)));
     return;
   }
@@ -175,8 +825,21 @@ void PowerPointConverter::handleBearerReply(QNetworkReply* reply)
   }
 
   mBearerToken = object.value("access_token").toString("");
+  // seconds, refreshed by the next stage shortly before
+  mCredentials->setBearerToken(mAccount, mBearerToken, static_cast<qint64>(object.value("expires_in").toDouble()) * 1000);
   emit debug("Updated Bearer token");
-  emit debug(QString("Bearer token: ") + mBearerToken);
+  emit debug(QString("Bearer token: ") + redacted(mBearerToken));
+
+  if (refresh) {
+    // the rejected requests are resent first, with the new token
+    mRefreshedToken = mBearerToken;
+    while (!mAwaitingToken.empty()) {
+      mPendingRequests.push_front(mAwaitingToken.back());
+      mAwaitingToken.pop_back();
+    }
+    sendPendingRequests();
+    return;
+  }
 
   // potentially continue with previous stage
   if (mStageAfterTokenUpdate != PowerPointConverterStatus::kNone && mFullyAutomatic) {
@@ -194,6 +857,9 @@ void PowerPointConverter::handleBearerReply(QNetworkReply* reply)
     case PowerPointConverterStatus::kUploadAndConvert:
       uploadAndConvert();
       break;
+    case PowerPointConverterStatus::kSyncFonts:
+      syncFonts(mStageAfterFontSync);
+      break;
     default:
       stopOnFailure("Updated Bearer token has no next stage...");
       break;
@@ -203,7 +869,7 @@ void PowerPointConverter::handleBearerReply(QNetworkReply* reply)
 
 void PowerPointConverter::uploadPresentation()
 {
-  if (mBearerToken.isEmpty()) {
+  if (!hasBearerToken()) {
     updateBearerToken(PowerPointConverterStatus::kUploadFile);
     return;
   }
@@ -212,17 +878,111 @@ void PowerPointConverter::uploadPresentation()
   emit progress(0.0f);
   setStatus(PowerPointConverterStatus::kUploadFile);
 
-  // a unique upload path
-  mServerpathAfterUpload = QUuid::createUuid().toString();
-  mServerfileAfterUpload = mLocalFilename; // assuming filename remains the same
+  // content addressed: an unchanged deck is uploaded once per account
+  mDeckHash = mStorageManifest.hashOfFile(mLocalFilepath);
+  if (mDeckHash.isEmpty()) {
+    stopOnFailure(QString("Can't read '%1'").arg(mLocalFilepath));
+    return;
+  }
+  mServerpathAfterUpload = kDeckFolder;
+  mServerfileAfterUpload = mDeckHash + ".pptx";
+  mBatchUploads.clear();
+
+  if (mStorageManifest.isUploaded(deckStorageKey(mServerfileAfterUpload), mDeckHash)) {
+    // uploaded before, make sure it was not removed from the storage meanwhile
+    emit debug(QString("Presentation '%1' is known in storage as %2").arg(mLocalFilename).arg(mServerfileAfterUpload));
+    QNetworkRequest request;
+    request.setUrl(serviceUrl(QString("/v3.0/slides/storage/exist/%1/%2").arg(mServerpathAfterUpload).arg(mServerfileAfterUpload)));
+    request.setRawHeader("Accept", "application/json");
+    request.setAttribute(QNetworkRequest::User, kStorageExistsRequest);
+    sendRequest(PowerPointConverterStatus::kUploadFile, [this, request]() { return mNetworkAccessManager->get(authorized(request)); });
+    return;
+  }
+  uploadDecks();
+}
+
+void PowerPointConverter::uploadDecks()
+{
+  // decks converted next are uploaded in the same request
+  QStringList candidates = mBatchCandidates;
+  for (const auto& job : mQueuedJobs) candidates << job->filepath;
+
+  std::vector<std::pair<QString, std::shared_ptr<MappedPresentation>>> batch; // server file, mapped deck
+  batch.emplace_back(mServerfileAfterUpload, mPresentation);
+  mBatchUploads[mServerfileAfterUpload] = mDeckHash;
+  qint64 batchBytes = mPresentation->size();
+  for (const auto& candidate : candidates) {
+    if (static_cast<int>(batch.size()) >= kMaxBatchFiles) break;
+    auto hash = mStorageManifest.hashOfFile(candidate);
+    const QString serverFile = hash + ".pptx";
+    if (hash.isEmpty() || mBatchUploads.count(serverFile) > 0 || mStorageManifest.isUploaded(deckStorageKey(serverFile), hash)) continue;
+    auto presentation = MappedPresentation::acquire(candidate);
+    if (!presentation || batchBytes + presentation->size() > kMaxBatchBytes) continue;
+    batchBytes += presentation->size();
+    batch.emplace_back(serverFile, presentation);
+    mBatchUploads[serverFile] = hash;
+  }
 
   QNetworkRequest request;
-  request.setUrl(QUrl(QString("https://api.aspose.cloud/v3.0/slides/storage/file/%1/%2").arg(mServerpathAfterUpload).arg(mServerfileAfterUpload)));
-  request.setRawHeader("Authorization", QString("Bearer %1").arg(mBearerToken).toUtf8());
-  request.setHeader(QNetworkRequest::ContentTypeHeader, "application/octet-stream");
   request.setRawHeader("Accept", "application/json");
 
-  registerNetworkReply(mNetworkAccessManager->put(request, mPresentationFile.get()), PowerPointConverterStatus::kUploadFile);
+  if (batch.size() == 1) {
+    request.setUrl(serviceUrl(QString("/v3.0/slides/storage/file/%1/%2").arg(mServerpathAfterUpload).arg(mServerfileAfterUpload)));
+    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/octet-stream");
+    // zero-copy: Qt reads the raw mapped bytes directly, the sender keeps the mapping alive for retries
+    auto presentation = mPresentation;
+    sendRequest(PowerPointConverterStatus::kUploadFile, [this, request, presentation]() { return mNetworkAccessManager->put(authorized(request), presentation->data()); });
+    return;
+  }
+
+  // one multipart request for all decks, stored as decks/<hash>.pptx
+  emit debug(QString("Uploading %1 presentations (%2 bytes) in one request").arg(batch.size()).arg(batchBytes));
+  request.setUrl(serviceUrl(QString("/v3.0/slides/storage/file/%1").arg(mServerpathAfterUpload)));
+  sendRequest(PowerPointConverterStatus::kUploadFile, [this, request, batch]() {
+    QHttpMultiPart* multiPart = new QHttpMultiPart(QHttpMultiPart::FormDataType);
+    for (size_t i = 0; i < batch.size(); ++i) {
+      QHttpPart part;
+      part.setHeader(QNetworkRequest::ContentTypeHeader, QVariant("application/octet-stream"));
+      part.setHeader(QNetworkRequest::ContentDispositionHeader, QVariant(QString("form-data; name=\"file%1\"; filename=\"%2\"").arg(i).arg(batch[i].first)));
+      part.setBody(batch[i].second->data());
+      multiPart->append(part);
+    }
+    // the parts wrap the mappings without copying, the sender keeps them alive
+    auto* reply = mNetworkAccessManager->put(authorized(request), multiPart);
+    multiPart->setParent(reply); // delete the multiPart with the reply
+    return reply;
+  });
+}
+
+QString PowerPointConverter::splitSlideSpec() const
+{
+  // renders are per service like the manifest keys, a mock server never serves a real deck
+  QString authority = mServiceUrl.authority();
+  authority.replace(QRegularExpression("[^A-Za-z0-9.-]"), "_");
+  return QString("cloud-%1-png-1920x1080").arg(authority);
+}
+
+QString PowerPointConverter::deckStorageKey(const QString& serverFile) const
+{
+  return deckStorageKey(serverFile, mCredentials->credential(mAccount).clientId);
+}
+
+QString PowerPointConverter::deckStorageKey(const QString& serverFile, const QString& clientId) const
+{
+  // storage is per service and account
+  return QString("%1/%2/%3/%4").arg(mServiceUrl.authority()).arg(clientId).arg(kDeckFolder).arg(serverFile);
+}
+
+QString PowerPointConverter::deckAccount(const QString& filepath)
+{
+  if (!mCredentials) mCredentials = CredentialPool::instance();
+  const auto hash = mStorageManifest.hashOfFile(filepath);
+  if (hash.isEmpty()) return QString();
+  for (int account = 0; account < mCredentials->accountCount(); ++account) {
+    const auto clientId = mCredentials->credential(account).clientId;
+    if (mStorageManifest.isUploaded(deckStorageKey(hash + ".pptx", clientId), hash)) return clientId;
+  }
+  return QString();
 }
 
 void PowerPointConverter::handleUploadReply(QNetworkReply* reply)
@@ -234,36 +994,63 @@ void PowerPointConverter::handleUploadReply(QNetworkReply* reply)
 
   emit debug("Handle Upload Reply");
 
-  // verify answer to ensure upload was successful
   QJsonDocument document;
   if (!getJsonFromNetworkReply(reply, document)) return;
-
   QJsonObject object = document.object();
+
+  if (reply->request().attribute(QNetworkRequest::User).toString() == kStorageExistsRequest) {
+    if (object["exists"].toBool()) {
+      emit debug(QString("Presentation '%1' is in storage, upload skipped").arg(mLocalFilename));
+      mStorageManifest.touch(deckStorageKey(mServerfileAfterUpload));
+      mStorageManifest.save();
+      if (!mJobId.isEmpty()) JobJournal::instance().recordUploaded(mJobId, mServerpathAfterUpload, mServerfileAfterUpload);
+      if (mFullyAutomatic) splitPresentationAndCreatePNGs();
+    }
+    else {
+      // removed from the storage by someone else
+      mStorageManifest.remove(deckStorageKey(mServerfileAfterUpload));
+      uploadDecks();
+    }
+    return;
+  }
+
+  // verify answer to ensure upload was successful
   if (!object.contains("uploaded") || !object["uploaded"].isArray()) {
     stopOnFailure("Upload reply does not contain an 'uploaded' array!");
     return;
   }
   auto uploadedArray = object["uploaded"].toArray();
-  if (uploadedArray.count() != 1) {
-    stopOnFailure("Uploaded array contains more than one value!");
+  if (uploadedArray.isEmpty()) {
+    stopOnFailure("Uploaded array is empty!");
     return;
   }
-  if (!uploadedArray.at(0).isString()) {
-    stopOnFailure("Uploaded array does not contain a string!");
-    return;
+  bool uploadedDeck = false;
+  for (const auto& uploadedValue : uploadedArray) {
+    if (!uploadedValue.isString()) {
+      stopOnFailure("Uploaded array does not contain a string!");
+      return;
+    }
+    // the other decks of a batch are reused by their own jobs
+    auto batchIter = mBatchUploads.find(uploadedValue.toString());
+    if (batchIter != mBatchUploads.end()) mStorageManifest.setUploaded(deckStorageKey(batchIter->first), batchIter->second);
+    if (uploadedValue.toString() == mServerfileAfterUpload) uploadedDeck = true;
   }
-  auto uploadedValue = uploadedArray.at(0).toString();
-  if (uploadedValue != mServerfileAfterUpload) {
-    emit debug(QString("Uploaded filename differs from expected name! Using returned value %1 instead of %2").arg(uploadedValue).arg(mServerfileAfterUpload));
-    mServerfileAfterUpload = uploadedValue;
+  mBatchUploads.clear();
+  mStorageManifest.save();
+  if (!uploadedDeck) {
+    stopOnFailure(QString("Upload reply does not list '%1'").arg(mServerfileAfterUpload));
+    return;
   }
 
+  // a restarted process continues from here
+  if (!mJobId.isEmpty()) JobJournal::instance().recordUploaded(mJobId, mServerpathAfterUpload, mServerfileAfterUpload);
+
   if (mFullyAutomatic) splitPresentationAndCreatePNGs();
 }
 
 void PowerPointConverter::splitPresentationAndCreatePNGs()
 {
-  if (mBearerToken.isEmpty()) {
+  if (!hasBearerToken()) {
     updateBearerToken(PowerPointConverterStatus::kSplitAndConvert);
     return;
   }
@@ -276,30 +1063,41 @@ void PowerPointConverter::splitPresentationAndCreatePNGs()
   setStatus(PowerPointConverterStatus::kSplitAndConvert);
   emit progress(0.33f);
 
-  QUrl url;
-  url.setHost("api.aspose.cloud");
-  url.setScheme("https");
-  url.setPath(QString("/v3.0/slides/%1/split").arg(mServerfileAfterUpload));
+  QUrl url = serviceUrl(QString("/v3.0/slides/%1/split").arg(mServerfileAfterUpload));
   QUrlQuery query;
   query.addQueryItem("folder", mServerpathAfterUpload);
   query.addQueryItem("format", "png");
   query.addQueryItem("height", "1080");
   query.addQueryItem("width", "1920");
-  query.addQueryItem("destFolder", mServerpathAfterUpload + "/split");
+  // the slides of this job, removed once it ended
+  mServerJobFolder = QString("%1/%2").arg(kJobFolder).arg(QUuid::createUuid().toString(QUuid::WithoutBraces));
+  if (!mJobId.isEmpty()) JobJournal::instance().recordJobFolder(mJobId, mServerJobFolder);
+  query.addQueryItem("destFolder", mServerJobFolder);
   query.addQueryItem("fontsFolder", "fonts");
   url.setQuery(query);
 
   QNetworkRequest request(url);
-  request.setRawHeader("Authorization", QString("Bearer %1").arg(mBearerToken).toUtf8());
   request.setRawHeader("Accept", "application/json");
   emit debug(QString(">> Split/Convert URL: '%1'").arg(url.toString()));
 
-  mSplitAndConvertTimer = std::make_unique<QTimer>();
-  connect(mSplitAndConvertTimer.get(), &QTimer::timeout, this, &PowerPointConverter::onSplitAndConvertTimerTimout);
-  mSplitAndConvertTimer->start(500);
-  mSplitAndConvertTimoutCounter = 0;
+  restartProgressTimer();
 
-  registerNetworkReply(mNetworkAccessManager->post(request, QByteArray()), PowerPointConverterStatus::kSplitAndConvert);
+  sendRequest(PowerPointConverterStatus::kSplitAndConvert, [this, request]() { return mNetworkAccessManager->post(authorized(request), QByteArray()); });
+}
+
+void PowerPointConverter::restartProgressTimer()
+{
+  if (!mSplitAndConvertTimer) {
+    // created once in the converter thread and reused by all jobs
+    mSplitAndConvertTimer = std::make_unique<QTimer>();
+    connect(mSplitAndConvertTimer.get(), &QTimer::timeout, this, [this]() {
+      if (mCurrentStatus == PowerPointConverterStatus::kSplitAndConvert) onSplitAndConvertTimerTimout();
+      else if (mCurrentStatus == PowerPointConverterStatus::kUploadAndConvert) onUploadAndConvertTimerTimout();
+      else mSplitAndConvertTimer->stop();
+    });
+  }
+  mSplitAndConvertTimoutCounter = 0;
+  mSplitAndConvertTimer->start(500);
 }
 
 void PowerPointConverter::onSplitAndConvertTimerTimout()
@@ -340,13 +1138,15 @@ void PowerPointConverter::handleSplitReply(QNetworkReply* reply)
     emit debug(QString("Split reply: Add to download queue %1...").arg(href));
     mDownloadQueue.push_back(href);
   }
+  if (!mJobId.isEmpty()) JobJournal::instance().recordSplit(mJobId, mDownloadQueue);
+  if (mRunningJob) mRunningJob->slides.setProgressRange(0, mDownloadQueue.count());
 
   if (mFullyAutomatic) downloadQueuedSlides();
 }
 
 void PowerPointConverter::downloadQueuedSlides()
 {
-  if (mBearerToken.isEmpty()) {
+  if (!hasBearerToken()) {
     updateBearerToken(PowerPointConverterStatus::kDownloadSlides);
     return;
   }
@@ -360,9 +1160,24 @@ void PowerPointConverter::downloadQueuedSlides()
   setStatus(PowerPointConverterStatus::kDownloadSlides);
   emit progress(0.66f);
 
-  for (const auto& url : mDownloadQueue) {
+  // compositors reading the frame ring see a new presentation
+  if (auto frameRing = FrameRing::instance()) frameRing->beginGeneration(mDownloadQueue.count());
+
+  // the split reply lists the slides in presentation order
+  const bool fingerprinted = mSlideFingerprints.count() == mDownloadQueue.count();
+  for (int i = 0; i < mDownloadQueue.count(); ++i) {
+    const auto& url = mDownloadQueue[i];
+    // saved before the conversion was resumed
+    if (mSavedSlideUrls.count(url) > 0) continue;
+    const QByteArray stored = fingerprinted ? SlideImageStore::instance().find(mSlideFingerprints[i], splitSlideSpec()) : QByteArray();
+    if (!stored.isEmpty()) {
+      emit debug(QString("Slide %1 taken from the slide store").arg(i + 1));
+      saveSlide(url, storedSlideFilename(i), stored);
+      continue;
+    }
     downloadSlidePng(url);
   }
+  if (mConvertedFiles.count() >= mDownloadQueue.count()) finishConversion();
 }
 
 void PowerPointConverter::downloadSlidePng(const QString& url)
@@ -380,10 +1195,11 @@ void PowerPointConverter::downloadSlidePng(const QString& url)
 
   QNetworkRequest request;
   request.setUrl(url);
-  request.setRawHeader("Authorization", QString("Bearer %1").arg(mBearerToken).toUtf8());
   request.setRawHeader("Accept", "application/json");
+  // the url as listed by the split reply, for the journal
+  request.setAttribute(QNetworkRequest::User, url);
 
-  registerNetworkReply(mNetworkAccessManager->get(request), PowerPointConverterStatus::kDownloadSlides);
+  sendRequest(PowerPointConverterStatus::kDownloadSlides, [this, request]() { return mNetworkAccessManager->get(authorized(request)); });
 }
 
 void PowerPointConverter::handleDownloadReply(QNetworkReply* reply)
@@ -409,35 +1225,287 @@ void PowerPointConverter::handleDownloadReply(QNetworkReply* reply)
     stopOnFailure(QString("Download reply: Failed to extract filename from header '%1'").arg(contentDispositionHeader));
     return;
   }
+  // the slides are named after the content addressed server file, use the local name
+  const auto serverBaseName = QFileInfo(mServerfileAfterUpload).completeBaseName();
+  if (!serverBaseName.isEmpty() && saveFilename.startsWith(serverBaseName)) {
+    saveFilename.replace(0, serverBaseName.size(), QFileInfo(mLocalFilename).completeBaseName());
+  }
 
-  mDownloadSyncMutex.lock();
+  // read into a recycled buffer instead of a new array per slide
+  auto& bufferPool = FrameBufferPool::instance();
+  const int available = static_cast<int>(reply->bytesAvailable());
+  QByteArray data = bufferPool.bytes(available);
+  data.resize(available);
+  data.resize(static_cast<int>(std::max<qint64>(reply->read(data.data(), available), 0)));
+  const auto slideUrl = reply->request().attribute(QNetworkRequest::User).toString();
+  // reused by the other decks containing this slide
+  const int index = mDownloadQueue.indexOf(slideUrl);
+  if (mSlideFingerprints.count() == mDownloadQueue.count() && index >= 0) {
+    SlideImageStore::instance().store(mSlideFingerprints[index], splitSlideSpec(), data);
+  }
+  saveSlide(slideUrl, saveFilename, data);
+  // back to the pool once the file writer is done with it
+  bufferPool.recycle(std::move(data));
+}
 
-  QString targetFile = mTargetPath + QDir::separator() + saveFilename;
-  QFile file(targetFile);
-  file.open(QIODevice::WriteOnly);
-  file.write(reply->readAll());
-  file.close();
+void PowerPointConverter::saveSlide(const QString& slideUrl, const QString& filename, const QByteArray& data)
+{
+  // written by the file writer thread, continued in onFileWritten
+  QString targetFile = mTargetPath + QDir::separator() + filename;
+  auto ticket = AsyncFileWriter::instance().write(targetFile, data);
+  mPendingWrites[ticket] = PowerPointConverterStatus::kDownloadSlides;
+  mPendingSlideUrls[ticket] = slideUrl;
+
+  // decoded once on the ring's thread, compositors read the raw frame from shared memory
+  if (auto frameRing = FrameRing::instance()) frameRing->publishPng(mDownloadQueue.indexOf(slideUrl), data);
+  emit debug(QString(">> Saving PNG as %1 into %2").arg(filename).arg(mTargetPath));
+}
+
+QString PowerPointConverter::storedSlideFilename(int index) const
+{
+  // named like the slides of the split request
+  return QString("%1_%2.png").arg(QFileInfo(mLocalFilename).completeBaseName()).arg(index + 1);
+}
+
+bool PowerPointConverter::allSlidesStored() const
+{
+  if (mSlideFingerprints.isEmpty() || mSlideFingerprints.count() != mPresentationInfo.slideCount) return false;
+  for (const auto& fingerprint : mSlideFingerprints) {
+    if (!SlideImageStore::instance().contains(fingerprint, splitSlideSpec())) return false;
+  }
+  return true;
+}
+
+void PowerPointConverter::convertFromSlideStore()
+{
+  emit debug(QString("All %1 slides of '%2' are in the slide store").arg(mSlideFingerprints.count()).arg(mLocalFilename));
+  setStatus(PowerPointConverterStatus::kDownloadSlides);
+  emit progress(0.66f);
+
+  mDownloadQueue.clear();
+  mConvertedFiles.clear();
+  for (int i = 0; i < mSlideFingerprints.count(); ++i) {
+    mDownloadQueue << QString("%1%2").arg(kStoredSlideScheme).arg(i + 1);
+  }
+  if (mRunningJob) mRunningJob->slides.setProgressRange(0, mDownloadQueue.count());
+  if (auto frameRing = FrameRing::instance()) frameRing->beginGeneration(mDownloadQueue.count());
+
+  for (int i = 0; i < mSlideFingerprints.count(); ++i) {
+    const QByteArray stored = SlideImageStore::instance().find(mSlideFingerprints[i], splitSlideSpec());
+    if (stored.isEmpty()) {
+      // removed by another process meanwhile
+      stopOnFailure(QString("Slide %1 vanished from the slide store").arg(i + 1));
+      return;
+    }
+    saveSlide(mDownloadQueue[i], storedSlideFilename(i), stored);
+  }
+}
+
+void PowerPointConverter::discardPendingWrites(bool removeFiles)
+{
+  for (const auto& pendingWrite : mPendingWrites) {
+    mDiscardedWrites[pendingWrite.first] = removeFiles;
+  }
+  mPendingWrites.clear();
+  mPendingSlideUrls.clear();
+}
+
+void PowerPointConverter::onFileWritten(quint64 ticket, const QString& path, bool success, const QString& errorMessage)
+{
+  auto discarded = mDiscardedWrites.find(ticket);
+  if (discarded != mDiscardedWrites.end()) {
+    // written after its job ended
+    if (discarded->second) QFile::remove(path);
+    mDiscardedWrites.erase(discarded);
+    return;
+  }
+  auto iter = mPendingWrites.find(ticket);
+  if (iter == mPendingWrites.end()) return; // another converter's file
+  auto stage = iter->second;
+  mPendingWrites.erase(iter);
+  QString slideUrl;
+  auto urlIter = mPendingSlideUrls.find(ticket);
+  if (urlIter != mPendingSlideUrls.end()) {
+    slideUrl = urlIter->second;
+    mPendingSlideUrls.erase(urlIter);
+  }
+
+  if (!success) {
+    stopOnFailure(QString("Saving %1 failed: %2").arg(path).arg(errorMessage));
+    return;
+  }
+  if (mCurrentStatus != stage) {
+    // the job left the stage meanwhile, the writes of ended jobs are discarded above
+    return;
+  }
 
-  mConvertedFiles << targetFile;
-  // progress from 0.66 -> 1.0
-  emit progress(0.66f + (static_cast<float>(mConvertedFiles.count()) / mDownloadQueue.count()) * 0.33);
+  mConvertedFiles << path;
+  if (stage == PowerPointConverterStatus::kDownloadSlides) {
+    metrics().slides.increment();
+    if (!mJobId.isEmpty()) JobJournal::instance().recordSaved(mJobId, slideUrl, path);
+    if (mRunningJob) {
+      // callers may use the slide before the others are downloaded
+      SlideResult result;
+      result.index = mDownloadQueue.indexOf(slideUrl);
+      result.file = path;
+      mRunningJob->slides.reportResult(result, result.index);
+      mRunningJob->slides.setProgressValue(mConvertedFiles.count());
+    }
+    // progress from 0.66 -> 1.0
+    emit progress(0.66f + (static_cast<float>(mConvertedFiles.count()) / mDownloadQueue.count()) * 0.33);
+
+    emit debug(QString(">> Saved PNG %1").arg(path));
+    emit debug(QString(">> %1 / %2").arg(mConvertedFiles.count()).arg(mDownloadQueue.count()));
 
-  emit debug(QString(">> Saved PNG as %1 into %2").arg(saveFilename).arg(mTargetPath));
-  emit debug(QString(">> %1 / %2").arg(mConvertedFiles.count()).arg(mDownloadQueue.count()));
+    if (mConvertedFiles.count() < mDownloadQueue.count()) return;
+  }
+  else {
+    emit debug(QString(">> Saved result %1").arg(path));
+    metrics().slides.increment(mPresentationInfo.slideCount);
+  }
+  finishConversion();
+}
+
+void PowerPointConverter::finishConversion()
+{
+  // all slides downloaded
+  mDownloadQueue.clear();
+  emit progress(1.0f);
+  if (mDeadlineTimer) mDeadlineTimer->stop();
+  setStatus(PowerPointConverterStatus::kFinishedConversion);
+  emit processingDone(mConvertedFiles);
+}
+
+void PowerPointConverter::syncFonts(PowerPointConverterStatus nextStage)
+{
+  mStageAfterFontSync = nextStage;
+  if (!mFontSyncEnabled) {
+    continueAfterFontSync();
+    return;
+  }
+  if (!mFontLocator) {
+    // indexes the local font folders on first use, off the converter thread
+    mFontLocator = std::make_unique<FontLocator>();
+    mFontIndexWatcher = std::make_unique<QFutureWatcher<void>>();
+    connect(mFontIndexWatcher.get(), &QFutureWatcherBase::finished, this, [this]() {
+      // the job waiting for the index may have been cancelled meanwhile
+      if (!mAwaitingFontIndex || mCurrentStatus != PowerPointConverterStatus::kSyncFonts) return;
+      mAwaitingFontIndex = false;
+      syncFonts(mStageAfterFontSync);
+    });
+    mFontIndexWatcher->setFuture(mFontLocator->index());
+  }
+  mAwaitingFontIndex = false;
+  if (!mFontIndexWatcher->isFinished()) {
+    emit debug("Indexing the local fonts");
+    setStatus(PowerPointConverterStatus::kSyncFonts);
+    mAwaitingFontIndex = true;
+    return;
+  }
 
-  if (mConvertedFiles.count() == mDownloadQueue.count()) {
-    mDownloadQueue.clear();
-    // all slides downloaded
-    emit progress(1.0f);
-    setStatus(PowerPointConverterStatus::kFinishedConversion);
-    emit processingDone(mConvertedFiles);
+  // collect the local files of all referenced but not embedded fonts
+  QElapsedTimer timer;
+  timer.start();
+  std::map<QString, std::pair<QString, QByteArray>> missingFonts; // server name -> local file and hash
+  for (const auto& family : mPresentationInfo.fonts) {
+    if (mPresentationInfo.embeddedFonts.contains(family)) continue;
+    auto files = mFontLocator->filesForFamily(family);
+    if (files.isEmpty()) {
+      emit debug(QString("Font '%1' is not installed locally, the service will substitute it").arg(family));
+      continue;
+    }
+    for (const auto& file : files) {
+      auto hash = mStorageManifest.hashOfFile(file);
+      if (hash.isEmpty()) continue;
+      // named by content, font files of the same name from other folders or
+      // versions neither overwrite each other nor share a manifest entry
+      const QFileInfo fileInfo(file);
+      auto serverName = QString("%1-%2.%3").arg(fileInfo.completeBaseName()).arg(QString::fromLatin1(hash.left(12))).arg(fileInfo.suffix());
+      // keyed by service, a mock endpoint must not mark fonts as uploaded to the real one
+      if (mStorageManifest.isUploaded(mServiceUrl.authority() + "/" + serverName, hash)) continue;
+      missingFonts[serverName] = std::make_pair(file, hash);
+    }
+  }
+  emit debug(QString("Font check took %1 ms: %2 fonts to upload").arg(timer.elapsed()).arg(missingFonts.size()));
+
+  if (missingFonts.empty()) {
+    // manifest matches, skip the step
+    continueAfterFontSync();
+    return;
+  }
+  if (!hasBearerToken()) {
+    updateBearerToken(PowerPointConverterStatus::kSyncFonts);
+    return;
+  }
+
+  setStatus(PowerPointConverterStatus::kSyncFonts);
+  // all uploads in parallel, the access manager limits the connections per host
+  mFontUploadsRemaining = 0;
+  for (const auto& missingFont : missingFonts) {
+    const QString serverName = missingFont.first;
+    const QString localFile = missingFont.second.first;
+    const QByteArray hash = missingFont.second.second;
+    if (!QFileInfo(localFile).isReadable()) {
+      emit debug(QString("Font file '%1' can't be opened").arg(localFile));
+      continue;
+    }
+    QNetworkRequest request;
+    request.setUrl(serviceUrl(QString("/v3.0/slides/storage/file/fonts/%1").arg(serverName)));
+    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/octet-stream");
+    request.setRawHeader("Accept", "application/json");
+    emit debug(QString("Upload font '%1'").arg(serverName));
+
+    mFontUploadsRemaining++;
+    sendRequest(PowerPointConverterStatus::kSyncFonts, [this, request, serverName, localFile, hash]() {
+      auto* file = new QFile(localFile);
+      file->open(QIODevice::ReadOnly);
+      auto* reply = mNetworkAccessManager->put(authorized(request), file);
+      file->setParent(reply); // close and delete the file with the reply
+      mFontUploads[reply] = std::make_pair(serverName, hash);
+      return reply;
+    });
+  }
+  if (mFontUploadsRemaining == 0) continueAfterFontSync();
+}
+
+void PowerPointConverter::handleFontUploadReply(QNetworkReply* reply)
+{
+  auto iter = mFontUploads.find(reply);
+  if (iter == mFontUploads.end()) return;
+  if (reply->error() == QNetworkReply::NoError) {
+    mStorageManifest.setUploaded(mServiceUrl.authority() + "/" + iter->second.first, iter->second.second);
+  }
+  else {
+    // not fatal, the service substitutes missing fonts
+    emit debug(QString("Font upload of '%1' failed: %2").arg(iter->second.first).arg(reply->errorString()));
+  }
+  mFontUploads.erase(iter);
+
+  if (--mFontUploadsRemaining == 0) {
+    mStorageManifest.save();
+    continueAfterFontSync();
+  }
+}
+
+void PowerPointConverter::continueAfterFontSync()
+{
+  switch (mStageAfterFontSync)
+  {
+  case PowerPointConverterStatus::kUploadFile:
+    uploadPresentation();
+    break;
+  case PowerPointConverterStatus::kUploadAndConvert:
+    uploadAndConvert();
+    break;
+  default:
+    stopOnFailure("Font sync has no next stage...");
+    break;
   }
-  mDownloadSyncMutex.unlock();
 }
 
 void PowerPointConverter::uploadAndConvert()
 {
-  if (mBearerToken.isEmpty()) {
+  if (!hasBearerToken()) {
     updateBearerToken(PowerPointConverterStatus::kUploadAndConvert);
     return;
   }
@@ -447,10 +1515,7 @@ void PowerPointConverter::uploadAndConvert()
   setStatus(PowerPointConverterStatus::kUploadAndConvert);
 
 
-  QUrl url;
-  url.setHost("api.aspose.cloud");
-  url.setScheme("https");
-  url.setPath(QString("/v3.0/slides/convert/Png"));
+  QUrl url = serviceUrl("/v3.0/slides/convert/Png");
   QUrlQuery query;
   query.addQueryItem("fontsFolder", "fonts");
   //query.addQueryItem("width", "1920");
@@ -458,8 +1523,6 @@ void PowerPointConverter::uploadAndConvert()
   //query.addQueryItem("outPath", "output");
   url.setQuery(query);
 
-  QHttpMultiPart* multiPart = new QHttpMultiPart(QHttpMultiPart::FormDataType);
-
   QHttpPart jsonPart;
   jsonPart.setHeader(QNetworkRequest::ContentTypeHeader, QVariant("text/json"));
   jsonPart.setHeader(QNetworkRequest::ContentDispositionHeader, QVariant("form-data; name=\"data\""));
@@ -473,16 +1536,20 @@ void PowerPointConverter::uploadAndConvert()
   QHttpPart presentationPart;
   presentationPart.setHeader(QNetworkRequest::ContentTypeHeader, QVariant("application/octet-stream"));
   presentationPart.setHeader(QNetworkRequest::ContentDispositionHeader, QVariant(QString("form-data; name=\"file0\"; filename=\"%1\"").arg(mLocalFilename)));
-  presentationPart.setBodyDevice(mPresentationFile.get());
-
-  multiPart->append(jsonPart);
-  multiPart->append(presentationPart);
+  presentationPart.setBody(mPresentation->data());
 
   QNetworkRequest request(url);
-  request.setRawHeader("Authorization", QString("Bearer %1").arg(mBearerToken).toUtf8());
 
-  auto* reply = registerNetworkReply(mNetworkAccessManager->post(request, multiPart /* mPresentationFile.get() */), PowerPointConverterStatus::kUploadAndConvert);
-  multiPart->setParent(reply); // delete the multiPart with the reply
+  // the multipart is consumed by the reply, a retry needs a new one
+  auto presentation = mPresentation;
+  sendRequest(PowerPointConverterStatus::kUploadAndConvert, [this, request, jsonPart, presentationPart, presentation]() {
+    QHttpMultiPart* multiPart = new QHttpMultiPart(QHttpMultiPart::FormDataType);
+    multiPart->append(jsonPart);
+    multiPart->append(presentationPart);
+    auto* reply = mNetworkAccessManager->post(authorized(request), multiPart);
+    multiPart->setParent(reply); // delete the multiPart with the reply
+    return reply;
+  });
 }
 
 void PowerPointConverter::onUploadAndConvertTimerTimout()
@@ -497,6 +1564,7 @@ void PowerPointConverter::onUploadAndConvertTimerTimout()
 
 void PowerPointConverter::handleUploadAndConvertReply(QNetworkReply* reply)
 {
+  if (mSplitAndConvertTimer) mSplitAndConvertTimer->stop();
   if (mCurrentStatus != PowerPointConverterStatus::kUploadAndConvert) {
     stopOnFailure(QString("DownloadAndConvert reply: wrong status: %1").arg(static_cast<int>(mCurrentStatus)));
     return;
@@ -519,22 +1587,10 @@ void PowerPointConverter::handleUploadAndConvertReply(QNetworkReply* reply)
     saveFilename = "result.zip";
   }
 
+  // written by the file writer thread, continued in onFileWritten
   QString targetFile = mTargetPath + QDir::separator() + saveFilename;
-  QFile file(targetFile);
-  file.open(QIODevice::WriteOnly);
-  file.write(reply->readAll());
-  file.close();
-
-  mConvertedFiles << targetFile;
-
-  emit debug(QString(">> Saved result as %1 into %2").arg(saveFilename).arg(mTargetPath));
-
-
-
-  // all slides downloaded
-  emit progress(1.0f);
-  setStatus(PowerPointConverterStatus::kFinishedConversion);
-  emit processingDone(mConvertedFiles);
+  mPendingWrites[AsyncFileWriter::instance().write(targetFile, reply->readAll())] = PowerPointConverterStatus::kUploadAndConvert;
+  emit debug(QString(">> Saving result as %1 into %2").arg(saveFilename).arg(mTargetPath));
 }
 
 QNetworkReply* PowerPointConverter::registerNetworkReply(QNetworkReply* reply, PowerPointConverterStatus stage)
@@ -542,6 +1598,12 @@ QNetworkReply* PowerPointConverter::registerNetworkReply(QNetworkReply* reply, P
   emit debug(QString(">> Register network reply: Stage %1, Url: %2").arg(static_cast<int>(stage)).arg(reply->request().url().toString(QUrl::PrettyDecoded)));
   // keep in map and connect signals
   mNetworkReplies[reply] = stage;
+  sLiveReplies++;
+  metrics().inflightReplies.add(1);
+  connect(reply, &QObject::destroyed, []() {
+    sLiveReplies--;
+    metrics().inflightReplies.add(-1);
+  });
   connect(reply, &QNetworkReply::downloadProgress, this, &PowerPointConverter::onDownloadProgress);
   connect(reply, &QNetworkReply::encrypted, this, &PowerPointConverter::onEncrypted);
   connect(reply, &QNetworkReply::errorOccurred, this, &PowerPointConverter::onErrorOccurred);
@@ -551,6 +1613,87 @@ QNetworkReply* PowerPointConverter::registerNetworkReply(QNetworkReply* reply, P
   return reply;
 }
 
+void PowerPointConverter::sendRequest(PowerPointConverterStatus stage, const RequestSender& sender)
+{
+  mPendingRequests.emplace_back(stage, sender);
+  sendPendingRequests();
+}
+
+void PowerPointConverter::sendPendingRequests()
+{
+  while (!mPendingRequests.empty()) {
+    auto wait = mCredentials ? mCredentials->tryAcquireRequest(mAccount) : 0;
+    if (wait > 0) {
+      // quota of the account used up, try again once a token is available
+      if (!mThrottleTimer) {
+        mThrottleTimer = std::make_unique<QTimer>();
+        mThrottleTimer->setSingleShot(true);
+        connect(mThrottleTimer.get(), &QTimer::timeout, this, &PowerPointConverter::sendPendingRequests);
+      }
+      if (!mThrottleTimer->isActive()) mThrottleTimer->start(static_cast<int>(wait));
+      emit debug(QString(">> Throttled %1 requests for %2 ms").arg(mPendingRequests.size()).arg(wait));
+      updateQueuedRequestsGauge();
+      return;
+    }
+    auto pending = mPendingRequests.front();
+    mPendingRequests.pop_front();
+    auto* reply = registerNetworkReply(pending.second(), pending.first);
+    mRequestSenders[reply] = pending.second;
+  }
+  updateQueuedRequestsGauge();
+}
+
+bool PowerPointConverter::retryIfRateLimited(QNetworkReply* reply, PowerPointConverterStatus stage)
+{
+  auto senderIter = mRequestSenders.find(reply);
+  if (senderIter == mRequestSenders.end()) return false;
+  auto sender = senderIter->second;
+  mRequestSenders.erase(senderIter);
+
+  const int httpStatus = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+  if (retriesUnauthorized(reply, stage)) {
+    mFontUploads.erase(reply);
+    reply->deleteLater();
+    refreshRejectedToken(stage, sender);
+    return true;
+  }
+  if (httpStatus != 429 || !mCredentials) {
+    if (mCredentials && httpStatus > 0 && httpStatus < 400) mCredentials->reportSuccess(mAccount);
+    return false;
+  }
+
+  // Retry-After is either seconds or a HTTP date
+  qint64 retryAfterMsecs = -1;
+  auto retryAfter = QString::fromLatin1(reply->rawHeader("Retry-After")).trimmed();
+  bool isNumber = false;
+  auto seconds = retryAfter.toLongLong(&isNumber);
+  if (isNumber) {
+    retryAfterMsecs = seconds * 1000;
+  }
+  else if (!retryAfter.isEmpty()) {
+    auto date = QDateTime::fromString(retryAfter, Qt::RFC2822Date);
+    if (date.isValid()) retryAfterMsecs = qMax<qint64>(0, QDateTime::currentDateTimeUtc().msecsTo(date));
+  }
+  retryAfterMsecs = mCredentials->reportRateLimited(mAccount, retryAfterMsecs);
+  emit debug(QString("Rate limited (429) at stage %1, retry in %2 ms").arg(static_cast<int>(stage)).arg(retryAfterMsecs));
+
+  mFontUploads.erase(reply);
+  reply->deleteLater();
+  // retry first, it was sent before all pending ones
+  mPendingRequests.emplace_front(stage, sender);
+  sendPendingRequests();
+  return true;
+}
+
+bool PowerPointConverter::retriesUnauthorized(QNetworkReply* reply, PowerPointConverterStatus stage) const
+{
+  // a request rejected with the token refreshed for it fails, the credentials are wrong.
+  // The token request itself and the storage deletes of older jobs are not retried
+  if (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 401 || !mCredentials) return false;
+  if (stage == PowerPointConverterStatus::kUpdateBearerToken || stage == PowerPointConverterStatus::kCollectStorage) return false;
+  return mRefreshedToken.isEmpty() || reply->request().rawHeader("Authorization") != QString("Bearer %1").arg(mRefreshedToken).toUtf8();
+}
+
 bool PowerPointConverter::getJsonFromNetworkReply(QNetworkReply* reply, QJsonDocument& document)
 {
   if (!reply->header(QNetworkRequest::ContentTypeHeader).toString().contains("application/json")) {
@@ -566,7 +1709,9 @@ bool PowerPointConverter::getJsonFromNetworkReply(QNetworkReply* reply, QJsonDoc
     return false;
   }
 
-  emit debug(QString("Json response: %1").arg(QString(document.toJson(QJsonDocument::Compact))));
+  QJsonObject logged = document.object();
+  if (logged.contains("access_token")) logged["access_token"] = redacted(logged.value("access_token").toString());
+  emit debug(QString("Json response: %1").arg(QString(document.isObject() ? QJsonDocument(logged).toJson(QJsonDocument::Compact) : document.toJson(QJsonDocument::Compact))));
 
   QJsonObject object = document.object();
   if (object.contains("error")) {
@@ -581,7 +1726,8 @@ bool PowerPointConverter::getJsonFromNetworkReply(QNetworkReply* reply, QJsonDoc
 
 void PowerPointConverter::onRequestFinished(QNetworkReply* reply)
 {
-  emit debug("Request finished");
+  // every reply (handled, failed, aborted or resent) is deleted here, after
+  // onReplyFinished read it, since deletion is deferred to the event loop
   reply->deleteLater();
 }
 
@@ -595,6 +1741,18 @@ void PowerPointConverter::onDownloadProgress(qint64 bytesReceived, qint64 bytesT
 
 void PowerPointConverter::onErrorOccurred(QNetworkReply::NetworkError code)
 {
+  MetricsRegistry::instance().counter("pptx_converter_network_errors_total", "Network errors by QNetworkReply::NetworkError", QString("code=\"%1\"").arg(static_cast<int>(code))).increment();
+
+  // a failed font upload is handled when its reply finishes
+  auto* reply = static_cast<QNetworkReply*>(sender());
+  if (mFontUploads.count(reply) > 0) return;
+  // a failed storage delete is retried after a later job
+  auto stage = mNetworkReplies.find(reply);
+  if (stage != mNetworkReplies.end() && stage->second == PowerPointConverterStatus::kCollectStorage) return;
+  // rate limited requests and requests rejected with an expired token are resent when finished
+  if (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 429) return;
+  if (stage != mNetworkReplies.end() && retriesUnauthorized(reply, stage->second)) return;
+
   QString error;
   switch (code)
   {
@@ -717,6 +1875,13 @@ void PowerPointConverter::onSslErrors(const QList<QSslError>& errors)
 void PowerPointConverter::onUploadProgress(qint64 bytesSent, qint64 bytesTotal)
 {
   emit debug(QString("Upload progress: %1/%2").arg(bytesSent).arg(bytesTotal));
+  if (bytesTotal > 0 && bytesSent == bytesTotal) {
+    metrics().uploadBytes.increment(bytesTotal);
+    // live throughput for the flow selection, the stage started with the upload
+    const bool uploadStage = mCurrentStatus == PowerPointConverterStatus::kUploadFile || mCurrentStatus == PowerPointConverterStatus::kUploadAndConvert;
+    if (uploadStage) mJobUploadBytes += bytesTotal;
+    if (uploadStage && mStageTimer.isValid()) FlowCostModel::instance().recordUpload(bytesTotal, mStageTimer.elapsed());
+  }
   if (mCurrentStatus == PowerPointConverterStatus::kUploadFile) {
     // upload is from 0->0.33
     emit progress(0.33 * bytesSent / static_cast<float>(bytesTotal));
@@ -724,11 +1889,7 @@ void PowerPointConverter::onUploadProgress(qint64 bytesSent, qint64 bytesTotal)
   if (mCurrentStatus == PowerPointConverterStatus::kUploadAndConvert) {
     emit progress(0.33 * bytesSent / static_cast<float>(bytesTotal));
     if (bytesSent == bytesTotal) {
-      mSplitAndConvertTimer = std::make_unique<QTimer>();
-      connect(mSplitAndConvertTimer.get(), &QTimer::timeout, this, &PowerPointConverter::onUploadAndConvertTimerTimout);
-      mSplitAndConvertTimer->start(500);
-      mSplitAndConvertTimoutCounter = 0;
-
+      restartProgressTimer();
     }
   }
 }
@@ -737,12 +1898,25 @@ void PowerPointConverter::onReplyFinished()
 {
   // get reply and find in reply map
   auto reply = static_cast<QNetworkReply*>(sender());
+  // nothing read yet, the whole body is available
+  metrics().downloadBytes.increment(reply->bytesAvailable());
   auto iter = mNetworkReplies.find(reply);
   if (iter != mNetworkReplies.end()) {
     PowerPointConverterStatus stage = iter->second;
     emit debug(QString("Reply finished stage %1").arg(static_cast<int>(stage)));
     // remove from map
     mNetworkReplies.erase(iter);
+    if (retryIfRateLimited(reply, stage)) return;
+    if (stage == PowerPointConverterStatus::kCollectStorage) {
+      // not part of the job, handled whatever its status
+      handleStorageDeleteReply(reply);
+      return;
+    }
+    const bool existsCheck = reply->request().attribute(QNetworkRequest::User).toString() == kStorageExistsRequest;
+    if ((stage == PowerPointConverterStatus::kUploadFile && !existsCheck) || stage == PowerPointConverterStatus::kUploadAndConvert) {
+      // the upload is complete, release the mapping (other jobs may still hold it)
+      mPresentation.reset();
+    }
     // get headers
     for (const auto& pair : reply->rawHeaderPairs()) {
       emit debug(QString(">> Reply header: %1: %2").arg(QString::fromUtf8(pair.first)).arg(QString::fromUtf8(pair.second)));
@@ -772,6 +1946,9 @@ void PowerPointConverter::onReplyFinished()
       case PowerPointConverterStatus::kUploadAndConvert:
         handleUploadAndConvertReply(reply);
         break;
+      case PowerPointConverterStatus::kSyncFonts:
+        handleFontUploadReply(reply);
+        break;
       case PowerPointConverterStatus::kNone:
       case PowerPointConverterStatus::kFailure:
       default:
@@ -6,7 +6,21 @@
 #include <QFile>
 #include <QMutex>
 #include <QTimer>
+#include <QElapsedTimer>
+#include <QFutureInterface>
+#include <QFutureWatcher>
 #include <deque>
+#include <set>
+#include "MappedPresentation.h"
+#include "PresentationInspector.h"
+#include "FontLocator.h"
+#include "StorageManifest.h"
+#include "CredentialPool.h"
+#include "JobJournal.h"
+#include "ConversionJob.h"
+#include "FlowCostModel.h"
+#include <functional>
+#include <atomic>
 
 // Convert a Powerpoint file using Aspose cloud service
 
@@ -25,11 +39,46 @@ public:
     kDownloadSlides,
     kFinishedConversion,
     kUploadAndConvert,
+    kSyncFonts,
+    kCancelled,
+    // deleting stale storage after a job, never the status of the converter
+    kCollectStorage,
   };
 
+  // the service to talk to, https://api.aspose.cloud by default (e.g. a local mock for soak tests)
+  void setServiceUrl(const QUrl& url);
+  // replies alive in all converters, for leak checks
+  static int liveReplyCount();
+
+  // thread-safe: queue the conversion of a presentation into PNGs (upload, split, download).
+  // Queued jobs run one after the other in the converter's thread
+  ConversionJob convert(const QString& filepath, const QString& targetpath);
+  // presentations likely converted next, uploaded together with the next one
+  void setBatchUploadCandidates(const QStringList& filepaths);
+
 public slots:
   void convertPowerpointFile(const QString& filepath, const QString& targetpath);
   void convertPowerpointFile2(const QString& filepath, const QString& targetpath);
+  // either flow, whichever FlowCostModel expects to be faster for this deck
+  void convertPowerpointFileAuto(const QString& filepath, const QString& targetpath);
+  // abort the running conversion, outstanding requests and partial outputs
+  void cancelConversion();
+  // abort conversions running longer than msecs (0 = no deadline)
+  void setConversionDeadline(int msecs);
+  // continue the jobs a previous process left unfinished in the journal, one after the other
+  void resumeUnfinishedJobs();
+  // record jobs in the journal (on by default, off for soak tests)
+  void setJournalEnabled(bool enabled);
+  // take slides converted before from the SlideImageStore (on by default, off for benchmarks)
+  void setSlideStoreEnabled(bool enabled);
+  // keep the storage manifest in another file (empty: the one in the application data folder)
+  void setStorageManifestPath(const QString& path);
+  // upload missing fonts before converting (on by default, off for soak tests)
+  void setFontSyncEnabled(bool enabled);
+  // feed finished jobs to the FlowCostModel (on by default, off for soak tests)
+  void setFlowCostSamplesEnabled(bool enabled);
+  // take the accounts from this pool instead of the shared one
+  void setCredentialPool(std::shared_ptr<CredentialPool> credentials);
 
 signals:
   void processingDone(const QStringList& createdPngs);
@@ -50,6 +99,9 @@ private slots:
   void onReplyFinished();
   void onEncrypted();
 
+  // completion of the asynchronous file writer
+  void onFileWritten(quint64 ticket, const QString& path, bool success, const QString& errorMessage);
+
 private:
 
   void setPowerpointFile(const QString& filepath);
@@ -57,15 +109,25 @@ private:
 
   void setStatus(PowerPointConverterStatus status);
   void stopOnFailure(const QString& message);
+  // job bookkeeping: account, deadline and metrics. False (and failed) if no cloud account is available
+  bool startJob(const QString& clientId = QString());
+  QElapsedTimer mJobTimer;
+  QElapsedTimer mStageTimer;
+  // abort all requests except keep, stop timers and free the job's resources
+  void abortOutstandingReplies(QNetworkReply* keep = nullptr);
+  void startDeadline();
+  void onDeadlineTimeout();
 
   // update the authentication token
   void updateBearerToken(PowerPointConverterStatus nextStage);
   void handleBearerReply(QNetworkReply* reply);
   // upload the presentation
   void uploadPresentation();
+  void uploadDecks();
   void handleUploadReply(QNetworkReply* reply);
   // split the presentation into PNGs
   void splitPresentationAndCreatePNGs();
+  void restartProgressTimer();
   void onSplitAndConvertTimerTimout();
   void handleSplitReply(QNetworkReply* reply);
   // queue up the slide downloads
@@ -73,44 +135,168 @@ private:
   // download a single slide png
   void downloadSlidePng(const QString& url);
   void handleDownloadReply(QNetworkReply* reply);
+  // write a slide png to the target path, reported by onFileWritten
+  void saveSlide(const QString& slideUrl, const QString& filename, const QByteArray& data);
+  void finishConversion();
+  // slides converted before, in any deck, are taken from the SlideImageStore
+  QVector<QByteArray> mSlideFingerprints;
+  bool mSlideStoreEnabled = true;
+  bool allSlidesStored() const;
+  void convertFromSlideStore();
+  QString storedSlideFilename(int index) const;
+  // slide store spec of the slides rendered by the split request of this service
+  QString splitSlideSpec() const;
+  // flow of the running job for the cost model, kNone if not representative (resumed or from the slide store)
+  PowerPointConverterStatus mJobFlow = PowerPointConverterStatus::kNone;
+  bool mFlowCostSamplesEnabled = true;
+  // bytes the running job uploaded, 0 if the deck was reused from storage
+  qint64 mJobUploadBytes = 0;
+
+  // upload the fonts of the presentation missing in the cloud fonts folder
+  bool mFontSyncEnabled = true;
+  void syncFonts(PowerPointConverterStatus nextStage);
+  void handleFontUploadReply(QNetworkReply* reply);
+  void continueAfterFontSync();
 
   void uploadAndConvert();
   void onUploadAndConvertTimerTimout();
   void handleUploadAndConvertReply(QNetworkReply* reply);
 
-  // service authentication information
-  const QString kClientId = "af708600-5a90-4fd7-a119-0c644fa4fe1c";
-  const QString kClientSecret = "adac2fcf6871ad12711270c0cde60e2b";
+  // service authentication information: the account of the current job
+  std::shared_ptr<CredentialPool> mCredentials;
+  int mAccount = -1;
   QString mBearerToken;
+  // reload the account's token, false if there is none or it is about to expire
+  bool hasBearerToken();
+  // a copy of request carrying the current token
+  QNetworkRequest authorized(QNetworkRequest request) const;
+  QNetworkRequest bearerTokenRequest(QByteArray* data) const;
+  // a request was rejected with 401: new token, then send it again (once)
+  bool retriesUnauthorized(QNetworkReply* reply, PowerPointConverterStatus stage) const;
+  // the token requested after the last 401
+  QString mRefreshedToken;
+  void acquireAccount(const QString& clientId);
+  void releaseAccount();
   // network handling  
+  QUrl mServiceUrl = QUrl("https://api.aspose.cloud");
+  QUrl serviceUrl(const QString& path) const;
+  void createNetworkAccessManager();
   std::unique_ptr<QNetworkAccessManager> mNetworkAccessManager;
+  static std::atomic<int> sLiveReplies;
   std::map<QNetworkReply*, PowerPointConverterStatus> mNetworkReplies;
   QNetworkReply* registerNetworkReply(QNetworkReply* reply, PowerPointConverterStatus stage);
+  // requests are sent through the rate limiter of the account and resent after 429, or after 401 with a new token
+  using RequestSender = std::function<QNetworkReply*()>;
+  void sendRequest(PowerPointConverterStatus stage, const RequestSender& sender);
+  void sendPendingRequests();
+  bool retryIfRateLimited(QNetworkReply* reply, PowerPointConverterStatus stage);
+  std::deque<std::pair<PowerPointConverterStatus, RequestSender>> mPendingRequests;
+  std::map<QNetworkReply*, RequestSender> mRequestSenders;
+  // rejected with 401, resent once the new token arrived
+  std::deque<std::pair<PowerPointConverterStatus, RequestSender>> mAwaitingToken;
+  void refreshRejectedToken(PowerPointConverterStatus stage, const RequestSender& sender);
+  std::unique_ptr<QTimer> mThrottleTimer;
+  void updateQueuedRequestsGauge();
+  qint64 mReportedQueuedRequests = 0;
   bool getJsonFromNetworkReply(QNetworkReply* reply, QJsonDocument& document);
 
   // status
   PowerPointConverterStatus mCurrentStatus = PowerPointConverterStatus::kNone;
   PowerPointConverterStatus mStageAfterTokenUpdate = PowerPointConverterStatus::kNone;
 
-  // the local file to convert
-  std::unique_ptr<QFile> mPresentationFile;
+  // the local file to convert, mapped read-only until its upload finished
+  std::shared_ptr<MappedPresentation> mPresentation;
+  // pre-flight information about the file
+  PresentationInfo mPresentationInfo;
   QString mLocalFilename;
   QString mLocalFilepath;
 
+  // font synchronisation
+  std::unique_ptr<FontLocator> mFontLocator;
+  // the first sync waits for the locator to index the font folders
+  std::unique_ptr<QFutureWatcher<void>> mFontIndexWatcher;
+  bool mAwaitingFontIndex = false;
+  // fonts and decks known in the cloud storage
+  StorageManifest mStorageManifest;
+  PowerPointConverterStatus mStageAfterFontSync = PowerPointConverterStatus::kNone;
+  // pending font upload -> server name and hash
+  std::map<QNetworkReply*, std::pair<QString, QByteArray>> mFontUploads;
+  int mFontUploadsRemaining = 0;
+
   // server information
   QString mServerpathAfterUpload = "folder";
   QString mServerfileAfterUpload;
+  QString mServerJobFolder;
+
+  // content addressed deck storage, shared by all jobs of an account
+  QByteArray mDeckHash;
+  QString deckStorageKey(const QString& serverFile) const;
+  QString deckStorageKey(const QString& serverFile, const QString& clientId) const;
+  // client id of the account whose storage holds the deck already, empty if none
+  QString deckAccount(const QString& filepath);
+  QStringList mBatchCandidates;
+  // decks of the running upload: server file -> hash
+  std::map<QString, QByteArray> mBatchUploads;
+  // storage to delete after jobs of its account
+  struct StaleStorage {
+    QString clientId;
+    QUrl url;
+    // manifest entry removed once the delete succeeded, empty for job folders
+    QString manifestKey;
+  };
+  std::deque<StaleStorage> mStaleStorage;
+  // urls of the deletes sent and not answered yet
+  std::set<QString> mDeletingStorage;
+  void collectStaleStorage();
+  void collectJobFolder(const QString& clientId, const QString& folder);
+  void queueStorageDelete(const StaleStorage& storage);
+  void sendStorageDeletes();
+  void handleStorageDeleteReply(QNetworkReply* reply);
 
   // the split/convert timer to indicate some progress
   std::unique_ptr<QTimer> mSplitAndConvertTimer;
   int mSplitAndConvertTimoutCounter;
 
+  // deadline of the whole conversion
+  int mDeadlineMsecs = 0;
+  std::unique_ptr<QTimer> mDeadlineTimer;
+
   // download information
   QString mTargetPath = ".";
   QStringList mDownloadQueue;
   bool mFullyAutomatic = true;
-  QMutex mDownloadSyncMutex;
+  // files queued in the file writer -> stage that produced them
+  std::map<quint64, PowerPointConverterStatus> mPendingWrites;
+  // files of ended jobs still being written -> remove them once written (cancelled jobs)
+  std::map<quint64, bool> mDiscardedWrites;
+  // the job ended, its pending writes are not credited to the next job
+  void discardPendingWrites(bool removeFiles);
 
   // the output
   QStringList mConvertedFiles;
+
+  // crash recovery: the journal entry of the running job
+  bool mJournalEnabled = true;
+  QString mJobId;
+  void beginJournal(PowerPointConverterStatus flow);
+  void endJournal(PowerPointConverterStatus status);
+  // slides saved before a resume and the download of pending writes
+  std::set<QString> mSavedSlideUrls;
+  std::map<quint64, QString> mPendingSlideUrls;
+  std::deque<JobJournal::Job> mResumeQueue;
+  void resumeJob(const JobJournal::Job& job);
+
+  // jobs queued by convert(), resumed jobs go first
+  struct QueuedJob {
+    QString filepath;
+    QString targetpath;
+    QFutureInterface<SlideResult> slides;
+    QFutureInterface<QStringList> done;
+  };
+  std::deque<std::shared_ptr<QueuedJob>> mQueuedJobs;
+  std::shared_ptr<QueuedJob> mRunningJob;
+  std::unique_ptr<QFutureWatcher<SlideResult>> mRunningJobWatcher;
+  QString mJobError;
+  void startNextQueuedJob();
+  void completeRunningJob(PowerPointConverterStatus status);
 };
@@ -0,0 +1,198 @@
+#include "PptxArchive.h"
+
+#include <QDir>
+#include <QXmlStreamReader>
+#include <QtEndian>
+#include <zlib.h>
+
+namespace {
+  const quint32 kEndOfCentralDirectorySignature = 0x06054b50;
+  const quint32 kCentralDirectorySignature = 0x02014b50;
+  const quint32 kLocalHeaderSignature = 0x04034b50;
+  const int kEndOfCentralDirectorySize = 22;
+  const int kCentralDirectoryHeaderSize = 46;
+  const int kLocalHeaderSize = 30;
+  // no single part of a deck below the 35 MB service limit can be bigger
+  const qint64 kMaxEntrySize = 256 * 1024 * 1024;
+  // first inflate buffer per compressed byte, grown while inflating
+  const qint64 kInitialInflateRatio = 4;
+  const qint64 kMinInflateBuffer = 64 * 1024;
+
+  quint16 read16(const char* p) { return qFromLittleEndian<quint16>(reinterpret_cast<const uchar*>(p)); }
+  quint32 read32(const char* p) { return qFromLittleEndian<quint32>(reinterpret_cast<const uchar*>(p)); }
+}
+
+PptxArchive::PptxArchive(const QByteArray& data)
+  : mData(data)
+{
+  readCentralDirectory();
+}
+
+bool PptxArchive::readCentralDirectory()
+{
+  const char* base = mData.constData();
+  const qint64 size = mData.size();
+  if (size < kEndOfCentralDirectorySize) {
+    mError = "File is too small to be a PPTX";
+    return false;
+  }
+
+  // the end of central directory record is at the end, followed by a comment of max. 64k
+  qint64 eocd = -1;
+  const qint64 searchEnd = qMax<qint64>(0, size - kEndOfCentralDirectorySize - 0xFFFF);
+  for (qint64 pos = size - kEndOfCentralDirectorySize; pos >= searchEnd; --pos) {
+    if (read32(base + pos) == kEndOfCentralDirectorySignature) {
+      eocd = pos;
+      break;
+    }
+  }
+  if (eocd < 0) {
+    mError = "No ZIP end of central directory found";
+    return false;
+  }
+
+  const quint16 entryCount = read16(base + eocd + 10);
+  const quint32 directorySize = read32(base + eocd + 12);
+  const quint32 directoryOffset = read32(base + eocd + 16);
+  if (directoryOffset == 0xFFFFFFFF || entryCount == 0xFFFF) {
+    mError = "ZIP64 archives are not supported";
+    return false;
+  }
+  if (static_cast<qint64>(directoryOffset) + directorySize > eocd) {
+    mError = "Corrupt ZIP central directory";
+    return false;
+  }
+
+  mEntries.reserve(entryCount);
+  qint64 pos = directoryOffset;
+  for (int i = 0; i < entryCount; ++i) {
+    if (pos + kCentralDirectoryHeaderSize > eocd || read32(base + pos) != kCentralDirectorySignature) {
+      mError = QString("Corrupt ZIP central directory entry %1").arg(i);
+      mEntries.clear();
+      mIndex.clear();
+      return false;
+    }
+    const quint16 nameLength = read16(base + pos + 28);
+    const quint16 extraLength = read16(base + pos + 30);
+    const quint16 commentLength = read16(base + pos + 32);
+    // a corrupt or hostile length must not read beyond the directory
+    if (pos + kCentralDirectoryHeaderSize + nameLength + extraLength + commentLength > eocd) {
+      mError = QString("Corrupt ZIP central directory entry %1").arg(i);
+      mEntries.clear();
+      mIndex.clear();
+      return false;
+    }
+
+    Entry entry;
+    entry.method = read16(base + pos + 10);
+    entry.crc32 = read32(base + pos + 16);
+    entry.compressedSize = read32(base + pos + 20);
+    entry.uncompressedSize = read32(base + pos + 24);
+    entry.localHeaderOffset = read32(base + pos + 42);
+    entry.name = QString::fromUtf8(base + pos + kCentralDirectoryHeaderSize, nameLength);
+
+    mIndex.insert(entry.name, mEntries.size());
+    mEntries.push_back(entry);
+    pos += kCentralDirectoryHeaderSize + nameLength + extraLength + commentLength;
+  }
+  return true;
+}
+
+const PptxArchive::Entry* PptxArchive::entry(const QString& name) const
+{
+  auto iter = mIndex.constFind(name);
+  if (iter == mIndex.constEnd()) return nullptr;
+  return &mEntries[iter.value()];
+}
+
+qint64 PptxArchive::dataOffset(const Entry& entry) const
+{
+  // the local header repeats name and extra field, possibly with different lengths
+  const qint64 header = entry.localHeaderOffset;
+  if (header + kLocalHeaderSize > mData.size()) return -1;
+  const char* p = mData.constData() + header;
+  if (read32(p) != kLocalHeaderSignature) return -1;
+  const qint64 offset = header + kLocalHeaderSize + read16(p + 26) + read16(p + 28);
+  if (offset + entry.compressedSize > mData.size()) return -1;
+  return offset;
+}
+
+QByteArray PptxArchive::rawData(const QString& name) const
+{
+  auto* e = entry(name);
+  if (!e) return QByteArray();
+  const qint64 offset = dataOffset(*e);
+  if (offset < 0) return QByteArray();
+  return QByteArray::fromRawData(mData.constData() + offset, static_cast<int>(e->compressedSize));
+}
+
+QByteArray PptxArchive::read(const QString& name) const
+{
+  auto* e = entry(name);
+  if (!e || e->uncompressedSize > kMaxEntrySize) return QByteArray();
+  const qint64 offset = dataOffset(*e);
+  if (offset < 0) return QByteArray();
+
+  if (e->method == 0) {
+    return QByteArray(mData.constData() + offset, static_cast<int>(e->compressedSize));
+  }
+  if (e->method != 8) return QByteArray();
+
+  const qint64 declaredSize = e->uncompressedSize;
+  if (declaredSize == 0) return QByteArray();
+
+  // raw deflate stream without zlib header. The declared size is not trusted
+  // for the allocation: the buffer starts at what the compressed bytes
+  // plausibly inflate to and doubles as the output arrives, up to it
+  QByteArray result(static_cast<int>(qMin(declaredSize, qMax(e->compressedSize * kInitialInflateRatio, kMinInflateBuffer))), Qt::Uninitialized);
+  z_stream stream = {};
+  if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) return QByteArray();
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(mData.constData() + offset));
+  stream.avail_in = static_cast<uInt>(e->compressedSize);
+  stream.next_out = reinterpret_cast<Bytef*>(result.data());
+  stream.avail_out = static_cast<uInt>(result.size());
+  int status = Z_OK;
+  while (status == Z_OK) {
+    if (stream.avail_out == 0) {
+      // more output than declared, corrupt
+      if (result.size() >= declaredSize) break;
+      const int written = static_cast<int>(stream.total_out);
+      result.resize(static_cast<int>(qMin<qint64>(declaredSize, 2 * static_cast<qint64>(result.size()))));
+      stream.next_out = reinterpret_cast<Bytef*>(result.data() + written);
+      stream.avail_out = static_cast<uInt>(result.size() - written);
+    }
+    status = inflate(&stream, Z_NO_FLUSH);
+  }
+  inflateEnd(&stream);
+  if (status != Z_STREAM_END || stream.total_out != static_cast<uLong>(declaredSize)) return QByteArray();
+  return result;
+}
+
+QHash<QString, PptxArchive::Relationship> PptxArchive::relationships(const QString& part) const
+{
+  QHash<QString, Relationship> relationships;
+  QXmlStreamReader xml(read(relsPartFor(part)));
+  while (!xml.atEnd()) {
+    if (xml.readNext() != QXmlStreamReader::StartElement || xml.name() != QLatin1String("Relationship")) continue;
+    auto attributes = xml.attributes();
+    Relationship relationship;
+    relationship.type = attributes.value("Type").toString();
+    relationship.target = attributes.value("Target").toString();
+    relationship.external = attributes.value("TargetMode") == QLatin1String("External");
+    relationships.insert(attributes.value("Id").toString(), relationship);
+  }
+  return relationships;
+}
+
+QString PptxArchive::resolveTarget(const QString& sourcePart, const QString& target)
+{
+  if (target.startsWith('/')) return target.mid(1);
+  const QString sourceFolder = sourcePart.left(sourcePart.lastIndexOf('/') + 1);
+  return QDir::cleanPath(sourceFolder + target);
+}
+
+QString PptxArchive::relsPartFor(const QString& part)
+{
+  const int slash = part.lastIndexOf('/');
+  return part.left(slash + 1) + "_rels/" + part.mid(slash + 1) + ".rels";
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+// Minimal read-only ZIP reader for PPTX packages.
+// Parses only the central directory and inflates single entries on demand.
+// The archive bytes are not copied, so the data must outlive the archive.
+
+class PptxArchive
+{
+public:
+  struct Entry {
+    QString name;
+    quint16 method = 0; // 0 = stored, 8 = deflated
+    quint32 crc32 = 0;
+    qint64 compressedSize = 0;
+    qint64 uncompressedSize = 0;
+    qint64 localHeaderOffset = 0;
+  };
+
+  // one entry of a .rels part
+  struct Relationship {
+    QString type;
+    QString target;
+    bool external = false;
+  };
+
+  explicit PptxArchive(const QByteArray& data);
+
+  bool isValid() const { return mError.isEmpty(); }
+  const QString& errorString() const { return mError; }
+
+  const QVector<Entry>& entries() const { return mEntries; }
+  bool contains(const QString& name) const { return mIndex.contains(name); }
+  const Entry* entry(const QString& name) const;
+
+  // the uncompressed content of an entry, empty if missing or corrupt
+  QByteArray read(const QString& name) const;
+  // the raw (possibly compressed) bytes of an entry without inflating
+  QByteArray rawData(const QString& name) const;
+
+  // id -> relationship of a part, empty if it has no .rels part
+  QHash<QString, Relationship> relationships(const QString& part) const;
+
+  // resolve a relationship target relative to the part that references it
+  static QString resolveTarget(const QString& sourcePart, const QString& target);
+  // the relationship part of a part, e.g. ppt/slides/_rels/slide1.xml.rels
+  static QString relsPartFor(const QString& part);
+
+private:
+  bool readCentralDirectory();
+  qint64 dataOffset(const Entry& entry) const;
+
+  QByteArray mData;
+  QVector<Entry> mEntries;
+  QHash<QString, int> mIndex;
+  QString mError;
+};
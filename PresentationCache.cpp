@@ -0,0 +1,132 @@
+#include "PresentationCache.h"
+#include "Metrics.h"
+#include "ProcessStats.h"
+#include "TiledRenderer.h"
+
+#include <QDateTime>
+#include <QFileInfo>
+#include <algorithm>
+
+namespace {
+  struct CacheMetrics {
+    MetricsRegistry& registry = MetricsRegistry::instance();
+    Counter& hits = registry.counter("pptx_converter_presentation_cache_total", "Opened presentations by cache result", "result=\"hit\"");
+    Counter& misses = registry.counter("pptx_converter_presentation_cache_total", "Opened presentations by cache result", "result=\"miss\"");
+    Gauge& bytes = registry.gauge("pptx_converter_presentation_cache_bytes", "Estimated memory of the cached presentations");
+  };
+
+  CacheMetrics& metrics()
+  {
+    static CacheMetrics sMetrics;
+    return sMetrics;
+  }
+}
+
+PresentationCache& PresentationCache::instance()
+{
+  static PresentationCache sInstance;
+  return sInstance;
+}
+
+PresentationCache::PresentationCache(qint64 budgetBytes, int maxEntries)
+  : mBudgetBytes(budgetBytes)
+  , mMaxEntries(std::max(1, maxEntries))
+{
+}
+
+QString PresentationCache::cacheKey(const QString& filepath)
+{
+  // a changed file has another key, its old entry ages out
+  QFileInfo fileInfo(filepath);
+  const QString canonicalPath = fileInfo.canonicalFilePath().isEmpty() ? fileInfo.absoluteFilePath() : fileInfo.canonicalFilePath();
+  return QString("%1|%2|%3").arg(canonicalPath).arg(fileInfo.size()).arg(fileInfo.lastModified().toMSecsSinceEpoch());
+}
+
+System::SharedPtr<Aspose::Slides::Presentation> PresentationCache::open(const QString& filepath, bool* cached)
+{
+  const QString key = cacheKey(filepath);
+  auto iter = mIndex.find(key);
+  if (iter != mIndex.end()) {
+    // move to the front
+    mEntries.splice(mEntries.begin(), mEntries, iter->second);
+    metrics().hits.increment();
+    if (cached) *cached = true;
+    return mEntries.front().presentation;
+  }
+
+  const qint64 residentBefore = ProcessStats::current().residentBytes;
+  auto presentation = System::MakeObject<Aspose::Slides::Presentation>(System::String(filepath.toStdU16String()));
+  const qint64 residentGrowth = ProcessStats::current().residentBytes - residentBefore;
+
+  Entry entry;
+  entry.key = key;
+  entry.presentation = presentation;
+  entry.bytes = std::max(residentGrowth, QFileInfo(filepath).size());
+  entry.residentBefore = residentBefore;
+  mEntries.push_front(entry);
+  mIndex[key] = mEntries.begin();
+  mUsedBytes += entry.bytes;
+  metrics().misses.increment();
+  evict();
+
+  if (cached) *cached = false;
+  return presentation;
+}
+
+void PresentationCache::updateSize(const QString& filepath)
+{
+  auto iter = mIndex.find(cacheKey(filepath));
+  if (iter == mIndex.end() || iter->second->sized) return;
+  auto& entry = *iter->second;
+  entry.sized = true;
+  // only ever raised, entries evicted meanwhile lowered the resident set
+  const qint64 usedBefore = entryBytes(entry);
+  entry.bytes = std::max(entry.bytes, ProcessStats::current().residentBytes - entry.residentBefore);
+  mUsedBytes += entryBytes(entry) - usedBefore;
+  evict();
+}
+
+std::shared_ptr<TiledRenderer> PresentationCache::tiledRenderer(const QString& filepath)
+{
+  auto iter = mIndex.find(cacheKey(filepath));
+  if (iter == mIndex.end()) {
+    open(filepath);
+    iter = mIndex.find(cacheKey(filepath));
+  }
+  auto& entry = *iter->second;
+  if (!entry.tiledRenderer) {
+    // every thread opens a copy the size of the entry, as many as fit next to it
+    const qint64 room = std::max<qint64>(0, mBudgetBytes - entry.bytes) / std::max<qint64>(1, entry.bytes);
+    const int threads = static_cast<int>(std::max<qint64>(1, std::min<qint64>(room, TiledRenderer::defaultThreadCount())));
+    entry.tiledRenderer = std::make_shared<TiledRenderer>(filepath, threads);
+    mUsedBytes += entryBytes(entry) - entry.bytes;
+    evict();
+  }
+  return entry.tiledRenderer;
+}
+
+qint64 PresentationCache::entryBytes(const Entry& entry)
+{
+  const int copies = entry.tiledRenderer ? entry.tiledRenderer->threadCount() : 0;
+  return entry.bytes * (1 + copies);
+}
+
+void PresentationCache::evict()
+{
+  // the newest entry stays, even if it alone exceeds the budget
+  while (mEntries.size() > 1 && (static_cast<int>(mEntries.size()) > mMaxEntries || mUsedBytes > mBudgetBytes)) {
+    const auto& entry = mEntries.back();
+    mUsedBytes -= entryBytes(entry);
+    mIndex.erase(entry.key);
+    mEntries.pop_back();
+  }
+  metrics().bytes.set(mUsedBytes);
+}
+
+void PresentationCache::clear()
+{
+  mUsedBytes = 0;
+  metrics().bytes.set(0);
+  mIndex.clear();
+  mEntries.clear();
+}
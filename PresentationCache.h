@@ -0,0 +1,67 @@
+#pragma once
+#include <QString>
+#include <list>
+#include <map>
+#include <memory>
+#include <DOM/Presentation.h>
+
+class TiledRenderer;
+
+// Opened Aspose presentations of the local render path, so rendering the
+// same unchanged file again (other sizes, single slides, preview and final
+// pass) skips parsing it. Keyed by canonical path, size and modification
+// time; the least recently used ones are dropped when the entry count or the
+// memory budget is exceeded. The memory of an entry is an approximation:
+// the growth of the resident set while opening it (at least the file size),
+// raised to the growth since opening once its first render pass is done,
+// since Aspose loads images and fonts lazily. Other allocations made
+// meanwhile (frame buffers, the slide store) are counted as well, so the
+// budget errs on the side of evicting early.
+// The TiledRenderer of a deck is kept with its entry, so its per-thread
+// copies are opened once per deck, not per render. Every copy is charged at
+// the size of the entry, and the renderer gets only as many threads as the
+// budget has room for.
+// Not thread-safe, Aspose presentations are used from the GUI thread only.
+
+class PresentationCache
+{
+public:
+  static PresentationCache& instance();
+
+  explicit PresentationCache(qint64 budgetBytes = 1024LL * 1024 * 1024, int maxEntries = 8);
+
+  // the opened presentation, cached tells whether it was reused. Throws like the Presentation constructor
+  System::SharedPtr<Aspose::Slides::Presentation> open(const QString& filepath, bool* cached = nullptr);
+  // the first render pass of the opened file is done: measure its memory again
+  void updateSize(const QString& filepath);
+  // the tiled renderer kept with the file's entry, opening the file if needed.
+  // An evicted renderer lives on until its last render returns
+  std::shared_ptr<TiledRenderer> tiledRenderer(const QString& filepath);
+
+  void clear();
+  int count() const { return static_cast<int>(mEntries.size()); }
+  qint64 usedBytes() const { return mUsedBytes; }
+
+private:
+  struct Entry {
+    QString key;
+    System::SharedPtr<Aspose::Slides::Presentation> presentation;
+    qint64 bytes = 0;
+    std::shared_ptr<TiledRenderer> tiledRenderer;
+    // resident set before opening, until the size was updated after rendering
+    qint64 residentBefore = 0;
+    bool sized = false;
+  };
+
+  static QString cacheKey(const QString& filepath);
+  // the entry with its renderer's copies
+  static qint64 entryBytes(const Entry& entry);
+  void evict();
+
+  qint64 mBudgetBytes;
+  int mMaxEntries;
+  qint64 mUsedBytes = 0;
+  // most recently used first
+  std::list<Entry> mEntries;
+  std::map<QString, std::list<Entry>::iterator> mIndex;
+};
@@ -0,0 +1,160 @@
+#include "PresentationInspector.h"
+#include "PptxArchive.h"
+
+#include <QFile>
+#include <QHash>
+#include <QSet>
+#include <QXmlStreamReader>
+
+namespace {
+  const QString kRelationshipsNamespace = "http://schemas.openxmlformats.org/officeDocument/2006/relationships";
+
+  bool isMediaRelationship(const QString& type)
+  {
+    return type.endsWith("/image") || type.endsWith("/video") || type.endsWith("/audio") || type.endsWith("/media");
+  }
+
+  // collect all typeface attributes, skipping theme placeholders like "+mn-lt"
+  void collectTypefaces(const QByteArray& xmlData, QSet<QString>& fonts)
+  {
+    QXmlStreamReader xml(xmlData);
+    while (!xml.atEnd()) {
+      if (xml.readNext() != QXmlStreamReader::StartElement) continue;
+      auto typeface = xml.attributes().value("typeface");
+      if (typeface.isEmpty() || typeface.startsWith('+')) continue;
+      fonts.insert(typeface.toString());
+    }
+  }
+
+  // the major and minor fonts of a theme: latin, east asian and complex
+  // script. The per-script <a:font script="..."> fallbacks are skipped, every
+  // Office theme lists dozens of them and they render only text in that script
+  void collectThemeFonts(const QByteArray& xmlData, QSet<QString>& fonts)
+  {
+    QXmlStreamReader xml(xmlData);
+    int fontSchemeDepth = 0;
+    while (!xml.atEnd()) {
+      const auto token = xml.readNext();
+      const bool isScheme = xml.name() == QLatin1String("majorFont") || xml.name() == QLatin1String("minorFont");
+      if (token == QXmlStreamReader::EndElement && isScheme) --fontSchemeDepth;
+      if (token != QXmlStreamReader::StartElement) continue;
+      if (isScheme) {
+        ++fontSchemeDepth;
+        continue;
+      }
+      if (fontSchemeDepth == 0) continue;
+      if (xml.name() != QLatin1String("latin") && xml.name() != QLatin1String("ea") && xml.name() != QLatin1String("cs")) continue;
+      auto typeface = xml.attributes().value("typeface");
+      if (typeface.isEmpty() || typeface.startsWith('+')) continue;
+      fonts.insert(typeface.toString());
+    }
+  }
+}
+
+PresentationInfo PresentationInspector::inspect(const QString& filepath)
+{
+  QFile file(filepath);
+  if (!file.open(QIODevice::ReadOnly)) {
+    PresentationInfo info;
+    info.errorMessage = QString("Presentation file '%1' can't be opened").arg(filepath);
+    return info;
+  }
+  // map instead of reading, only the directory and a few parts are touched
+  const qint64 size = file.size();
+  uchar* data = size > 0 ? file.map(0, size) : nullptr;
+  if (!data) return inspect(file.readAll());
+  auto info = inspect(QByteArray::fromRawData(reinterpret_cast<const char*>(data), static_cast<int>(size)));
+  file.unmap(data);
+  return info;
+}
+
+PresentationInfo PresentationInspector::inspect(const QByteArray& data)
+{
+  PresentationInfo info;
+  PptxArchive archive(data);
+  if (!archive.isValid()) {
+    info.errorMessage = archive.errorString();
+    return info;
+  }
+
+  const QString presentationPart = "ppt/presentation.xml";
+  const QByteArray presentationXml = archive.read(presentationPart);
+  if (presentationXml.isEmpty()) {
+    info.errorMessage = "No ppt/presentation.xml found. Not a PPTX file?";
+    return info;
+  }
+  const auto presentationRelationships = archive.relationships(presentationPart);
+
+  // slide order, size and embedded fonts
+  QSet<QString> fonts;
+  QXmlStreamReader xml(presentationXml);
+  bool inEmbeddedFontList = false;
+  while (!xml.atEnd()) {
+    auto token = xml.readNext();
+    if (token == QXmlStreamReader::EndElement && xml.name() == QLatin1String("embeddedFontLst")) {
+      inEmbeddedFontList = false;
+    }
+    if (token != QXmlStreamReader::StartElement) continue;
+
+    auto attributes = xml.attributes();
+    if (xml.name() == QLatin1String("sldId")) {
+      auto relationship = presentationRelationships.value(attributes.value(kRelationshipsNamespace, "id").toString());
+      if (!relationship.target.isEmpty()) {
+        info.slideParts << PptxArchive::resolveTarget(presentationPart, relationship.target);
+      }
+    }
+    else if (xml.name() == QLatin1String("sldSz")) {
+      info.slideWidthEmu = attributes.value("cx").toLongLong();
+      info.slideHeightEmu = attributes.value("cy").toLongLong();
+    }
+    else if (xml.name() == QLatin1String("embeddedFontLst")) {
+      inEmbeddedFontList = true;
+    }
+    else if (inEmbeddedFontList && xml.name() == QLatin1String("font")) {
+      info.embeddedFonts << attributes.value("typeface").toString();
+    }
+  }
+  if (xml.hasError()) {
+    info.errorMessage = QString("Failed to parse presentation.xml: %1").arg(xml.errorString());
+    return info;
+  }
+  info.slideCount = info.slideParts.count();
+
+  // every master has its own theme, the presentation links the first one
+  QSet<QString> themeParts;
+  for (const auto& relationship : presentationRelationships) {
+    if (relationship.external) continue;
+    if (relationship.type.endsWith("/theme")) themeParts.insert(PptxArchive::resolveTarget(presentationPart, relationship.target));
+    if (!relationship.type.endsWith("/slideMaster")) continue;
+    const QString masterPart = PptxArchive::resolveTarget(presentationPart, relationship.target);
+    for (const auto& masterRelationship : archive.relationships(masterPart)) {
+      if (!masterRelationship.external && masterRelationship.type.endsWith("/theme")) {
+        themeParts.insert(PptxArchive::resolveTarget(masterPart, masterRelationship.target));
+      }
+    }
+  }
+  for (const auto& themePart : themeParts) collectThemeFonts(archive.read(themePart), fonts);
+
+  // media weight per slide from the uncompressed sizes in the central directory
+  info.slideMediaBytes.reserve(info.slideCount);
+  for (const auto& slidePart : info.slideParts) {
+    qint64 mediaBytes = 0;
+    QSet<QString> countedMedia;
+    for (const auto& relationship : archive.relationships(slidePart)) {
+      if (relationship.external || !isMediaRelationship(relationship.type)) continue;
+      const QString mediaPart = PptxArchive::resolveTarget(slidePart, relationship.target);
+      if (countedMedia.contains(mediaPart)) continue;
+      countedMedia.insert(mediaPart);
+      if (auto* entry = archive.entry(mediaPart)) mediaBytes += entry->uncompressedSize;
+    }
+    info.slideMediaBytes << mediaBytes;
+    info.totalMediaBytes += mediaBytes;
+    collectTypefaces(archive.read(slidePart), fonts);
+  }
+
+  for (const auto& font : info.embeddedFonts) fonts.insert(font);
+  info.fonts = fonts.values();
+  info.fonts.sort(Qt::CaseInsensitive);
+  info.valid = true;
+  return info;
+}
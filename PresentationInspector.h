@@ -0,0 +1,41 @@
+#pragma once
+#include <QByteArray>
+#include <QSizeF>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// Fast pre-flight inspection of a PPTX file without opening it in Aspose.
+// Only the ZIP central directory and a few small XML parts are read:
+// presentation.xml (+ rels) for slide order/size, the slide rels for media
+// and the theme/slide XML for referenced fonts.
+
+struct PresentationInfo
+{
+  bool valid = false;
+  QString errorMessage;
+
+  int slideCount = 0;
+  // slide size in EMU (English Metric Units, 914400 per inch) and in points
+  qint64 slideWidthEmu = 0;
+  qint64 slideHeightEmu = 0;
+  QSizeF slideSizePoints() const { return QSizeF(slideWidthEmu / 12700.0, slideHeightEmu / 12700.0); }
+
+  // the slide part names in presentation order, e.g. "ppt/slides/slide1.xml"
+  QStringList slideParts;
+  // uncompressed bytes of images/audio/video referenced per slide (same order as slideParts)
+  QVector<qint64> slideMediaBytes;
+  qint64 totalMediaBytes = 0;
+
+  // font families referenced by theme, slides and the embedded font list
+  QStringList fonts;
+  QStringList embeddedFonts;
+};
+
+class PresentationInspector
+{
+public:
+  static PresentationInfo inspect(const QString& filepath);
+  // inspect an in-memory file, e.g. MappedPresentation::data()
+  static PresentationInfo inspect(const QByteArray& data);
+};
@@ -0,0 +1,34 @@
+#include "ProcessStats.h"
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <QDir>
+#include <QFile>
+#include <unistd.h>
+#endif
+
+ProcessStats ProcessStats::current()
+{
+  ProcessStats stats;
+#ifdef Q_OS_WIN
+  PROCESS_MEMORY_COUNTERS counters;
+  if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+    stats.residentBytes = static_cast<qint64>(counters.WorkingSetSize);
+  }
+  DWORD handleCount = 0;
+  if (GetProcessHandleCount(GetCurrentProcess(), &handleCount)) {
+    stats.openHandles = static_cast<int>(handleCount);
+  }
+#else
+  // second value of statm is the resident size in pages
+  QFile statm("/proc/self/statm");
+  if (statm.open(QIODevice::ReadOnly)) {
+    auto values = statm.readAll().split(' ');
+    if (values.size() > 1) stats.residentBytes = values[1].toLongLong() * sysconf(_SC_PAGESIZE);
+  }
+  stats.openHandles = QDir("/proc/self/fd").entryList(QDir::AllEntries | QDir::System | QDir::NoDotAndDotDot).count();
+#endif
+  return stats;
+}
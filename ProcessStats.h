@@ -0,0 +1,14 @@
+#pragma once
+#include <QtGlobal>
+
+// Resource usage of the current process, for soak tests and metrics.
+
+struct ProcessStats
+{
+  // resident set size (working set on Windows) in bytes
+  qint64 residentBytes = 0;
+  // open handles (Windows) or file descriptors (Linux)
+  int openHandles = 0;
+
+  static ProcessStats current();
+};
@@ -0,0 +1,328 @@
+#include "RenderCoordinator.h"
+#include "RenderProtocol.h"
+#include "AsyncFileWriter.h"
+#include "Metrics.h"
+#include "PresentationInspector.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTcpSocket>
+#include <algorithm>
+
+namespace {
+  // slides per range handed out, stealing balances what is left
+  const int kRangeSlides = 4;
+  // a worker not reporting a slide for this long is dropped
+  const qint64 kDefaultSlideTimeoutMsecs = 60 * 1000;
+  // a slide timing out on this many workers fails the job instead of dropping the next one
+  const int kMaxSlideTimeouts = 2;
+  // a job without any worker for this long fails
+  const qint64 kNoWorkersTimeoutMsecs = 60 * 1000;
+  // connections not answering the challenge in time are closed
+  const qint64 kHelloTimeoutMsecs = 10 * 1000;
+
+  struct CoordinatorMetrics {
+    MetricsRegistry& registry = MetricsRegistry::instance();
+    Gauge& workers = registry.gauge("pptx_converter_render_workers", "Connected render workers");
+    Counter& steals = registry.counter("pptx_converter_render_ranges_total", "Slide ranges moved between render workers", "reason=\"steal\"");
+    Counter& reassigned = registry.counter("pptx_converter_render_ranges_total", "Slide ranges moved between render workers", "reason=\"worker_lost\"");
+    Counter& slides = registry.counter("pptx_converter_slides_total", "Converted slides", "path=\"distributed\"");
+  };
+
+  CoordinatorMetrics& metrics()
+  {
+    static CoordinatorMetrics sMetrics;
+    return sMetrics;
+  }
+}
+
+RenderCoordinator::RenderCoordinator(QObject* parent)
+  : QObject(parent)
+  , mSlideTimeoutMsecs(kDefaultSlideTimeoutMsecs)
+{
+  connect(&mServer, &QTcpServer::newConnection, this, &RenderCoordinator::onNewConnection);
+  connect(&mWatchdog, &QTimer::timeout, this, &RenderCoordinator::onWatchdog);
+  mWatchdog.start(5000);
+  mClock.start();
+}
+
+bool RenderCoordinator::listen(const QHostAddress& address, quint16 port)
+{
+  // nobody gets a deck without the secret
+  if (mSecret.isEmpty()) return false;
+  return mServer.listen(address, port);
+}
+
+int RenderCoordinator::workerCount() const
+{
+  // authenticated workers, connections still answering the challenge don't count
+  return static_cast<int>(std::count_if(mWorkers.begin(), mWorkers.end(),
+    [](const std::pair<QTcpSocket* const, Worker>& entry) { return !entry.second.name.isEmpty(); }));
+}
+
+bool RenderCoordinator::render(const QString& filepath, const QString& targetPath, double scale)
+{
+  if (mRunning) {
+    emit error("Distributed rendering already in progress");
+    return false;
+  }
+  // the slide count without opening the deck in Aspose
+  const auto info = PresentationInspector::inspect(filepath);
+  if (!info.valid || info.slideCount == 0) {
+    emit error(QString("Presentation file '%1' is invalid: %2").arg(filepath).arg(info.errorMessage));
+    return false;
+  }
+  QFile file(filepath);
+  if (!file.open(QIODevice::ReadOnly) || !QDir().mkpath(targetPath)) {
+    emit error(QString("Presentation file '%1' or target path '%2' can't be opened").arg(filepath).arg(targetPath));
+    return false;
+  }
+
+  mJob++;
+  mRunning = true;
+  mDeck = file.readAll();
+  mDeckName = QFileInfo(filepath).completeBaseName();
+  mScale = scale;
+  mTargetPath = targetPath;
+  mFiles = QVector<QString>(info.slideCount).toList();
+  mRendered = 0;
+  mSlideTimeouts = QVector<int>(info.slideCount, 0);
+  mNoWorkersSince = -1;
+  mOpenRanges.clear();
+  for (int first = 0; first < info.slideCount; first += kRangeSlides) {
+    mOpenRanges.emplace_back(first, std::min(first + kRangeSlides, info.slideCount) - 1);
+  }
+  emit debug(QString("Rendering %1 slides of '%2' on %3 workers").arg(info.slideCount).arg(mDeckName).arg(workerCount()));
+  emit progress(0.0f);
+  assignIdleWorkers();
+  return true;
+}
+
+void RenderCoordinator::cancel()
+{
+  if (!mRunning) return;
+  mRunning = false;
+  mOpenRanges.clear();
+  // truncating to nothing stops the workers after their current slide
+  for (auto& entry : mWorkers) {
+    auto& worker = entry.second;
+    if (!worker.busy()) continue;
+    RenderProtocol::send(entry.first, QJsonObject{ { "type", "truncate" }, { "job", mJob }, { "task", static_cast<double>(worker.task) }, { "last", -1 } });
+    worker.task = 0;
+  }
+  emit error("Distributed rendering cancelled");
+}
+
+void RenderCoordinator::onNewConnection()
+{
+  while (auto* socket = mServer.nextPendingConnection()) {
+    auto& worker = mWorkers[socket];
+    worker.stream = std::make_unique<QDataStream>(socket);
+    worker.stream->setVersion(RenderProtocol::kStreamVersion);
+    worker.lastSeen = mClock.elapsed();
+    worker.connectedAt = worker.lastSeen;
+    worker.challenge = RenderProtocol::randomToken();
+    connect(socket, &QTcpSocket::readyRead, this, [this, socket]() { onReadyRead(socket); });
+    connect(socket, &QTcpSocket::disconnected, this, [this, socket]() { onDisconnected(socket); });
+    RenderProtocol::send(socket, QJsonObject{ { "type", "challenge" }, { "nonce", QString::fromLatin1(worker.challenge) } });
+  }
+}
+
+void RenderCoordinator::onReadyRead(QTcpSocket* socket)
+{
+  auto iter = mWorkers.find(socket);
+  if (iter == mWorkers.end()) return;
+  auto& worker = iter->second;
+  worker.lastSeen = mClock.elapsed();
+
+  RenderProtocol::Message message;
+  while (mWorkers.count(socket) > 0 && RenderProtocol::receive(*worker.stream, message)) {
+    const auto type = message.type();
+    if (type == "hello") {
+      onHello(socket, message.header);
+    }
+    // nothing else is accepted before the worker authenticated
+    else if (worker.name.isEmpty()) {
+      continue;
+    }
+    else if (type == "frame") {
+      onFrame(socket, message.header, message.payload);
+    }
+    else if (type == "failed") {
+      // Aspose fails the same way on every worker
+      if (message.header["job"].toInt() != mJob || !mRunning) continue;
+      emit error(QString("Slide %1 failed on %2: %3").arg(message.header["slide"].toInt()).arg(worker.name).arg(message.header["error"].toString()));
+      cancel();
+    }
+  }
+}
+
+void RenderCoordinator::onHello(QTcpSocket* socket, const QJsonObject& header)
+{
+  auto& worker = mWorkers[socket];
+  if (!worker.name.isEmpty()) return;
+  const QString name = header["worker"].toString();
+  if (name.isEmpty() || !RenderProtocol::verify(mSecret, "worker", worker.challenge, header["proof"].toString().toLatin1())) {
+    emit debug(QString("Render worker connection from %1 rejected: wrong secret").arg(socket->peerAddress().toString()));
+    socket->abort();
+    return;
+  }
+  worker.name = name;
+  metrics().workers.set(workerCount());
+  // the worker checks this before it renders anything
+  const QByteArray proof = RenderProtocol::proof(mSecret, "coordinator", header["nonce"].toString().toLatin1());
+  RenderProtocol::send(socket, QJsonObject{ { "type", "welcome" }, { "proof", QString::fromLatin1(proof) } });
+  emit debug(QString("Render worker %1 connected").arg(worker.name));
+  if (!worker.busy()) assign(socket);
+}
+
+void RenderCoordinator::onFrame(QTcpSocket* socket, const QJsonObject& header, const QByteArray& png)
+{
+  auto& worker = mWorkers[socket];
+  const int slide = header["slide"].toInt();
+  if (header["job"].toInt() != mJob || !mRunning || slide < 0 || slide >= mFiles.count()) return;
+
+  // a stolen or reassigned slide may arrive twice, the first one counts
+  if (mFiles[slide].isEmpty()) {
+    mFiles[slide] = QDir(mTargetPath).filePath(QString("%1_%2.png").arg(mDeckName).arg(slide));
+    AsyncFileWriter::instance().write(mFiles[slide], png);
+    mRendered++;
+    metrics().slides.increment();
+    emit slideRendered(slide, mFiles[slide]);
+    emit progress(static_cast<float>(mRendered) / mFiles.count());
+  }
+
+  if (static_cast<quint64>(header["task"].toDouble()) == worker.task) {
+    worker.next = slide + 1;
+    if (worker.next > worker.last) {
+      worker.task = 0;
+      assign(socket);
+    }
+  }
+  if (mRendered == mFiles.count()) finish();
+}
+
+void RenderCoordinator::assign(QTcpSocket* socket)
+{
+  auto& worker = mWorkers[socket];
+  if (!mRunning || worker.name.isEmpty()) return;
+
+  std::pair<int, int> range(0, -1);
+  while (!mOpenRanges.empty() && range.second < range.first) {
+    range = mOpenRanges.front();
+    mOpenRanges.pop_front();
+    // skip slides rendered meanwhile by a duplicate
+    while (range.first <= range.second && !mFiles[range.first].isEmpty()) range.first++;
+  }
+  if (range.second < range.first) {
+    // steal the second half of the largest range in progress, its worker renders slide next right now
+    QTcpSocket* victim = nullptr;
+    int largest = 0;
+    for (auto& entry : mWorkers) {
+      const auto& other = entry.second;
+      if (other.busy() && other.last - other.next > largest) {
+        largest = other.last - other.next;
+        victim = entry.first;
+      }
+    }
+    if (!victim) return;
+    auto& other = mWorkers[victim];
+    const int keep = other.next + (other.last - other.next) / 2;
+    range = std::make_pair(keep + 1, other.last);
+    other.last = keep;
+    RenderProtocol::send(victim, QJsonObject{ { "type", "truncate" }, { "job", mJob }, { "task", static_cast<double>(other.task) }, { "last", keep } });
+    metrics().steals.increment();
+    emit debug(QString("%1 takes slides %2-%3 from %4").arg(worker.name).arg(range.first).arg(range.second).arg(other.name));
+  }
+
+  if (worker.deckJob != mJob) {
+    RenderProtocol::send(socket, QJsonObject{ { "type", "deck" }, { "job", mJob }, { "name", mDeckName }, { "scale", mScale } }, mDeck);
+    worker.deckJob = mJob;
+  }
+  worker.task = mNextTask++;
+  worker.next = range.first;
+  worker.last = range.second;
+  worker.lastSeen = mClock.elapsed();
+  RenderProtocol::send(socket, QJsonObject{ { "type", "task" }, { "job", mJob }, { "task", static_cast<double>(worker.task) }, { "first", range.first }, { "last", range.second } });
+}
+
+void RenderCoordinator::assignIdleWorkers()
+{
+  for (auto& entry : mWorkers) {
+    if (!entry.second.busy()) assign(entry.first);
+  }
+}
+
+void RenderCoordinator::requeue(int first, int last)
+{
+  if (!mRunning || first > last) return;
+  // before the other open ranges, the slides of the gallery start are waited for
+  mOpenRanges.emplace_front(first, last);
+  metrics().reassigned.increment();
+}
+
+void RenderCoordinator::onDisconnected(QTcpSocket* socket)
+{
+  auto iter = mWorkers.find(socket);
+  if (iter == mWorkers.end()) return;
+  const auto worker = std::move(iter->second);
+  mWorkers.erase(iter);
+  socket->deleteLater();
+  if (worker.name.isEmpty()) return;
+  metrics().workers.set(workerCount());
+
+  emit debug(QString("Render worker %1 disconnected").arg(worker.name));
+  if (worker.busy()) {
+    requeue(worker.next, worker.last);
+    assignIdleWorkers();
+  }
+}
+
+void RenderCoordinator::onWatchdog()
+{
+  // a job nobody works on, e.g. all local workers failed to start
+  if (mRunning && workerCount() == 0) {
+    if (mNoWorkersSince < 0) mNoWorkersSince = mClock.elapsed();
+    if (mClock.elapsed() - mNoWorkersSince > kNoWorkersTimeoutMsecs) {
+      emit error(QString("No render worker connected for %1 s").arg(kNoWorkersTimeoutMsecs / 1000));
+      cancel();
+      return;
+    }
+  }
+  else {
+    mNoWorkersSince = -1;
+  }
+
+  // hung workers (e.g. a node lost without closing the connection) or slides too slow to render
+  std::vector<QTcpSocket*> lost;
+  for (const auto& entry : mWorkers) {
+    const auto& worker = entry.second;
+    if (worker.busy() && mClock.elapsed() - worker.lastSeen > mSlideTimeoutMsecs) {
+      // the same slide on the next worker would time out the same way
+      if (mRunning && worker.next < mSlideTimeouts.count() && ++mSlideTimeouts[worker.next] >= kMaxSlideTimeouts) {
+        emit error(QString("Slide %1 timed out on %2 workers, the limit is %3 s per slide").arg(worker.next).arg(kMaxSlideTimeouts).arg(mSlideTimeoutMsecs / 1000));
+        cancel();
+        return;
+      }
+      lost.push_back(entry.first);
+    }
+    // and connections never answering the challenge
+    if (entry.second.name.isEmpty() && mClock.elapsed() - entry.second.connectedAt > kHelloTimeoutMsecs) lost.push_back(entry.first);
+  }
+  for (auto* socket : lost) {
+    emit debug(QString("Render worker %1 timed out").arg(mWorkers[socket].name));
+    socket->abort();
+  }
+}
+
+void RenderCoordinator::finish()
+{
+  mRunning = false;
+  mDeck.clear();
+  for (auto& entry : mWorkers) entry.second.task = 0;
+  // the files are complete when finished() is emitted
+  AsyncFileWriter::instance().flush();
+  emit progress(1.0f);
+  emit finished(mFiles);
+}
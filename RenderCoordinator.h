@@ -0,0 +1,108 @@
+#pragma once
+#include <QObject>
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <QHostAddress>
+#include <QJsonObject>
+#include <QStringList>
+#include <QTcpServer>
+#include <QTimer>
+#include <QVector>
+#include <deque>
+#include <map>
+#include <memory>
+
+class QTcpSocket;
+
+// Renders the slides of a presentation on RenderWorker processes of this and
+// other machines (see RenderProtocol). The slides are handed out in small
+// ranges; a worker running idle takes the second half of the largest range
+// still open on another worker (work stealing), and the open slides of a
+// worker that disconnects or stops responding go to the others. Slides
+// rendered twice by a stolen or reassigned range are written once.
+// Workers must prove they know the shared secret before they get a deck.
+// A worker renders a slide without reporting in between, so a slide taking
+// longer than the slide timeout drops its worker; a slide that times out on
+// several workers, or a job left without workers, fails the job.
+
+class RenderCoordinator : public QObject
+{
+  Q_OBJECT
+
+public:
+  explicit RenderCoordinator(QObject* parent = nullptr);
+
+  // workers authenticate with this secret, required before listen()
+  void setSecret(const QByteArray& secret) { mSecret = secret; }
+  // longest time a worker may spend on one slide, raise it for high scales
+  void setSlideTimeout(qint64 msecs) { mSlideTimeoutMsecs = msecs; }
+  // listen for workers, only local ones unless another address is given
+  bool listen(const QHostAddress& address, quint16 port);
+  QHostAddress address() const { return mServer.serverAddress(); }
+  quint16 port() const { return mServer.serverPort(); }
+  int workerCount() const;
+
+  // render all slides into targetPath as <name>_<index>.png, one job at a time
+  bool render(const QString& filepath, const QString& targetPath, double scale);
+  void cancel();
+
+signals:
+  void slideRendered(int index, const QString& file);
+  void progress(float value);
+  void finished(const QStringList& files);
+  void error(const QString& message);
+  void debug(const QString& message);
+
+private slots:
+  void onNewConnection();
+  void onWatchdog();
+
+private:
+  struct Worker {
+    // empty until the worker answered the challenge
+    QString name;
+    QByteArray challenge;
+    qint64 connectedAt = 0;
+    std::unique_ptr<QDataStream> stream;
+    int deckJob = -1;
+    // the assigned range, next is the first slide not received yet
+    quint64 task = 0;
+    int next = 0;
+    int last = -1;
+    qint64 lastSeen = 0;
+    bool busy() const { return task != 0; }
+  };
+
+  void onReadyRead(QTcpSocket* socket);
+  void onHello(QTcpSocket* socket, const QJsonObject& header);
+  void onDisconnected(QTcpSocket* socket);
+  void onFrame(QTcpSocket* socket, const QJsonObject& header, const QByteArray& png);
+  void assign(QTcpSocket* socket);
+  void assignIdleWorkers();
+  // the slides of the range not rendered yet go back to the open ranges
+  void requeue(int first, int last);
+  void finish();
+
+  QTcpServer mServer;
+  QByteArray mSecret;
+  qint64 mSlideTimeoutMsecs;
+  std::map<QTcpSocket*, Worker> mWorkers;
+  QTimer mWatchdog;
+  QElapsedTimer mClock;
+  quint64 mNextTask = 1;
+
+  // the running job
+  int mJob = 0;
+  bool mRunning = false;
+  QString mDeckName;
+  QByteArray mDeck;
+  double mScale = 1.0;
+  QString mTargetPath;
+  std::deque<std::pair<int, int>> mOpenRanges;
+  // output file per slide, empty until rendered
+  QStringList mFiles;
+  int mRendered = 0;
+  // timeouts per slide, and since when the job has no worker (-1: it has)
+  QVector<int> mSlideTimeouts;
+  qint64 mNoWorkersSince = -1;
+};
@@ -0,0 +1,50 @@
+#include "RenderProtocol.h"
+
+#include <QJsonDocument>
+#include <QMessageAuthenticationCode>
+#include <QRandomGenerator>
+
+void RenderProtocol::send(QIODevice* device, const QJsonObject& header, const QByteArray& payload)
+{
+  QDataStream stream(device);
+  stream.setVersion(kStreamVersion);
+  stream << QJsonDocument(header).toJson(QJsonDocument::Compact) << payload;
+}
+
+bool RenderProtocol::receive(QDataStream& stream, Message& message)
+{
+  // partial messages are rolled back and read again with more data
+  stream.startTransaction();
+  QByteArray header;
+  stream >> header >> message.payload;
+  if (!stream.commitTransaction()) return false;
+  message.header = QJsonDocument::fromJson(header).object();
+  return true;
+}
+
+QByteArray RenderProtocol::secret()
+{
+  return qgetenv(kSecretVariable);
+}
+
+QByteArray RenderProtocol::randomToken()
+{
+  quint32 words[4];
+  QRandomGenerator::system()->fillRange(words);
+  return QByteArray(reinterpret_cast<const char*>(words), sizeof(words)).toHex();
+}
+
+QByteArray RenderProtocol::proof(const QByteArray& secret, const QByteArray& role, const QByteArray& nonce)
+{
+  return QMessageAuthenticationCode::hash(role + '\n' + nonce, secret, QCryptographicHash::Sha256).toHex();
+}
+
+bool RenderProtocol::verify(const QByteArray& secret, const QByteArray& role, const QByteArray& nonce, const QByteArray& proof)
+{
+  if (secret.isEmpty() || nonce.isEmpty()) return false;
+  const QByteArray expected = RenderProtocol::proof(secret, role, nonce);
+  if (expected.size() != proof.size()) return false;
+  char difference = 0;
+  for (int i = 0; i < expected.size(); ++i) difference |= expected[i] ^ proof[i];
+  return difference == 0;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <QByteArray>
+#include <QDataStream>
+#include <QJsonObject>
+
+// Messages between the RenderCoordinator and its RenderWorker processes over
+// TCP. A message is a JSON header and an optional binary payload, written as
+// two QDataStream byte arrays:
+//   coordinator -> worker
+//     challenge {nonce}                       after accepting the connection
+//   worker -> coordinator
+//     hello     {worker, proof, nonce}        answers the challenge
+//     frame     {job, task, slide} + PNG      one rendered slide
+//     failed    {job, task, slide, error}     the slide can't be rendered
+//   coordinator -> worker
+//     welcome   {proof}                       answers the worker's nonce
+//     deck      {job, name, scale} + PPTX     before the first task of a job
+//     task      {job, task, first, last}      render these slides, in order
+//     truncate  {job, task, last}             stop the task after last (work stealing)
+//
+// Both sides prove they know the shared secret (PPTX_CONVERTER_RENDER_SECRET)
+// with an HMAC of the other side's nonce before any deck is sent or rendered;
+// the secret itself never goes over the wire.
+
+namespace RenderProtocol
+{
+  const quint16 kDefaultPort = 47800;
+  const QDataStream::Version kStreamVersion = QDataStream::Qt_5_15;
+  const char* const kSecretVariable = "PPTX_CONVERTER_RENDER_SECRET";
+
+  struct Message {
+    QJsonObject header;
+    QByteArray payload;
+    QString type() const { return header["type"].toString(); }
+  };
+
+  void send(QIODevice* device, const QJsonObject& header, const QByteArray& payload = QByteArray());
+  // the next complete message of the stream, false until one arrived completely
+  bool receive(QDataStream& stream, Message& message);
+
+  // the shared secret from the environment, empty if not set
+  QByteArray secret();
+  // random hex string for challenges and generated secrets
+  QByteArray randomToken();
+  // HMAC-SHA256 (hex) of role ("worker" or "coordinator") and the peer's nonce,
+  // the role keeps a proof from being reflected back to its sender
+  QByteArray proof(const QByteArray& secret, const QByteArray& role, const QByteArray& nonce);
+  // compares in constant time
+  bool verify(const QByteArray& secret, const QByteArray& role, const QByteArray& nonce, const QByteArray& proof);
+}
@@ -0,0 +1,76 @@
+#include "RenderQueue.h"
+
+#include <QMutexLocker>
+#include <algorithm>
+
+RenderQueue::RenderQueue(int slideCount)
+{
+  reset(slideCount);
+}
+
+void RenderQueue::reset(int slideCount)
+{
+  QMutexLocker locker(&mMutex);
+  mDone.assign(std::max(0, slideCount), false);
+  mRequests.clear();
+  mVisibleFirst = 0;
+  mVisibleLast = -1;
+  mRemaining = static_cast<int>(mDone.size());
+}
+
+void RenderQueue::setVisibleRange(int first, int last)
+{
+  QMutexLocker locker(&mMutex);
+  mVisibleFirst = first;
+  mVisibleLast = last;
+}
+
+void RenderQueue::request(int slide)
+{
+  QMutexLocker locker(&mMutex);
+  if (slide < 0 || slide >= static_cast<int>(mDone.size()) || mDone[slide]) return;
+  mRequests.push_back(slide);
+}
+
+int RenderQueue::takeLocked(int slide)
+{
+  mDone[slide] = true;
+  mRemaining--;
+  return slide;
+}
+
+int RenderQueue::takeNext()
+{
+  QMutexLocker locker(&mMutex);
+  const int count = static_cast<int>(mDone.size());
+  if (mRemaining == 0) return -1;
+
+  // the slide asked for last is the one somebody waits for
+  while (!mRequests.empty()) {
+    const int slide = mRequests.back();
+    mRequests.pop_back();
+    if (!mDone[slide]) return takeLocked(slide);
+  }
+
+  const int first = std::max(0, mVisibleFirst);
+  const int last = std::min(count - 1, mVisibleLast);
+  for (int slide = first; slide <= last; ++slide) {
+    if (!mDone[slide]) return takeLocked(slide);
+  }
+
+  // the user most likely scrolls on, then back
+  const int after = last >= first ? last + 1 : 0;
+  for (int slide = after; slide < count; ++slide) {
+    if (!mDone[slide]) return takeLocked(slide);
+  }
+  for (int slide = std::min(after, count) - 1; slide >= 0; --slide) {
+    if (!mDone[slide]) return takeLocked(slide);
+  }
+  return -1;
+}
+
+int RenderQueue::remaining() const
+{
+  QMutexLocker locker(&mMutex);
+  return mRemaining;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <QMutex>
+#include <vector>
+
+// Order in which the local engine renders the slides of a presentation:
+// slides requested explicitly first (latest request first), then the ones
+// visible in the gallery, then the ones following the visible range, then
+// the rest nearest first. Priorities may change while rendering, requests
+// may come from any thread.
+//
+// The local engine takes all slides, visible or not, one at a time from one
+// loop on the GUI thread; there is no background pool. The parallel part of
+// the local render is the TiledRenderer, which cuts frames beyond 4K into
+// bands on its own threads and presentation copies, budgeted by the
+// PresentationCache.
+
+class RenderQueue
+{
+public:
+  explicit RenderQueue(int slideCount = 0);
+
+  // start over with all slides pending
+  void reset(int slideCount);
+  // the slides shown in the viewport (last < first: none)
+  void setVisibleRange(int first, int last);
+  // render this slide next
+  void request(int slide);
+
+  // the next slide to render (it is marked as done), -1 when all are done
+  int takeNext();
+  int remaining() const;
+
+private:
+  int takeLocked(int slide);
+
+  mutable QMutex mMutex;
+  std::vector<bool> mDone;
+  std::vector<int> mRequests;
+  int mVisibleFirst = 0;
+  int mVisibleLast = -1;
+  int mRemaining = 0;
+};
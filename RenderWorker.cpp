@@ -0,0 +1,215 @@
+#include "RenderWorker.h"
+#include "RenderProtocol.h"
+#include "PresentationCache.h"
+#include "FrameBufferPool.h"
+#include "SlideFingerprint.h"
+#include "SlideImageStore.h"
+#include "ConsoleLog.h"
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QFile>
+#include <QHostInfo>
+#include <algorithm>
+
+#include <DOM/Presentation.h>
+#include <DOM/ISlideCollection.h>
+#include <DOM/ISlide.h>
+#include <DOM/ISlidesize.h>
+#include <Export/RenderingOptions.h>
+#include <drawing/bitmap.h>
+#include <drawing/color.h>
+#include <drawing/graphics.h>
+#include <drawing/imaging/image_format.h>
+#include <system/io/memory_stream.h>
+#include <system/exceptions.h>
+
+namespace {
+  const int kReconnectMsecs = 2000;
+  // received decks kept on disk for the next jobs, the least recently used beyond it are removed
+  const qint64 kMaxDeckBytes = 512LL * 1024 * 1024;
+}
+
+RenderWorker::RenderWorker(QObject* parent)
+  : QObject(parent)
+  , mName(QString("%1:%2").arg(QHostInfo::localHostName()).arg(QCoreApplication::applicationPid()))
+{
+  connect(&mSocket, &QTcpSocket::connected, this, &RenderWorker::onConnected);
+  connect(&mSocket, &QTcpSocket::disconnected, this, &RenderWorker::onDisconnected);
+  connect(&mSocket, &QTcpSocket::readyRead, this, &RenderWorker::onReadyRead);
+  connect(&mSocket, &QTcpSocket::errorOccurred, this, [this](QAbstractSocket::SocketError) {
+    if (mSocket.state() == QAbstractSocket::UnconnectedState) mReconnectTimer.start();
+  });
+  mReconnectTimer.setSingleShot(true);
+  mReconnectTimer.setInterval(kReconnectMsecs);
+  connect(&mReconnectTimer, &QTimer::timeout, this, [this]() { mSocket.connectToHost(mHost, mPort); });
+}
+
+void RenderWorker::start(const QString& host, quint16 port, const QByteArray& secret)
+{
+  mHost = host;
+  mPort = port;
+  mSecret = secret;
+  mSocket.connectToHost(mHost, mPort);
+}
+
+void RenderWorker::onConnected()
+{
+  ConsoleLog::timedLine(QString("Render worker %1 connected to %2:%3").arg(mName).arg(mHost).arg(mPort));
+  mStream = std::make_unique<QDataStream>(&mSocket);
+  mStream->setVersion(RenderProtocol::kStreamVersion);
+  // hello answers the coordinator's challenge
+  mAuthenticated = false;
+}
+
+void RenderWorker::onDisconnected()
+{
+  // the coordinator hands the open ranges to other workers
+  mTasks.clear();
+  mJob = -1;
+  mAuthenticated = false;
+  mStream.reset();
+  mReconnectTimer.start();
+}
+
+void RenderWorker::onReadyRead()
+{
+  if (!mStream) return;
+  RenderProtocol::Message message;
+  while (RenderProtocol::receive(*mStream, message)) {
+    const auto type = message.type();
+    if (type == "challenge") {
+      mNonce = RenderProtocol::randomToken();
+      const QByteArray proof = RenderProtocol::proof(mSecret, "worker", message.header["nonce"].toString().toLatin1());
+      RenderProtocol::send(&mSocket, QJsonObject{ { "type", "hello" }, { "worker", mName },
+        { "proof", QString::fromLatin1(proof) }, { "nonce", QString::fromLatin1(mNonce) } });
+    }
+    else if (type == "welcome") {
+      mAuthenticated = RenderProtocol::verify(mSecret, "coordinator", mNonce, message.header["proof"].toString().toLatin1());
+      if (!mAuthenticated) {
+        ConsoleLog::timedLine(QString("Render worker %1: %2:%3 does not know the secret, disconnecting").arg(mName).arg(mHost).arg(mPort));
+        mSocket.abort();
+        return;
+      }
+    }
+    // nothing is rendered for a coordinator that did not authenticate
+    else if (!mAuthenticated) {
+      continue;
+    }
+    else if (type == "deck") {
+      storeDeck(message.header, message.payload);
+    }
+    else if (type == "task") {
+      Task task;
+      task.id = static_cast<quint64>(message.header["task"].toDouble());
+      task.next = message.header["first"].toInt();
+      task.last = message.header["last"].toInt();
+      if (message.header["job"].toInt() == mJob) mTasks << task;
+    }
+    else if (type == "truncate") {
+      const auto id = static_cast<quint64>(message.header["task"].toDouble());
+      for (auto& task : mTasks) {
+        if (task.id == id) task.last = qMin(task.last, message.header["last"].toInt());
+      }
+    }
+  }
+  if (!mTasks.isEmpty() && !mRenderScheduled) {
+    mRenderScheduled = true;
+    QTimer::singleShot(0, this, &RenderWorker::renderNext);
+  }
+}
+
+void RenderWorker::storeDeck(const QJsonObject& header, const QByteArray& data)
+{
+  mTasks.clear();
+  mJob = header["job"].toInt();
+  mDeckName = header["name"].toString();
+  mScale = header["scale"].toDouble(1.0);
+  // named by content, PresentationCache keeps it open for the next jobs of the same deck
+  const auto hash = QCryptographicHash::hash(data, QCryptographicHash::Sha256).toHex();
+  mDeckPath = mDeckFolder.filePath(QString::fromLatin1(hash) + ".pptx");
+  auto deck = std::find_if(mDecks.begin(), mDecks.end(), [this](const std::pair<QString, qint64>& stored) { return stored.first == mDeckPath; });
+  if (deck != mDecks.end()) {
+    mDecks.splice(mDecks.begin(), mDecks, deck);
+  }
+  else {
+    QFile file(mDeckPath);
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size()) {
+      ConsoleLog::timedLine(QString("Render worker can't write %1").arg(mDeckPath));
+    }
+    mDecks.emplace_front(mDeckPath, data.size());
+    mDeckBytes += data.size();
+  }
+  // the current deck stays, whatever its size
+  while (mDeckBytes > kMaxDeckBytes && mDecks.size() > 1) {
+    QFile::remove(mDecks.back().first);
+    mDeckBytes -= mDecks.back().second;
+    mDecks.pop_back();
+  }
+  mFingerprints = SlideFingerprint::compute(mDeckPath);
+}
+
+QByteArray RenderWorker::renderSlide(int index, QString& errorMessage)
+{
+  // renders of identical slides in any deck are shared with the local engine
+  const QString spec = SlideImageStore::localPngSpec(mScale);
+  const QByteArray fingerprint = mFingerprints.value(index);
+  QByteArray png = SlideImageStore::instance().find(fingerprint, spec);
+  if (!png.isEmpty()) return png;
+
+  try {
+    auto presentation = PresentationCache::instance().open(mDeckPath);
+    auto slides = presentation->get_Slides();
+    if (index < 0 || index >= slides->get_Count()) {
+      errorMessage = QString("Slide %1 does not exist").arg(index);
+      return QByteArray();
+    }
+    // drawn like the local engine does, the renders share their slide store spec
+    const auto size = presentation->get_SlideSize()->get_Size();
+    auto bitmap = System::MakeObject<System::Drawing::Bitmap>(qRound(size.get_Width() * mScale), qRound(size.get_Height() * mScale),
+      System::Drawing::Imaging::PixelFormat::Format32bppArgb);
+    auto graphics = System::Drawing::Graphics::FromImage(bitmap);
+    graphics->Clear(System::Drawing::Color::get_White());
+    slides->idx_get(index)->RenderToGraphics(System::MakeObject<Aspose::Slides::Export::RenderingOptions>(), graphics, static_cast<float>(mScale), static_cast<float>(mScale));
+    graphics->Flush();
+    auto pngStream = System::MakeObject<System::IO::MemoryStream>();
+    bitmap->Save(pngStream.dynamic_pointer_cast<System::IO::Stream>(), System::Drawing::Imaging::ImageFormat::get_Png());
+    png = FrameBufferPool::instance().bytes(pngStream);
+  }
+  catch (const System::Exception& exception) {
+    errorMessage = QString::fromStdU16String(exception->get_Message().ToU16Str());
+    return QByteArray();
+  }
+  SlideImageStore::instance().store(fingerprint, spec, png);
+  return png;
+}
+
+void RenderWorker::renderNext()
+{
+  mRenderScheduled = false;
+  while (!mTasks.isEmpty() && mTasks.first().next > mTasks.first().last) mTasks.removeFirst();
+  if (mTasks.isEmpty() || !mStream) return;
+
+  auto& task = mTasks.first();
+  const int slide = task.next++;
+  QJsonObject header{ { "job", mJob }, { "task", static_cast<double>(task.id) }, { "slide", slide } };
+  QString errorMessage;
+  QByteArray png = renderSlide(slide, errorMessage);
+  // the first finished task loaded what the deck needs, the cache sizes it again
+  if (task.next > task.last) PresentationCache::instance().updateSize(mDeckPath);
+  if (png.isEmpty()) {
+    header["type"] = "failed";
+    header["error"] = errorMessage;
+    RenderProtocol::send(&mSocket, header);
+  }
+  else {
+    header["type"] = "frame";
+    RenderProtocol::send(&mSocket, header, png);
+    // the socket buffered its own copy
+    FrameBufferPool::instance().recycle(std::move(png));
+  }
+
+  // truncations arriving meanwhile are read before the next slide
+  mRenderScheduled = true;
+  QTimer::singleShot(0, this, &RenderWorker::renderNext);
+}
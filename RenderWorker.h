@@ -0,0 +1,70 @@
+#pragma once
+#include <QObject>
+#include <QDataStream>
+#include <QTcpSocket>
+#include <QTemporaryDir>
+#include <QTimer>
+#include <QVector>
+#include <list>
+#include <memory>
+
+// A process rendering slides with the local Aspose engine for a
+// RenderCoordinator: connects (and reconnects) to it, receives the deck and
+// slide ranges and streams every rendered slide back as PNG. One slide is
+// rendered per event loop turn, so the coordinator can shorten the running
+// range to hand its tail to an idle worker.
+// Decks and ranges are only accepted from a coordinator that proved it knows
+// the shared secret.
+
+class RenderWorker : public QObject
+{
+  Q_OBJECT
+
+public:
+  explicit RenderWorker(QObject* parent = nullptr);
+
+  // connect to the coordinator, reconnecting whenever the connection is lost
+  void start(const QString& host, quint16 port, const QByteArray& secret);
+
+private slots:
+  void onConnected();
+  void onDisconnected();
+  void onReadyRead();
+  void renderNext();
+
+private:
+  struct Task {
+    quint64 id = 0;
+    int next = 0;
+    int last = -1;
+  };
+
+  void storeDeck(const QJsonObject& header, const QByteArray& data);
+  QByteArray renderSlide(int index, QString& errorMessage);
+
+  QString mHost;
+  quint16 mPort = 0;
+  QTcpSocket mSocket;
+  std::unique_ptr<QDataStream> mStream;
+  QTimer mReconnectTimer;
+  QString mName;
+  QByteArray mSecret;
+  // our challenge to the coordinator, answered by its welcome
+  QByteArray mNonce;
+  bool mAuthenticated = false;
+
+  // the deck of the current job, written to a temporary file for Aspose
+  QTemporaryDir mDeckFolder;
+  // decks in the folder and their size, most recently used first
+  std::list<std::pair<QString, qint64>> mDecks;
+  qint64 mDeckBytes = 0;
+  int mJob = -1;
+  QString mDeckPath;
+  QString mDeckName;
+  double mScale = 1.0;
+  QVector<QByteArray> mFingerprints;
+
+  // ranges in the order received, the first one is rendered
+  QVector<Task> mTasks;
+  bool mRenderScheduled = false;
+};
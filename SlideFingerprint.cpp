@@ -0,0 +1,151 @@
+#include "SlideFingerprint.h"
+#include "PptxArchive.h"
+#include "PresentationInspector.h"
+
+#include <QCryptographicHash>
+#include <QFile>
+#include <QHash>
+#include <QRegularExpression>
+#include <QSet>
+#include <algorithm>
+
+namespace {
+  // not rendered on the slide: notes, comments, links to other slides
+  bool isIgnoredRelationship(const QString& type)
+  {
+    return type.endsWith("/notesSlide") || type.endsWith("/comments") || type.endsWith("/slide");
+  }
+
+  class PartHasher
+  {
+  public:
+    // hash of a part and its dependencies, and the fields rendered from them
+    struct Result {
+      QByteArray hash;
+      // in the part or its dependencies
+      bool slideNumber = false;
+      // in the part itself: every master has date placeholders, they are only
+      // rendered by a placeholder on the slide that carries its own field
+      bool dateTime = false;
+    };
+
+    explicit PartHasher(const PptxArchive& archive) : mArchive(archive) {}
+
+    Result hash(const QString& part)
+    {
+      auto cached = mHashes.constFind(part);
+      if (cached != mHashes.constEnd()) return *cached;
+      // only reached for broken packages, the dependencies followed form no cycles
+      if (mVisiting.contains(part)) return Result{ part.toUtf8() };
+      mVisiting.insert(part);
+
+      Result result;
+      QCryptographicHash hash(QCryptographicHash::Sha256);
+      const QByteArray content = mArchive.read(part);
+      hash.addData(content);
+      // fields render per position or per day, not from the part bytes
+      if (part.endsWith(".xml")) {
+        result.slideNumber = content.contains("type=\"slidenum\"");
+        result.dateTime = content.contains("type=\"datetime");
+      }
+      const auto relationships = mArchive.relationships(part);
+      // the ids are referenced from the XML, hash them in a stable order
+      auto ids = relationships.keys();
+      std::sort(ids.begin(), ids.end());
+      const bool isMaster = part.contains("/slideMasters/");
+      for (const auto& id : ids) {
+        const auto& relationship = relationships[id];
+        if (isIgnoredRelationship(relationship.type)) continue;
+        // the master lists all its layouts, a slide renders from one of them
+        if (isMaster && relationship.type.endsWith("/slideLayout")) continue;
+        hash.addData(id.toUtf8() + '\n' + relationship.type.toUtf8() + '\n');
+        if (relationship.external) {
+          hash.addData(relationship.target.toUtf8());
+        }
+        else {
+          const Result dependency = this->hash(PptxArchive::resolveTarget(part, relationship.target));
+          hash.addData(dependency.hash);
+          result.slideNumber |= dependency.slideNumber;
+        }
+        hash.addData("\n", 1);
+      }
+
+      mVisiting.remove(part);
+      result.hash = hash.result();
+      mHashes.insert(part, result);
+      return result;
+    }
+
+  private:
+    const PptxArchive& mArchive;
+    QHash<QString, Result> mHashes;
+    QSet<QString> mVisiting;
+  };
+
+  // the raw bytes of the first element with this local name, e.g. <p:defaultTextStyle>...</p:defaultTextStyle>
+  QByteArray elementBytes(const QByteArray& xml, const QByteArray& name)
+  {
+    const int start = xml.indexOf(":" + name + ">");
+    if (start < 0) return QByteArray();
+    const int end = xml.indexOf(":" + name + ">", start + name.size() + 2);
+    return end < 0 ? QByteArray() : xml.mid(start, end - start);
+  }
+}
+
+QVector<QByteArray> SlideFingerprint::compute(const QString& filepath)
+{
+  QFile file(filepath);
+  if (!file.open(QIODevice::ReadOnly)) return {};
+  const qint64 size = file.size();
+  uchar* mapped = size > 0 ? file.map(0, size) : nullptr;
+  const QByteArray data = mapped ? QByteArray::fromRawData(reinterpret_cast<const char*>(mapped), static_cast<int>(size)) : file.readAll();
+  const auto info = PresentationInspector::inspect(data);
+  const auto fingerprints = info.valid ? compute(data, info.slideParts) : QVector<QByteArray>();
+  if (mapped) file.unmap(mapped);
+  return fingerprints;
+}
+
+QVector<QByteArray> SlideFingerprint::compute(const QByteArray& data, const QStringList& slideParts)
+{
+  PptxArchive archive(data);
+  if (!archive.isValid()) return {};
+  PartHasher hasher(archive);
+
+  // deck settings every slide renders with, the slide list itself is left out
+  const QString presentationPart = "ppt/presentation.xml";
+  const QByteArray presentationXml = archive.read(presentationPart);
+  QCryptographicHash deckHash(QCryptographicHash::Sha256);
+  const int slideSize = presentationXml.indexOf("sldSz ");
+  if (slideSize >= 0) deckHash.addData(presentationXml.mid(slideSize, presentationXml.indexOf('>', slideSize) - slideSize));
+  deckHash.addData(elementBytes(presentationXml, "defaultTextStyle"));
+  const auto relationships = archive.relationships(presentationPart);
+  auto ids = relationships.keys();
+  std::sort(ids.begin(), ids.end());
+  for (const auto& id : ids) {
+    const auto& relationship = relationships[id];
+    if (relationship.external || !relationship.type.endsWith("/font")) continue;
+    deckHash.addData(hasher.hash(PptxArchive::resolveTarget(presentationPart, relationship.target)).hash);
+  }
+  const QByteArray deck = deckHash.result();
+  // slide numbers start at 1 unless the deck says otherwise
+  const auto firstSlideNumber = QRegularExpression("firstSlideNum=\"(\\d+)\"").match(QString::fromUtf8(presentationXml));
+  const QByteArray firstSlide = firstSlideNumber.hasMatch() ? firstSlideNumber.captured(1).toLatin1() : QByteArray("1");
+
+  QVector<QByteArray> fingerprints;
+  fingerprints.reserve(slideParts.count());
+  for (int i = 0; i < slideParts.count(); ++i) {
+    const auto slide = hasher.hash(slideParts[i]);
+    // the date is today's, a stored render would show a stale one
+    if (slide.dateTime) {
+      fingerprints << QByteArray();
+      continue;
+    }
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    hash.addData(deck);
+    hash.addData(slide.hash);
+    // the same slide shows another number at another position
+    if (slide.slideNumber) hash.addData(firstSlide + '/' + QByteArray::number(i));
+    fingerprints << hash.result().toHex();
+  }
+  return fingerprints;
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// Content fingerprint of every slide of a PPTX package: SHA-256 over the
+// slide XML and, recursively, everything it renders from (layout, master,
+// theme, media, charts, diagrams), plus the deck settings that apply to all
+// slides (slide size, default text style, embedded fonts). Part names and
+// relationship targets are not hashed, so the same template slide copied
+// into another deck has the same fingerprint.
+// Slides showing a slide number field (in the slide, its layout or master)
+// also hash their position and the deck's first slide number. Slides with
+// auto-updating date fields get no fingerprint, their renders are never
+// shared.
+
+class SlideFingerprint
+{
+public:
+  // hex SHA-256 per slide in presentation order (an empty one for slides that
+  // must not be stored), no entries if the file is no valid PPTX
+  static QVector<QByteArray> compute(const QString& filepath);
+  // slideParts as found by PresentationInspector
+  static QVector<QByteArray> compute(const QByteArray& data, const QStringList& slideParts);
+};
@@ -0,0 +1,207 @@
+#include "SlideImageStore.h"
+#include "Metrics.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <algorithm>
+#include <vector>
+
+namespace {
+  // renders waiting for the disk at most, more are not stored
+  const qint64 kMaxQueuedBytes = 64 * 1024 * 1024;
+  // the modification time is the last use, refreshed at this granularity
+  const qint64 kTouchIntervalSecs = 60 * 60;
+
+  struct StoreMetrics {
+    MetricsRegistry& registry = MetricsRegistry::instance();
+    Counter& hits = registry.counter("pptx_converter_slide_store_total", "Slide renders looked up in the slide store", "result=\"hit\"");
+    Counter& misses = registry.counter("pptx_converter_slide_store_total", "Slide renders looked up in the slide store", "result=\"miss\"");
+    Gauge& bytes = registry.gauge("pptx_converter_slide_store_bytes", "Size of the slide store");
+  };
+
+  StoreMetrics& metrics()
+  {
+    static StoreMetrics sMetrics;
+    return sMetrics;
+  }
+
+  qint64 folderSize(const QString& folder)
+  {
+    qint64 size = 0;
+    QDirIterator iter(folder, QDir::Files, QDirIterator::Subdirectories);
+    while (iter.hasNext()) {
+      iter.next();
+      size += iter.fileInfo().size();
+    }
+    return size;
+  }
+}
+
+SlideImageStore& SlideImageStore::instance()
+{
+  static SlideImageStore sInstance;
+  return sInstance;
+}
+
+SlideImageStore::SlideImageStore(const QString& folder, qint64 budgetBytes)
+  : mFolder(folder)
+  , mBudgetBytes(budgetBytes)
+{
+  if (mFolder.isEmpty()) {
+    mFolder = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/slide_store";
+  }
+  mThread = std::thread(&SlideImageStore::run, this);
+}
+
+SlideImageStore::~SlideImageStore()
+{
+  {
+    QMutexLocker locker(&mMutex);
+    mStopping = true;
+    mQueueChanged.wakeAll();
+  }
+  mThread.join();
+}
+
+QString SlideImageStore::localPngSpec(double scale)
+{
+  return QString("local-png-v2-%1").arg(scale, 0, 'f', 2);
+}
+
+QString SlideImageStore::pathFor(const QByteArray& fingerprint, const QString& spec) const
+{
+  // spread over 256 folders, the store holds many small files
+  return QString("%1/%2/%3_%4").arg(mFolder).arg(QString::fromLatin1(fingerprint.left(2))).arg(QString::fromLatin1(fingerprint)).arg(spec);
+}
+
+bool SlideImageStore::contains(const QByteArray& fingerprint, const QString& spec) const
+{
+  if (fingerprint.isEmpty()) return false;
+  const QString path = pathFor(fingerprint, spec);
+  {
+    QMutexLocker locker(&mMutex);
+    if (mQueuedData.count(path) > 0) return true;
+  }
+  return QFileInfo(path).size() > 0;
+}
+
+QByteArray SlideImageStore::find(const QByteArray& fingerprint, const QString& spec)
+{
+  if (fingerprint.isEmpty()) return QByteArray();
+  const QString path = pathFor(fingerprint, spec);
+  {
+    QMutexLocker locker(&mMutex);
+    auto queued = mQueuedData.find(path);
+    if (queued != mQueuedData.end()) {
+      metrics().hits.increment();
+      return queued->second;
+    }
+  }
+  // files are replaced atomically, reading needs no lock
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly)) {
+    metrics().misses.increment();
+    return QByteArray();
+  }
+  const QByteArray data = file.readAll();
+  if (data.isEmpty()) {
+    metrics().misses.increment();
+    return data;
+  }
+  metrics().hits.increment();
+  // pruning removes the least recently used files, the store thread marks the use
+  if (file.fileTime(QFileDevice::FileModificationTime).secsTo(QDateTime::currentDateTimeUtc()) > kTouchIntervalSecs) {
+    QMutexLocker locker(&mMutex);
+    mQueue.push_back({ path, QByteArray() });
+    mQueueChanged.wakeAll();
+  }
+  return data;
+}
+
+void SlideImageStore::store(const QByteArray& fingerprint, const QString& spec, const QByteArray& data)
+{
+  if (fingerprint.isEmpty() || data.isEmpty()) return;
+  const QString path = pathFor(fingerprint, spec);
+  QMutexLocker locker(&mMutex);
+  // a store is an optimization, the caller never waits for the disk
+  if (mQueuedBytes + data.size() > kMaxQueuedBytes || mQueuedData.count(path) > 0) return;
+  mQueue.push_back({ path, data });
+  mQueuedData[path] = data;
+  mQueuedBytes += data.size();
+  mQueueChanged.wakeAll();
+}
+
+void SlideImageStore::run()
+{
+  // sized once, then kept up to date by the writes and pruning
+  mUsedBytes = folderSize(mFolder);
+  metrics().bytes.set(mUsedBytes);
+  while (true) {
+    Job job;
+    {
+      QMutexLocker locker(&mMutex);
+      while (mQueue.empty() && !mStopping) {
+        mQueueChanged.wait(&mMutex);
+      }
+      if (mQueue.empty()) return;
+      job = mQueue.front();
+      mQueue.pop_front();
+    }
+
+    writeFile(job);
+
+    if (!job.data.isEmpty()) {
+      // on disk now, found there
+      QMutexLocker locker(&mMutex);
+      mQueuedData.erase(job.path);
+      mQueuedBytes -= job.data.size();
+    }
+  }
+}
+
+void SlideImageStore::writeFile(const Job& job)
+{
+  if (job.data.isEmpty()) {
+    QFile file(job.path);
+    if (file.open(QIODevice::ReadWrite | QIODevice::ExistingOnly)) {
+      file.setFileTime(QDateTime::currentDateTimeUtc(), QFileDevice::FileModificationTime);
+    }
+    return;
+  }
+
+  QDir().mkpath(QFileInfo(job.path).absolutePath());
+  const qint64 previousSize = QFileInfo(job.path).size();
+  // never a partial file for concurrent readers and other processes
+  QSaveFile file(job.path);
+  if (!file.open(QIODevice::WriteOnly) || file.write(job.data) != job.data.size() || !file.commit()) return;
+  mUsedBytes += job.data.size() - previousSize;
+
+  if (mUsedBytes > mBudgetBytes) prune();
+  metrics().bytes.set(mUsedBytes);
+}
+
+void SlideImageStore::prune()
+{
+  std::vector<QFileInfo> files;
+  QDirIterator iter(mFolder, QDir::Files, QDirIterator::Subdirectories);
+  while (iter.hasNext()) {
+    iter.next();
+    files.push_back(iter.fileInfo());
+  }
+  std::sort(files.begin(), files.end(), [](const QFileInfo& a, const QFileInfo& b) {
+    return a.lastModified() < b.lastModified();
+  });
+
+  mUsedBytes = 0;
+  for (const auto& file : files) mUsedBytes += file.size();
+  for (const auto& file : files) {
+    if (mUsedBytes <= mBudgetBytes * 9 / 10) break;
+    if (QFile::remove(file.absoluteFilePath())) mUsedBytes -= file.size();
+  }
+}
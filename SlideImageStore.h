@@ -0,0 +1,64 @@
+#pragma once
+#include <QByteArray>
+#include <QMutex>
+#include <QString>
+#include <QWaitCondition>
+#include <deque>
+#include <map>
+#include <thread>
+
+// Rendered slides shared by all decks: one file per slide fingerprint (see
+// SlideFingerprint) and render spec, e.g. "local-png-v2-2.00" or "cloud-api.aspose.cloud-png-1920x1080",
+// in slide_store/ of the application data folder. A slide used in many decks
+// is rendered once. The least recently used files are removed when the store
+// grows beyond its budget. Thread-safe, used by the local engine and the
+// converter thread. Files are written, touched and pruned on the store's own
+// thread, which also sizes the folder once at startup: store() only queues
+// the data, and stored data is found before it is on disk.
+
+class SlideImageStore
+{
+public:
+  // the shared store of the process
+  static SlideImageStore& instance();
+  // spec of the PNGs the local engine and the render workers draw with
+  // RenderToGraphics at scale (v2: older GetThumbnail renders are not reused)
+  static QString localPngSpec(double scale);
+
+  // defaults to slide_store/ in the application data folder
+  explicit SlideImageStore(const QString& folder = QString(), qint64 budgetBytes = 2048LL * 1024 * 1024);
+  // the queued files are written first
+  ~SlideImageStore();
+
+  bool contains(const QByteArray& fingerprint, const QString& spec) const;
+  // the stored render, empty if there is none
+  QByteArray find(const QByteArray& fingerprint, const QString& spec);
+  // queued for the store thread, dropped if too much is waiting already
+  void store(const QByteArray& fingerprint, const QString& spec, const QByteArray& data);
+
+private:
+  struct Job {
+    QString path;
+    // empty: touch the file instead
+    QByteArray data;
+  };
+
+  QString pathFor(const QByteArray& fingerprint, const QString& spec) const;
+  void run();
+  void writeFile(const Job& job);
+  // remove the oldest files until 90% of the budget are used
+  void prune();
+
+  mutable QMutex mMutex;
+  QWaitCondition mQueueChanged;
+  QString mFolder;
+  qint64 mBudgetBytes;
+  std::deque<Job> mQueue;
+  // data of the queued files by path, found before they are written
+  std::map<QString, QByteArray> mQueuedData;
+  qint64 mQueuedBytes = 0;
+  bool mStopping = false;
+  // size of all files, store thread only
+  qint64 mUsedBytes = 0;
+  std::thread mThread;
+};
@@ -0,0 +1,144 @@
+#include "SoakTest.h"
+#include "ConsoleLog.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QTimer>
+
+namespace {
+  // samples taken every kSampleInterval conversions, the first ones are warm-up
+  const int kSampleInterval = 50;
+  const int kWarmupSamples = 2;
+  // allowed growth between the end of the warm-up and the end of the run
+  const qint64 kAllowedMemoryGrowthBytes = 16 * 1024 * 1024;
+  const int kAllowedHandleGrowth = 16;
+}
+
+SoakTest::SoakTest(const QString& presentationFile, int iterations, QObject* parent)
+  : QObject(parent)
+  , mPresentationFile(presentationFile)
+  , mIterations(iterations)
+{
+  connect(&mConverter, &PowerPointConverter::processingDone, this, &SoakTest::onConverterDone);
+  connect(&mConverter, &PowerPointConverter::error, this, &SoakTest::onConverterError);
+  // the mock jobs must not end up in the user's journal, storage manifest or
+  // flow costs, and the mock's placeholder slides not in the slide store (it
+  // would also skip the downloads)
+  mConverter.setJournalEnabled(false);
+  mConverter.setSlideStoreEnabled(false);
+  mConverter.setFlowCostSamplesEnabled(false);
+  mConverter.setStorageManifestPath(mTargetDir.filePath("storage_manifest.json"));
+  // the local fonts would be uploaded to the mock in every run
+  mConverter.setFontSyncEnabled(false);
+
+  // the mock takes any credential, the production limits would only throttle the run
+  auto credentials = std::make_shared<CredentialPool>();
+  CredentialPool::Credential credential;
+  credential.clientId = "soak";
+  credential.clientSecret = "soak";
+  credential.requestsPerSecond = 1e6;
+  credential.burst = 1000000;
+  credentials->addAccount(credential);
+  mConverter.setCredentialPool(credentials);
+}
+
+void SoakTest::start()
+{
+  if (!mServer.start()) {
+    ConsoleLog::line("Soak: mock server can't listen");
+    emit finished(false);
+    return;
+  }
+  mConverter.setServiceUrl(mServer.url());
+  ConsoleLog::line(QString("Soak: %1 conversions of '%2' against %3").arg(mIterations).arg(mPresentationFile).arg(mServer.url().toString()));
+  mTimer.start();
+  runNextIteration();
+}
+
+void SoakTest::runNextIteration()
+{
+  if (mCurrentIteration > 0 && mCurrentIteration % kSampleInterval == 0) takeSample();
+  if (mCurrentIteration >= mIterations) {
+    evaluate();
+    return;
+  }
+
+  mCurrentIteration++;
+  mIterationDone = false;
+  // alternate both cloud flows
+  if (mCurrentIteration % 2 == 0) {
+    mConverter.convertPowerpointFile(mPresentationFile, mTargetDir.path());
+  }
+  else {
+    mConverter.convertPowerpointFile2(mPresentationFile, mTargetDir.path());
+  }
+}
+
+void SoakTest::onConverterDone(const QStringList& createdFiles)
+{
+  for (const auto& file : createdFiles) {
+    QFile::remove(file);
+  }
+  if (mIterationDone) return;
+  mIterationDone = true;
+  // leave the converter's slot before starting the next job
+  QTimer::singleShot(0, this, &SoakTest::runNextIteration);
+}
+
+void SoakTest::onConverterError(const QString& error)
+{
+  // a failure may report several errors, count the iteration once
+  if (mIterationDone) return;
+  mIterationDone = true;
+  mFailures++;
+  ConsoleLog::line(QString("Soak: iteration %1 failed: %2").arg(mCurrentIteration).arg(error));
+  QTimer::singleShot(0, this, &SoakTest::runNextIteration);
+}
+
+void SoakTest::takeSample()
+{
+  // deferred deletes must have run, otherwise replies of the last job are counted
+  QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
+
+  Sample sample;
+  sample.iteration = mCurrentIteration;
+  sample.stats = ProcessStats::current();
+  sample.liveReplies = PowerPointConverter::liveReplyCount();
+  mSamples.push_back(sample);
+  ConsoleLog::line(QString("Soak: %1/%2 conversions, %3 ms, RSS %4 KB, live replies %5, handles %6, failures %7")
+    .arg(mCurrentIteration).arg(mIterations).arg(mTimer.elapsed())
+    .arg(sample.stats.residentBytes / 1024).arg(sample.liveReplies).arg(sample.stats.openHandles).arg(mFailures));
+}
+
+void SoakTest::evaluate()
+{
+  bool success = true;
+  if (mFailures > 0) {
+    ConsoleLog::line(QString("Soak: %1 conversions failed").arg(mFailures));
+    success = false;
+  }
+
+  if (mSamples.size() <= kWarmupSamples) {
+    ConsoleLog::line("Soak: not enough samples to detect growth, increase the iterations");
+  }
+  else {
+    const auto& baseline = mSamples[kWarmupSamples - 1];
+    const auto& last = mSamples.last();
+    if (last.stats.residentBytes > baseline.stats.residentBytes + kAllowedMemoryGrowthBytes) {
+      ConsoleLog::line(QString("Soak: RSS grew from %1 KB to %2 KB").arg(baseline.stats.residentBytes / 1024).arg(last.stats.residentBytes / 1024));
+      success = false;
+    }
+    if (last.stats.openHandles > baseline.stats.openHandles + kAllowedHandleGrowth) {
+      ConsoleLog::line(QString("Soak: open handles grew from %1 to %2").arg(baseline.stats.openHandles).arg(last.stats.openHandles));
+      success = false;
+    }
+  }
+  // between jobs nothing may be in flight
+  if (!mSamples.isEmpty() && mSamples.last().liveReplies > 0) {
+    ConsoleLog::line(QString("Soak: %1 replies still alive after the last conversion").arg(mSamples.last().liveReplies));
+    success = false;
+  }
+
+  ConsoleLog::line(QString("Soak: %1 after %2 conversions and %3 mock requests").arg(success ? "PASSED" : "FAILED").arg(mCurrentIteration).arg(mServer.requestCount()));
+  emit finished(success);
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <QObject>
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+#include <QVector>
+#include "PowerPointConverter.h"
+#include "MockAsposeServer.h"
+#include "ProcessStats.h"
+
+// Long-running soak mode: runs many conversions against a local mock of the
+// cloud service and samples memory, live replies and open handles.
+// Fails if they keep growing after the warm-up.
+
+class SoakTest : public QObject
+{
+  Q_OBJECT
+
+public:
+  SoakTest(const QString& presentationFile, int iterations, QObject* parent = nullptr);
+
+  // starts the first conversion, finished() is emitted at the end
+  void start();
+
+signals:
+  void finished(bool success);
+
+private slots:
+  void onConverterDone(const QStringList& createdFiles);
+  void onConverterError(const QString& error);
+
+private:
+  struct Sample {
+    int iteration = 0;
+    ProcessStats stats;
+    int liveReplies = 0;
+  };
+
+  void runNextIteration();
+  void takeSample();
+  void evaluate();
+
+  QString mPresentationFile;
+  int mIterations;
+  int mCurrentIteration = 0;
+  int mFailures = 0;
+  bool mIterationDone = false;
+
+  MockAsposeServer mServer;
+  PowerPointConverter mConverter;
+  QTemporaryDir mTargetDir;
+  QElapsedTimer mTimer;
+  QVector<Sample> mSamples;
+};
@@ -0,0 +1,183 @@
+#include "StorageManifest.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLockFile>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+namespace {
+  // other converters hold the lock for one read and write of the manifest
+  const int kLockTimeoutMsecs = 10000;
+}
+
+StorageManifest::StorageManifest(const QString& manifestPath)
+  : mManifestPath(manifestPath)
+{
+  if (mManifestPath.isEmpty()) {
+    mManifestPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/storage_manifest.json";
+  }
+}
+
+bool StorageManifest::load()
+{
+  mLoaded = true;
+  mUploaded.clear();
+  mHashCache.clear();
+  mRemoved.clear();
+
+  QString path = mManifestPath;
+  if (!QFileInfo::exists(path)) {
+    // written by older versions for the fonts only
+    path = QFileInfo(mManifestPath).absolutePath() + "/font_manifest.json";
+  }
+  QLockFile lock(mManifestPath + ".lock");
+  if (!lock.tryLock(kLockTimeoutMsecs)) return false;
+  return read(path, mUploaded, mHashCache);
+}
+
+bool StorageManifest::read(const QString& path, QHash<QString, Upload>& uploaded, QHash<QString, CachedHash>& hashes)
+{
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly)) return false;
+  auto object = QJsonDocument::fromJson(file.readAll()).object();
+
+  auto uploadedObject = object["uploaded"].toObject();
+  for (auto iter = uploadedObject.begin(); iter != uploadedObject.end(); ++iter) {
+    Upload upload;
+    if (iter.value().isString()) {
+      // older format: the hash only
+      upload.hash = iter.value().toString().toLatin1();
+    }
+    else {
+      auto entry = iter.value().toObject();
+      upload.hash = entry["sha256"].toString().toLatin1();
+      upload.used = static_cast<qint64>(entry["used"].toDouble());
+    }
+    uploaded.insert(iter.key(), upload);
+  }
+  auto hashesObject = object["hashes"].toObject();
+  for (auto iter = hashesObject.begin(); iter != hashesObject.end(); ++iter) {
+    auto entry = iter.value().toObject();
+    CachedHash cached;
+    cached.size = static_cast<qint64>(entry["size"].toDouble());
+    cached.modified = static_cast<qint64>(entry["modified"].toDouble());
+    cached.hash = entry["sha256"].toString().toLatin1();
+    hashes.insert(iter.key(), cached);
+  }
+  return true;
+}
+
+bool StorageManifest::save()
+{
+  QDir().mkpath(QFileInfo(mManifestPath).absolutePath());
+  QLockFile lock(mManifestPath + ".lock");
+  if (!lock.tryLock(kLockTimeoutMsecs)) return false;
+
+  // merge what other converters saved since the load, the later use wins
+  QHash<QString, Upload> saved;
+  QHash<QString, CachedHash> savedHashes;
+  read(mManifestPath, saved, savedHashes);
+  for (auto iter = saved.constBegin(); iter != saved.constEnd(); ++iter) {
+    auto removed = mRemoved.constFind(iter.key());
+    if (removed != mRemoved.constEnd() && iter.value().used <= removed.value()) continue;
+    auto own = mUploaded.find(iter.key());
+    if (own == mUploaded.end()) mUploaded.insert(iter.key(), iter.value());
+    else if (own->used < iter.value().used) *own = iter.value();
+  }
+  for (auto iter = savedHashes.constBegin(); iter != savedHashes.constEnd(); ++iter) {
+    if (!mHashCache.contains(iter.key())) mHashCache.insert(iter.key(), iter.value());
+  }
+  mRemoved.clear();
+
+  QJsonObject uploaded;
+  for (auto iter = mUploaded.begin(); iter != mUploaded.end(); ++iter) {
+    QJsonObject entry;
+    entry["sha256"] = QString::fromLatin1(iter.value().hash);
+    entry["used"] = static_cast<double>(iter.value().used);
+    uploaded[iter.key()] = entry;
+  }
+  QJsonObject hashes;
+  for (auto iter = mHashCache.begin(); iter != mHashCache.end(); ++iter) {
+    QJsonObject entry;
+    entry["size"] = static_cast<double>(iter.value().size);
+    entry["modified"] = static_cast<double>(iter.value().modified);
+    entry["sha256"] = QString::fromLatin1(iter.value().hash);
+    hashes[iter.key()] = entry;
+  }
+  QJsonObject object;
+  object["uploaded"] = uploaded;
+  object["hashes"] = hashes;
+
+  QSaveFile file(mManifestPath);
+  if (!file.open(QIODevice::WriteOnly)) return false;
+  file.write(QJsonDocument(object).toJson());
+  return file.commit();
+}
+
+QByteArray StorageManifest::hashOfFile(const QString& filepath)
+{
+  if (!mLoaded) load();
+  QFileInfo fileInfo(filepath);
+  const qint64 modified = fileInfo.lastModified().toMSecsSinceEpoch();
+  auto iter = mHashCache.constFind(filepath);
+  if (iter != mHashCache.constEnd() && iter->size == fileInfo.size() && iter->modified == modified) {
+    return iter->hash;
+  }
+
+  QFile file(filepath);
+  if (!file.open(QIODevice::ReadOnly)) return QByteArray();
+  QCryptographicHash hash(QCryptographicHash::Sha256);
+  if (!hash.addData(&file)) return QByteArray();
+
+  CachedHash cached;
+  cached.size = fileInfo.size();
+  cached.modified = modified;
+  cached.hash = hash.result().toHex();
+  mHashCache.insert(filepath, cached);
+  return cached.hash;
+}
+
+bool StorageManifest::isUploaded(const QString& serverName, const QByteArray& hash) const
+{
+  auto iter = mUploaded.constFind(serverName);
+  return iter != mUploaded.constEnd() && iter.value().hash == hash;
+}
+
+void StorageManifest::setUploaded(const QString& serverName, const QByteArray& hash)
+{
+  if (!mLoaded) load();
+  Upload upload;
+  upload.hash = hash;
+  upload.used = QDateTime::currentMSecsSinceEpoch();
+  mUploaded.insert(serverName, upload);
+}
+
+void StorageManifest::touch(const QString& serverName)
+{
+  if (!mLoaded) load();
+  auto iter = mUploaded.find(serverName);
+  if (iter != mUploaded.end()) iter->used = QDateTime::currentMSecsSinceEpoch();
+}
+
+void StorageManifest::remove(const QString& serverName)
+{
+  if (!mLoaded) load();
+  mUploaded.remove(serverName);
+  mRemoved.insert(serverName, QDateTime::currentMSecsSinceEpoch());
+}
+
+QStringList StorageManifest::unusedSince(const QString& prefix, qint64 maxAgeMsecs) const
+{
+  const qint64 limit = QDateTime::currentMSecsSinceEpoch() - maxAgeMsecs;
+  QStringList names;
+  for (auto iter = mUploaded.constBegin(); iter != mUploaded.constEnd(); ++iter) {
+    if (iter.key().startsWith(prefix) && iter.value().used < limit) names << iter.key();
+  }
+  return names;
+}
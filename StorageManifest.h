@@ -0,0 +1,56 @@
+#pragma once
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+// Local record of the files present in cloud storage: the fonts folder and
+// the uploaded presentations. Stores the SHA-256 and the last use of every
+// uploaded file and caches the hashes of local files (by size and
+// modification time) so unchanged files are not re-hashed.
+// Several converters (and processes) share the file: save() holds a lock
+// file, re-reads the manifest and merges it with the own changes, so uploads
+// recorded by others meanwhile are kept.
+
+class StorageManifest
+{
+public:
+  // defaults to storage_manifest.json in the application data folder
+  explicit StorageManifest(const QString& manifestPath = QString());
+
+  bool load();
+  bool save();
+
+  // SHA-256 (hex) of a local file, cached
+  QByteArray hashOfFile(const QString& filepath);
+
+  // true if the server file name is known to exist in the cloud with this hash
+  bool isUploaded(const QString& serverName, const QByteArray& hash) const;
+  void setUploaded(const QString& serverName, const QByteArray& hash);
+  // the file was used again, it is not stale
+  void touch(const QString& serverName);
+  void remove(const QString& serverName);
+  // uploaded files with this prefix not used for maxAgeMsecs
+  QStringList unusedSince(const QString& prefix, qint64 maxAgeMsecs) const;
+
+private:
+  struct CachedHash {
+    qint64 size = 0;
+    qint64 modified = 0;
+    QByteArray hash;
+  };
+
+  struct Upload {
+    QByteArray hash;
+    qint64 used = 0;
+  };
+
+  static bool read(const QString& path, QHash<QString, Upload>& uploaded, QHash<QString, CachedHash>& hashes);
+
+  QString mManifestPath;
+  bool mLoaded = false;
+  QHash<QString, Upload> mUploaded;
+  QHash<QString, CachedHash> mHashCache;
+  // server name -> time removed, not restored from other writers' older entries
+  QHash<QString, qint64> mRemoved;
+};
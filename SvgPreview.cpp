@@ -0,0 +1,123 @@
+#include "SvgPreview.h"
+#include "FrameBufferPool.h"
+
+#include <QPainter>
+#include <QSvgRenderer>
+#include <QThread>
+#include <algorithm>
+#include <climits>
+
+namespace {
+  QString cacheKey(int index, const QSize& size)
+  {
+    return QString("%1/%2x%3").arg(index).arg(size.width()).arg(size.height());
+  }
+
+  // the slide centered on white, aspect ratio kept like ImageKernels::letterbox
+  QImage renderSvg(const QByteArray& svg, const QSize& size)
+  {
+    QSvgRenderer renderer(svg);
+    if (!renderer.isValid()) return QImage();
+
+    QImage image = FrameBufferPool::instance().image(size.width(), size.height(), QImage::Format_ARGB32_Premultiplied);
+    if (image.isNull()) return image;
+    image.fill(Qt::white);
+    QSizeF slideSize = renderer.viewBoxF().size();
+    if (slideSize.isEmpty()) slideSize = renderer.defaultSize();
+    slideSize.scale(size, Qt::KeepAspectRatio);
+    const QRectF target((size.width() - slideSize.width()) / 2, (size.height() - slideSize.height()) / 2,
+      slideSize.width(), slideSize.height());
+
+    QPainter painter(&image);
+    painter.setRenderHints(QPainter::Antialiasing | QPainter::SmoothPixmapTransform | QPainter::TextAntialiasing);
+    renderer.render(&painter, target);
+    return image;
+  }
+}
+
+SvgPreview::SvgPreview(qint64 cacheBytes, QObject* parent)
+  : QObject(parent)
+{
+  mCache.setMaxCost(static_cast<int>(std::min<qint64>(cacheBytes / 1024, INT_MAX)));
+  // leave a core for the Aspose render loop
+  mPool.setMaxThreadCount(std::max(1, QThread::idealThreadCount() - 1));
+}
+
+SvgPreview::~SvgPreview()
+{
+  // the tasks reference this object until they posted their result
+  mPool.clear();
+  mPool.waitForDone();
+}
+
+void SvgPreview::clear()
+{
+  mPool.clear();
+  mSlides.clear();
+  mSlideGenerations.clear();
+  mCache.clear();
+  mPending.clear();
+  mGeneration++;
+}
+
+void SvgPreview::setSlide(int index, const QByteArray& svg)
+{
+  if (index < 0) return;
+  if (index >= mSlides.count()) {
+    mSlides.resize(index + 1);
+    mSlideGenerations.resize(index + 1);
+  }
+  mSlides[index] = svg;
+  mSlideGenerations[index] = ++mGeneration;
+  // a replaced slide must not be shown from the cache, and is rendered again
+  // even while renders of the previous SVG are in flight
+  const QString prefix = QString("%1/").arg(index);
+  for (const auto& key : mCache.keys()) {
+    if (key.startsWith(prefix)) mCache.remove(key);
+  }
+  for (auto iter = mPending.begin(); iter != mPending.end();) {
+    if (iter->startsWith(prefix)) iter = mPending.erase(iter);
+    else ++iter;
+  }
+}
+
+void SvgPreview::render(int index, const QSize& size)
+{
+  if (index < 0 || index >= mSlides.count() || mSlides[index].isEmpty() || size.isEmpty()) return;
+
+  const QString key = cacheKey(index, size);
+  if (auto* image = mCache.object(key)) {
+    emit previewReady(index, *image);
+    return;
+  }
+  if (mPending.contains(key)) return;
+  mPending.insert(key);
+
+  const QByteArray svg = mSlides[index];
+  const quint64 generation = mSlideGenerations[index];
+  mPool.start([this, svg, size, index, generation]() {
+    QImage image = renderSvg(svg, size);
+    QMetaObject::invokeMethod(this, [this, generation, index, size, image]() {
+      onRendered(generation, index, size, image);
+    }, Qt::QueuedConnection);
+  });
+}
+
+void SvgPreview::renderAll(const QSize& size)
+{
+  for (int index = 0; index < mSlides.count(); ++index) {
+    render(index, size);
+  }
+}
+
+void SvgPreview::onRendered(quint64 generation, int index, const QSize& size, const QImage& image)
+{
+  // the slide was replaced or cleared meanwhile
+  if (index >= mSlideGenerations.count() || mSlideGenerations[index] != generation) return;
+  const QString key = cacheKey(index, size);
+  mPending.remove(key);
+  if (image.isNull()) return;
+
+  mCache.insert(key, new QImage(image), std::max(1, static_cast<int>(image.sizeInBytes() / 1024)));
+  emit previewReady(index, image);
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <QObject>
+#include <QByteArray>
+#include <QCache>
+#include <QImage>
+#include <QSet>
+#include <QSize>
+#include <QThreadPool>
+#include <QVector>
+
+// Gallery previews of the local engine rendered from the slides' SVG, kept
+// in memory. A new thumbnail size renders the vectors again with QSvgRenderer
+// instead of rasterizing the slide with Aspose, so only the final output pays
+// for bitmap renders. Rendering runs on a private thread pool; the images are
+// cached per slide and size, finished ones are reported by previewReady()
+// in the owner's thread.
+// QSvgRenderer implements SVG Tiny 1.2, effects beyond it (filters, masks)
+// are dropped from the preview.
+
+class SvgPreview : public QObject
+{
+  Q_OBJECT
+
+public:
+  explicit SvgPreview(qint64 cacheBytes = 256 * 1024 * 1024, QObject* parent = nullptr);
+  ~SvgPreview();
+
+  // forget all slides, renders still running are ignored
+  void clear();
+  // renders of the slide's previous SVG still running are ignored
+  void setSlide(int index, const QByteArray& svg);
+  int count() const { return mSlides.count(); }
+
+  // preview of the slide letterboxed into size, from the cache or rendered in the background
+  void render(int index, const QSize& size);
+  void renderAll(const QSize& size);
+
+signals:
+  void previewReady(int index, const QImage& image);
+
+private:
+  void onRendered(quint64 generation, int index, const QSize& size, const QImage& image);
+
+  QVector<QByteArray> mSlides;
+  // generation every slide was set in, renders of an older one are dropped
+  QVector<quint64> mSlideGenerations;
+  QCache<QString, QImage> mCache;
+  // renders in flight of the current slides, by cache key
+  QSet<QString> mPending;
+  // raised by every setSlide() and clear()
+  quint64 mGeneration = 0;
+  QThreadPool mPool;
+};
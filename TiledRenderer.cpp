@@ -0,0 +1,186 @@
+#include "TiledRenderer.h"
+#include "PngStreamWriter.h"
+#include "PresentationInspector.h"
+
+#include <QMutexLocker>
+#include <QThread>
+#include <QtGlobal>
+#include <algorithm>
+
+#include <DOM/Presentation.h>
+#include <DOM/ISlideCollection.h>
+#include <DOM/ISlide.h>
+#include <Export/RenderingOptions.h>
+#include <drawing/bitmap.h>
+#include <drawing/color.h>
+#include <drawing/graphics.h>
+#include <drawing/rectangle.h>
+#include <drawing/imaging/bitmap_data.h>
+#include <system/exceptions.h>
+
+namespace {
+  // every render thread holds its own copy of the presentation
+  const int kMaxDefaultThreads = 4;
+  const char* kThreadsVariable = "PPTX_CONVERTER_TILE_THREADS";
+}
+
+int TiledRenderer::defaultThreadCount()
+{
+  const int threads = qEnvironmentVariableIntValue(kThreadsVariable);
+  return threads > 0 ? threads : std::max(1, std::min(QThread::idealThreadCount(), kMaxDefaultThreads));
+}
+
+TiledRenderer::TiledRenderer(const QString& filepath, int threads, int bandHeight)
+  : mFilepath(filepath)
+  , mBandHeight(std::max(16, bandHeight))
+{
+  const auto info = PresentationInspector::inspect(filepath);
+  mSlideWidth = info.slideSizePoints().width();
+  mSlideHeight = info.slideSizePoints().height();
+
+  const int threadCount = threads > 0 ? threads : defaultThreadCount();
+  mBuffers.resize(threadCount + 1);
+  mPending.assign(threadCount + 1, 0);
+  for (int i = 0; i < threadCount; ++i) {
+    mThreads.emplace_back(&TiledRenderer::run, this);
+  }
+}
+
+TiledRenderer::~TiledRenderer()
+{
+  {
+    QMutexLocker locker(&mMutex);
+    mStopping = true;
+    mBands.clear();
+    mWorkQueued.wakeAll();
+  }
+  for (auto& thread : mThreads) thread.join();
+}
+
+void TiledRenderer::run()
+{
+  System::SharedPtr<Aspose::Slides::Presentation> presentation;
+  auto options = System::MakeObject<Aspose::Slides::Export::RenderingOptions>();
+  System::SharedPtr<System::Drawing::Bitmap> bitmap;
+
+  while (true) {
+    Band band;
+    uchar* destination = nullptr;
+    {
+      QMutexLocker locker(&mMutex);
+      while (mBands.empty() && !mStopping) {
+        mWorkQueued.wait(&mMutex);
+      }
+      if (mStopping) return;
+      band = mBands.front();
+      mBands.pop_front();
+      destination = reinterpret_cast<uchar*>(mBuffers[band.buffer].data());
+    }
+
+    QString error;
+    try {
+      if (!presentation) presentation = System::MakeObject<Aspose::Slides::Presentation>(System::String(mFilepath.toStdU16String()));
+      // the last band is lower, the bitmap is reused for the others
+      if (!bitmap || bitmap->get_Width() != band.width || bitmap->get_Height() != band.height) {
+        bitmap = System::MakeObject<System::Drawing::Bitmap>(band.width, band.height, System::Drawing::Imaging::PixelFormat::Format32bppArgb);
+      }
+      auto graphics = System::Drawing::Graphics::FromImage(bitmap);
+      graphics->Clear(System::Drawing::Color::get_White());
+      // the slide moved so the band is at the origin, the rest is clipped
+      graphics->TranslateTransform(0.0f, static_cast<float>(-band.y));
+      presentation->get_Slides()->idx_get(band.slide)->RenderToGraphics(options, graphics, band.scale, band.scale);
+      graphics->Flush();
+
+      auto bits = bitmap->LockBits(System::Drawing::Rectangle(0, 0, band.width, band.height),
+        System::Drawing::Imaging::ImageLockMode::ReadOnly, System::Drawing::Imaging::PixelFormat::Format32bppArgb);
+      const auto* pixels = reinterpret_cast<const uchar*>(static_cast<intptr_t>(bits->get_Scan0()));
+      for (int y = 0; y < band.height; ++y) {
+        std::copy_n(pixels + static_cast<qint64>(y) * bits->get_Stride(), band.width * 4, destination + static_cast<qint64>(y) * band.width * 4);
+      }
+      bitmap->UnlockBits(bits);
+    }
+    catch (System::Exception& exception) {
+      error = QString("Band %1 of slide %2 failed: %3").arg(band.y).arg(band.slide + 1)
+        .arg(QString::fromStdU16String(exception->get_Message().ToU16Str()));
+    }
+
+    QMutexLocker locker(&mMutex);
+    if (!error.isEmpty() && mError.isEmpty()) mError = error;
+    mPending[band.buffer]--;
+    mBandDone.wakeAll();
+  }
+}
+
+void TiledRenderer::queueBand(int slide, float scale, int width, int y, int height, int buffer)
+{
+  QMutexLocker locker(&mMutex);
+  Band band;
+  band.slide = slide;
+  band.scale = scale;
+  band.y = y;
+  band.width = width;
+  band.height = height;
+  band.buffer = buffer;
+  mBands.push_back(band);
+  mPending[buffer]++;
+  mWorkQueued.wakeOne();
+}
+
+bool TiledRenderer::renderSlide(int index, float scale, QIODevice* device, QString* errorMessage)
+{
+  const int width = qRound(mSlideWidth * scale);
+  const int height = qRound(mSlideHeight * scale);
+  PngStreamWriter png(device);
+  if (width <= 0 || height <= 0 || !png.begin(width, height)) {
+    if (errorMessage) *errorMessage = QString("Slide %1 can't be rendered at %2x%3").arg(index + 1).arg(width).arg(height);
+    return false;
+  }
+
+  {
+    QMutexLocker locker(&mMutex);
+    mError.clear();
+  }
+  const qint64 bandBytes = static_cast<qint64>(width) * std::min(mBandHeight, height) * 4;
+  for (auto& buffer : mBuffers) {
+    if (buffer.size() < bandBytes) buffer.resize(bandBytes);
+  }
+
+  // the threads render the following bands while this one is encoded
+  const int bandCount = (height + mBandHeight - 1) / mBandHeight;
+  const int bufferCount = static_cast<int>(mBuffers.size());
+  auto queue = [&](int band) {
+    const int y = band * mBandHeight;
+    queueBand(index, scale, width, y, std::min(mBandHeight, height - y), band % bufferCount);
+  };
+  for (int band = 0; band < std::min(bufferCount, bandCount); ++band) queue(band);
+  QString error;
+  for (int band = 0; band < bandCount && error.isEmpty(); ++band) {
+    const int buffer = band % bufferCount;
+    {
+      QMutexLocker locker(&mMutex);
+      while (mPending[buffer] > 0) {
+        mBandDone.wait(&mMutex);
+      }
+      error = mError;
+    }
+    const int y = band * mBandHeight;
+    if (error.isEmpty() && !png.writeRows(reinterpret_cast<const uchar*>(mBuffers[buffer].constData()), width * 4, std::min(mBandHeight, height - y))) {
+      error = QString("Writing slide %1 failed").arg(index + 1);
+    }
+    // the encoded buffer takes the next band not queued yet
+    if (error.isEmpty() && band + bufferCount < bandCount) queue(band + bufferCount);
+  }
+
+  {
+    // after a failure, bands still rendering write into the buffers
+    QMutexLocker locker(&mMutex);
+    for (const auto& band : mBands) mPending[band.buffer]--;
+    mBands.clear();
+    while (std::any_of(mPending.begin(), mPending.end(), [](int pending) { return pending > 0; })) {
+      mBandDone.wait(&mMutex);
+    }
+  }
+  if (error.isEmpty() && !png.finish()) error = QString("Writing slide %1 failed").arg(index + 1);
+  if (errorMessage) *errorMessage = error;
+  return error.isEmpty();
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <QByteArray>
+#include <QMutex>
+#include <QString>
+#include <QWaitCondition>
+#include <deque>
+#include <thread>
+#include <vector>
+
+class QIODevice;
+
+// Renders slides at resolutions too big for one bitmap, e.g. 8K frames for
+// LED walls. A slide is cut into full width bands rendered in parallel with
+// RenderToGraphics, offset per band; every finished band is streamed into a
+// PngStreamWriter in order while the threads render the following ones.
+// Every band is one render of the whole slide clipped to it, so bands span
+// the width instead of being square tiles: an 8K frame takes 9 renders at
+// the default band height instead of 40 tiles of 1024 pixels. Memory is a
+// band buffer per thread plus one being encoded, and a band bitmap per
+// thread, instead of the whole frame.
+// Aspose presentations are not thread-safe, so every render thread opens its
+// own copy on first use: the threads are capped (4 by default,
+// PPTX_CONVERTER_TILE_THREADS to change it) since every copy holds the whole
+// deck in memory. Keep the renderer of a deck instead of constructing one
+// per render, the PresentationCache does that for the local render. These
+// threads are the only ones rendering slides locally, the other slides are
+// rendered one at a time by the render loop (see RenderQueue.h).
+// renderSlide() blocks and encodes on the calling thread, call it off the UI
+// thread, from one thread at a time.
+
+class TiledRenderer
+{
+public:
+  // threads = 0: defaultThreadCount()
+  explicit TiledRenderer(const QString& filepath, int threads = 0, int bandHeight = 512);
+  ~TiledRenderer();
+
+  // PPTX_CONVERTER_TILE_THREADS or one per core, at most 4
+  static int defaultThreadCount();
+
+  // slide size in points, from the package without opening it in Aspose
+  double slideWidth() const { return mSlideWidth; }
+  double slideHeight() const { return mSlideHeight; }
+  // copies of the presentation opened at most
+  int threadCount() const { return static_cast<int>(mThreads.size()); }
+
+  // render a slide at scale (pixels per point) as PNG into device
+  bool renderSlide(int index, float scale, QIODevice* device, QString* errorMessage = nullptr);
+
+private:
+  struct Band {
+    int slide = 0;
+    float scale = 1.0f;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+    int buffer = 0;
+  };
+
+  void run();
+  // queue the band starting at y into buffer
+  void queueBand(int slide, float scale, int width, int y, int height, int buffer);
+
+  QString mFilepath;
+  int mBandHeight;
+  double mSlideWidth = 0;
+  double mSlideHeight = 0;
+
+  QMutex mMutex;
+  QWaitCondition mWorkQueued;
+  QWaitCondition mBandDone;
+  std::deque<Band> mBands;
+  // one more buffer than threads, the oldest one is encoded meanwhile
+  std::vector<QByteArray> mBuffers;
+  // bands not finished per buffer
+  std::vector<int> mPending;
+  QString mError;
+  bool mStopping = false;
+  std::vector<std::thread> mThreads;
+};
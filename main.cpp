@@ -1,9 +1,146 @@
 #include "PPTXConverterTest.h"
+#include "SoakTest.h"
+#include "FlowBenchmark.h"
+#include "MetricsServer.h"
+#include "FolderWatcher.h"
+#include "RenderCoordinator.h"
+#include "RenderProtocol.h"
+#include "RenderWorker.h"
+#include "ConsoleLog.h"
 #include <QtWidgets/QApplication>
+#include <QProcess>
+#include <QThread>
+#include <memory>
+#include <vector>
 
 int main(int argc, char* argv[])
 {
   QApplication a(argc, argv);
+  const auto arguments = a.arguments();
+
+  // Prometheus metrics: --metrics-port <port> [--metrics-address <address>], local only by default
+  MetricsServer metricsServer;
+  const int metricsIndex = arguments.indexOf("--metrics-port");
+  if (metricsIndex >= 0 && metricsIndex + 1 < arguments.size()) {
+    const int addressIndex = arguments.indexOf("--metrics-address");
+    const QHostAddress address(addressIndex >= 0 && addressIndex + 1 < arguments.size() ? arguments[addressIndex + 1] : QString("127.0.0.1"));
+    if (address.isNull() || !metricsServer.start(static_cast<quint16>(arguments[metricsIndex + 1].toUInt()), address)) {
+      qWarning("Metrics server can't listen on %s port %s", qPrintable(address.toString()), qPrintable(arguments[metricsIndex + 1]));
+    }
+  }
+
+  // headless soak mode: PPTXConverterTest --soak <file.pptx> [iterations]
+  const int soakIndex = arguments.indexOf("--soak");
+  if (soakIndex >= 0 && soakIndex + 1 < arguments.size()) {
+    const int iterations = soakIndex + 2 < arguments.size() ? arguments[soakIndex + 2].toInt() : 1000;
+    SoakTest soak(arguments[soakIndex + 1], iterations);
+    QObject::connect(&soak, &SoakTest::finished, &a, [&a](bool success) { a.exit(success ? 0 : 1); });
+    soak.start();
+    return a.exec();
+  }
+
+  // flow benchmark: PPTXConverterTest --benchmark-flows <file.pptx> [<file.pptx> ...] [--runs <n>]
+  const int benchmarkIndex = arguments.indexOf("--benchmark-flows");
+  if (benchmarkIndex >= 0) {
+    QStringList decks;
+    for (int i = benchmarkIndex + 1; i < arguments.size() && !arguments[i].startsWith("--"); ++i) decks << arguments[i];
+    const int runsIndex = arguments.indexOf("--runs");
+    const int runs = runsIndex >= 0 && runsIndex + 1 < arguments.size() ? arguments[runsIndex + 1].toInt() : 3;
+    if (decks.isEmpty()) return 1;
+    FlowBenchmark benchmark(decks, runs);
+    QObject::connect(&benchmark, &FlowBenchmark::finished, &a, [&a](bool success) { a.exit(success ? 0 : 1); });
+    benchmark.start();
+    return a.exec();
+  }
+
+  // headless daemon mode: PPTXConverterTest --watch <folder> [<folder> ...], the first folder has the highest priority
+  const int watchIndex = arguments.indexOf("--watch");
+  if (watchIndex >= 0) {
+    QStringList folders;
+    for (int i = watchIndex + 1; i < arguments.size() && !arguments[i].startsWith("--"); ++i) folders << arguments[i];
+    FolderWatcher watcher;
+    int watched = 0;
+    for (int i = 0; i < folders.size(); ++i) {
+      if (watcher.addFolder(folders[i], folders.size() - i)) watched++;
+    }
+    if (watched == 0) return 1;
+    watcher.start();
+    return a.exec();
+  }
+
+  // render worker process: PPTXConverterTest --render-worker <host>[:<port>]
+  // the coordinator's secret is taken from PPTX_CONVERTER_RENDER_SECRET
+  const int workerIndex = arguments.indexOf("--render-worker");
+  if (workerIndex >= 0 && workerIndex + 1 < arguments.size()) {
+    const auto address = arguments[workerIndex + 1].split(':');
+    const quint16 port = address.size() > 1 ? static_cast<quint16>(address[1].toUInt()) : RenderProtocol::kDefaultPort;
+    const QByteArray secret = RenderProtocol::secret();
+    if (secret.isEmpty()) {
+      qWarning("Render worker needs the coordinator's secret in %s", RenderProtocol::kSecretVariable);
+      return 1;
+    }
+    RenderWorker worker;
+    worker.start(address[0], port, secret);
+    return a.exec();
+  }
+
+  // distributed local rendering: PPTXConverterTest --render-distributed <file.pptx> <folder> [--workers <n>] [--port <port>] [--listen <address>] [--scale <factor>] [--slide-timeout <seconds>]
+  // starts n workers on this machine (default: one per core). Workers of other machines may connect
+  // if --listen names a reachable address and they share the secret in PPTX_CONVERTER_RENDER_SECRET
+  const int distributedIndex = arguments.indexOf("--render-distributed");
+  if (distributedIndex >= 0 && distributedIndex + 2 < arguments.size()) {
+    auto option = [&arguments](const QString& name, const QString& defaultValue) {
+      const int index = arguments.indexOf(name);
+      return index >= 0 && index + 1 < arguments.size() ? arguments[index + 1] : defaultValue;
+    };
+    const QHostAddress listenAddress(option("--listen", "127.0.0.1"));
+    QByteArray secret = RenderProtocol::secret();
+    if (secret.isEmpty()) {
+      if (!listenAddress.isLoopback()) {
+        qWarning("Remote render workers need a shared secret in %s", RenderProtocol::kSecretVariable);
+        return 1;
+      }
+      // only the workers started here know it
+      secret = RenderProtocol::randomToken();
+    }
+    RenderCoordinator coordinator;
+    coordinator.setSecret(secret);
+    coordinator.setSlideTimeout(option("--slide-timeout", "60").toLongLong() * 1000);
+    if (!coordinator.listen(listenAddress, static_cast<quint16>(option("--port", QString::number(RenderProtocol::kDefaultPort)).toUInt()))) {
+      qWarning("Render coordinator can't listen on %s port %s", qPrintable(listenAddress.toString()), qPrintable(option("--port", QString::number(RenderProtocol::kDefaultPort))));
+      return 1;
+    }
+    // the secret goes to the local workers by environment, not visible in their command line
+    QProcessEnvironment workerEnvironment = QProcessEnvironment::systemEnvironment();
+    workerEnvironment.insert(RenderProtocol::kSecretVariable, QString::fromLatin1(secret));
+    const bool anyAddress = listenAddress == QHostAddress::Any || listenAddress == QHostAddress::AnyIPv4 || listenAddress == QHostAddress::AnyIPv6;
+    const QString workerHost = anyAddress ? QString("127.0.0.1") : coordinator.address().toString();
+    std::vector<std::unique_ptr<QProcess>> workers;
+    const int workerCount = option("--workers", QString::number(QThread::idealThreadCount())).toInt();
+    for (int i = 0; i < workerCount; ++i) {
+      workers.push_back(std::make_unique<QProcess>());
+      workers.back()->setProcessChannelMode(QProcess::ForwardedChannels);
+      workers.back()->setProcessEnvironment(workerEnvironment);
+      workers.back()->start(QCoreApplication::applicationFilePath(), QStringList() << "--render-worker" << QString("%1:%2").arg(workerHost).arg(coordinator.port()));
+    }
+    QObject::connect(&coordinator, &RenderCoordinator::debug, [](const QString& message) { ConsoleLog::timedLine(message); });
+    QObject::connect(&coordinator, &RenderCoordinator::error, &a, [&a](const QString& message) {
+      ConsoleLog::timedLine(message);
+      a.exit(1);
+    });
+    QObject::connect(&coordinator, &RenderCoordinator::finished, &a, [&a](const QStringList& files) {
+      ConsoleLog::timedLine(QString("Rendered %1 slides").arg(files.size()));
+      a.exit(0);
+    });
+    if (!coordinator.render(arguments[distributedIndex + 1], arguments[distributedIndex + 2], option("--scale", "2").toDouble())) return 1;
+    const int result = a.exec();
+    for (auto& worker : workers) {
+      worker->kill();
+      worker->waitForFinished();
+    }
+    return result;
+  }
+
   PPTXConverterTestApp w;
   w.show();
   return a.exec();